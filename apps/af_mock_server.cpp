@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+// Local stand-in for the AF search API, for trying the af_https source
+// without the network. Serves POST /jobs/v1/search with startIndex,
+// maxRecords and fromDate (inclusive, on publishedDate), newest ads first,
+// and publishes `rate` new ads per second.
+//
+//   af_mock_server [port] [initial_ads] [rate]
+//   "url": "http://127.0.0.1:8089/jobs/v1/search"
+
+namespace {
+
+std::string iso_now() {
+    using namespace std::chrono;
+    const auto now = system_clock::now();
+    const auto t = system_clock::to_time_t(now);
+    const auto ms = duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000;
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+    char buf[40];
+    const size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ", static_cast<int>(ms));
+    return buf;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int port = argc > 1 ? std::stoi(argv[1]) : 8089;
+    const int initial = argc > 2 ? std::stoi(argv[2]) : 200;
+    const double rate = argc > 3 ? std::stod(argv[3]) : 2.0;
+
+    std::mutex mu;
+    std::vector<nlohmann::json> ads; // oldest first
+    long next_id = 1;
+    auto publish = [&](int n) {
+        const std::string ts = iso_now();
+        for (int i = 0; i < n; ++i, ++next_id) {
+            ads.push_back({{"id", std::to_string(next_id)},
+                           {"header", "Mock ad " + std::to_string(next_id)},
+                           {"occupation", next_id % 2 ? "Utvecklare" : "Testare"},
+                           {"workplace", "Crossbring"},
+                           {"publishedDate", ts}});
+        }
+    };
+    publish(initial);
+    const auto started = std::chrono::steady_clock::now();
+    long published = 0;
+
+    httplib::Server svr;
+    svr.Post("/jobs/v1/search", [&](const httplib::Request& req, httplib::Response& res) {
+        nlohmann::json q;
+        try {
+            q = nlohmann::json::parse(req.body.empty() ? "{}" : req.body);
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(e.what(), "text/plain");
+            return;
+        }
+        const size_t start = q.value("startIndex", 0);
+        const size_t max = q.value("maxRecords", 25);
+        const std::string from = q.contains("fromDate") && q["fromDate"].is_string() ? q["fromDate"].get<std::string>() : "";
+
+        nlohmann::json out = {{"ads", nlohmann::json::array()}};
+        std::lock_guard<std::mutex> lock(mu);
+        const auto due = static_cast<long>(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() * rate);
+        if (due > published) {
+            publish(static_cast<int>(due - published));
+            published = due;
+        }
+        size_t matching = 0;
+        for (auto it = ads.rbegin(); it != ads.rend(); ++it) {
+            if (!from.empty() && (*it)["publishedDate"].get<std::string>() < from) break;
+            if (matching >= start && out["ads"].size() < max) out["ads"].push_back(*it);
+            ++matching;
+        }
+        out["numberOfAds"] = matching;
+        res.set_content(out.dump(), "application/json");
+    });
+
+    std::cerr << "AF mock on http://127.0.0.1:" << port << "/jobs/v1/search (" << initial << " ads, "
+              << rate << " new/s)\n";
+    if (!svr.listen("127.0.0.1", port)) {
+        std::cerr << "Cannot listen on port " << port << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,806 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#ifdef USE_SQLITE
+#include <sqlite3.h>
+#endif
+#ifdef USE_SHM_RING
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "crossbring/core/checkpoint.h"
+#include "crossbring/core/clock.h"
+#include "crossbring/core/source_runtime.h"
+#include "crossbring/core/tracing.h"
+#include "crossbring/core/engine.h"
+#include "crossbring/event.h"
+#include "crossbring/http/ingest.h"
+#include "crossbring/json/record_parser.h"
+#include "crossbring/processors/enrich_stage.h"
+#include "crossbring/processors/expression.h"
+#include "crossbring/processors/sketch_stage.h"
+#include "crossbring/sinks/archive_sink.h"
+#include "crossbring/sinks/batching_sink.h"
+#include "crossbring/sinks/columnar_sink.h"
+#include "crossbring/sinks/envelope.h"
+#include "crossbring/sinks/recent_buffer_sink.h"
+#include "crossbring/storage/columnar_segment.h"
+#include "crossbring/storage/lookup_table.h"
+#include "crossbring/storage/sketches.h"
+#include "crossbring/storage/sqlite_store.h"
+#include "crossbring/storage/state_store.h"
+#include "crossbring/transport/shm_ring.h"
+
+using namespace crossbring;
+
+namespace {
+
+struct Result {
+    std::string name;
+    double seconds;
+    double bytes;
+    double items;
+};
+
+// Runs fn until at least min_s has elapsed and reports the per-run average.
+Result run(const std::string& name, double bytes, double items, const std::function<void()>& fn, double min_s = 1.0) {
+    fn(); // warm-up
+    size_t iters = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        fn();
+        ++iters;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    } while (elapsed < min_s);
+    return {name, elapsed / static_cast<double>(iters), bytes, items};
+}
+
+void print(const Result& r) {
+    if (r.bytes > 0)
+        std::printf("%-34s %10.1f MB/s %12.0f items/s %10.2f ns/item\n", r.name.c_str(),
+                    r.bytes / r.seconds / 1e6, r.items / r.seconds, r.seconds * 1e9 / r.items);
+    else
+        std::printf("%-34s %12.0f items/s %10.2f ns/item\n", r.name.c_str(), r.items / r.seconds, r.seconds * 1e9 / r.items);
+}
+
+// Synthetic AF search response: `ads` with ids, nested codes and long descriptions.
+std::string make_af_doc(size_t ads) {
+    nlohmann::json doc;
+    doc["total"] = ads;
+    doc["ads"] = nlohmann::json::array();
+    std::string text;
+    for (int i = 0; i < 60; ++i) text += "Vi s\xc3\xb6ker en erfaren utvecklare med \"C++\" och realtidssystem. ";
+    for (size_t i = 0; i < ads; ++i) {
+        doc["ads"].push_back({
+            {"id", std::to_string(29000000 + i)},
+            {"headline", "C++ utvecklare till realtidsteam " + std::to_string(i)},
+            {"publication_date", "2025-10-01T08:00:00"},
+            {"occupation", {{"concept_id", "apaJ_2ja_LuF"}, {"label", "Mjukvaruutvecklare"}}},
+            {"workplace_address", {{"region", "Stockholms l\xc3\xa4n"}, {"region_code", "01"}, {"coordinates", {18.06, 59.33}}}},
+            {"number_of_vacancies", 1 + i % 3},
+            {"remote", i % 2 == 0},
+            {"description", {{"text", text}}},
+        });
+    }
+    return doc.dump();
+}
+
+void bench_json() {
+    const std::string doc = make_af_doc(2000);
+    const double bytes = static_cast<double>(doc.size());
+    const double items = 2000;
+    std::printf("\n== JSON record extraction (%zu ads, %.1f MB, scan isa=%s) ==\n", static_cast<size_t>(items),
+                bytes / 1e6, json_scan_isa());
+
+    // Before: what FileJsonSource did — full DOM, then a DOM copy per event.
+    print(run("nlohmann DOM + copy per event", bytes, items, [&]{
+        auto j = nlohmann::json::parse(doc);
+        for (auto& item : j["ads"]) {
+            Event ev;
+            ev.key = item.value("id", "");
+            ev.payload = item;
+        }
+    }));
+
+    auto scan = make_record_parser("scan");
+    print(run("scan: validate + key + raw span", bytes, items, [&]{
+        scan->for_each(doc, [](const JsonRecord& rec) {
+            Event ev;
+            ev.key = std::string(rec.key);
+            ev.raw = std::string(rec.text);
+        });
+    }));
+
+    print(run("scan + DOM materialized later", bytes, items, [&]{
+        scan->for_each(doc, [](const JsonRecord& rec) {
+            Event ev;
+            ev.raw = std::string(rec.text);
+            (void)ev.json();
+        });
+    }));
+}
+
+void bench_expr() {
+    std::vector<Event> evs(1024);
+    for (size_t i = 0; i < evs.size(); ++i) {
+        evs[i].source = i % 2 ? "temp" : "rpm";
+        evs[i].key = "sensor-" + evs[i].source;
+        evs[i].payload = {{"type", "sensor"}, {"name", evs[i].source}, {"value", 40.0 + static_cast<double>(i % 60)},
+                          {"tags", {{"site", "sto"}}}};
+    }
+    const double items = static_cast<double>(evs.size());
+    std::printf("\n== Compiled expressions (%zu events, per evaluation) ==\n", evs.size());
+
+    const char* exprs[] = {
+        "source == 'temp' && value > 70",
+        "value * 1.8 + 32",
+        "exists(tags.site) && starts_with(key, 'sensor-')",
+        "min(max(value, 0), 100) / 100 * 2 + 1 > 1.5 || name == 'rpm'",
+    };
+    for (const char* text : exprs) {
+        auto expr = Expression::compile(text);
+        size_t hits = 0;
+        print(run(text, 0, items, [&]{
+            for (auto& ev : evs) hits += expr.test(ev);
+        }, 0.5));
+        if (hits == 0) std::printf("  (no matches)\n");
+    }
+
+    // The same filter as a hand-written lambda, for reference.
+    size_t hits = 0;
+    print(run("C++ lambda: temp && value > 70", 0, items, [&]{
+        for (auto& ev : evs) {
+            auto it = ev.payload.find("value");
+            hits += ev.source == "temp" && it != ev.payload.end() && it->is_number() && it->get<double>() > 70;
+        }
+    }, 0.5));
+}
+
+void bench_sketch() {
+    std::vector<std::string> keys(4096);
+    std::vector<Event> evs(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        // A few hot keys over a long tail, like job ids with repeated updates.
+        keys[i] = "job-" + std::to_string(i % 8 == 0 ? i % 5 : i * 7919 % 100000);
+        evs[i].source = "af_jobs";
+        evs[i].key = keys[i];
+        evs[i].payload = {{"value", static_cast<double>(i % 997) / 10.0}};
+    }
+    const double items = static_cast<double>(keys.size());
+    std::printf("\n== Sketches (%zu items, per update) ==\n", keys.size());
+
+    HeavyHitters hh;
+    print(run("Count-Min + top-16", 0, items, [&]{
+        for (auto& k : keys) hh.add(k);
+    }, 0.5));
+    HyperLogLog hll;
+    print(run("HyperLogLog (p=10)", 0, items, [&]{
+        for (auto& k : keys) hll.add(k);
+    }, 0.5));
+    QuantileSketch kll;
+    print(run("KLL (k=128)", 0, items, [&]{
+        for (size_t i = 0; i < keys.size(); ++i) kll.add(static_cast<double>(i % 997));
+    }, 0.5));
+
+    Engine engine(16, 1);
+    SketchStage stage(engine, SketchStage::Options{});
+    print(run("SketchStage::process (all three)", 0, items, [&]{
+        for (auto& ev : evs) stage.process(ev);
+    }, 0.5));
+    std::printf("  bytes per source and shard: %zu + %zu + %zu\n", hh.memory_bytes(), hll.memory_bytes(), kll.memory_bytes());
+}
+
+void bench_enrich() {
+    const size_t rows = 50000;
+    auto dir = std::filesystem::temp_directory_path() / "crossbring_bench_enrich";
+    std::filesystem::create_directories(dir);
+    auto csv = dir / "occupations.csv";
+    {
+        std::ofstream os(csv);
+        os << "code,label,ssyk,field\n";
+        for (size_t i = 0; i < rows; ++i)
+            os << "occ-" << i << ",Yrke " << i << "," << 1000 + i % 9000 << ",Data/IT\n";
+    }
+    std::vector<Event> evs(4096);
+    for (size_t i = 0; i < evs.size(); ++i)
+        evs[i].payload = {{"occupation", {{"concept_id", "occ-" + std::to_string(i * 7919 % rows)}}}};
+    const double items = static_cast<double>(evs.size());
+    std::printf("\n== Enrichment (%zu-row table, %zu events) ==\n", rows, evs.size());
+
+    print(run("compile CSV to table", 0, static_cast<double>(rows), [&]{
+        LookupTable::compile(csv, dir / "occupations.lut", "code");
+    }, 0.5));
+    auto table = LookupTable::open(dir / "occupations.lut");
+    std::vector<std::string> keys;
+    for (auto& ev : evs) keys.push_back(ev.payload["occupation"]["concept_id"].get<std::string>());
+    size_t found = 0;
+    print(run("LookupTable::find (mmap)", 0, items, [&]{
+        for (auto& k : keys) found += table->find(k) != LookupTable::npos;
+    }, 0.5));
+
+    // Before: the table as a JSON map, each hit copies its row object.
+    std::unordered_map<std::string, nlohmann::json> map;
+    for (size_t i = 0; i < rows; ++i)
+        map["occ-" + std::to_string(i)] = {{"label", "Yrke " + std::to_string(i)}, {"ssyk", 1000 + i % 9000}, {"field", "Data/IT"}};
+    print(run("unordered_map<json> find + copy", 0, items, [&]{
+        for (auto& ev : evs) {
+            auto it = map.find(ev.payload["occupation"]["concept_id"].get_ref<const std::string&>());
+            if (it != map.end()) ev.payload["occupation"]["info"] = it->second;
+        }
+    }, 0.5));
+
+    Engine engine(1, 1);
+    EnrichStage::Options o;
+    o.name = "occupation";
+    o.table = csv;
+    o.on = "occupation.concept_id";
+    o.target = "occupation.info";
+    o.poll_ms = 0;
+    EnrichStage stage(engine, o);
+    print(run("EnrichStage::process (3 columns)", 0, items, [&]{
+        for (auto& ev : evs) stage.process(ev);
+    }, 0.5));
+    std::printf("  table file: %zu bytes, %zu lookups hit\n", table->file_bytes(), found);
+    std::filesystem::remove_all(dir);
+}
+
+void bench_archive() {
+    // AF-sized payloads as raw JSON, fed from four threads like engine workers.
+    std::string doc = make_af_doc(64);
+    std::vector<Event> evs;
+    make_record_parser("scan")->for_each(doc, [&](const JsonRecord& rec) {
+        Event ev;
+        ev.source = "af_jobs";
+        ev.key = std::string(rec.key);
+        ev.raw = std::string(rec.text);
+        evs.push_back(std::move(ev));
+    });
+    double bytes = 0;
+    for (auto& ev : evs) bytes += static_cast<double>(envelope_json(ev).size() + 1);
+    const size_t threads = 4, rounds = 64;
+    const double scale = static_cast<double>(threads * rounds);
+    std::printf("\n== Archive sink (%zu threads x %zu events, %.1f MB per run) ==\n",
+                threads, evs.size() * rounds, bytes * scale / 1e6);
+
+    auto dir = std::filesystem::temp_directory_path() / "crossbring_bench_archive";
+    auto bench = [&](const char* label, ArchiveSink::Format format, ArchiveSink::Codec codec) {
+        std::filesystem::remove_all(dir);
+        ArchiveSink::Options o;
+        o.dir = dir;
+        o.format = format;
+        o.codec = codec;
+        o.io_threads = 4;
+        ArchiveSink sink(o);
+        print(run(label, bytes * scale, static_cast<double>(evs.size()) * scale, [&]{
+            std::vector<std::thread> ts;
+            for (size_t t = 0; t < threads; ++t)
+                ts.emplace_back([&]{ for (size_t r = 0; r < rounds; ++r) for (auto& ev : evs) sink.consume(ev); });
+            for (auto& t : ts) t.join();
+            sink.flush();
+        }, 1.0));
+    };
+    bench("ndjson, no compression", ArchiveSink::Format::Ndjson, ArchiveSink::Codec::None);
+    bench("binary, no compression", ArchiveSink::Format::Binary, ArchiveSink::Codec::None);
+    try {
+        bench("ndjson, deflate level 1", ArchiveSink::Format::Ndjson, ArchiveSink::Codec::Deflate);
+    } catch (const std::exception& e) {
+        std::printf("  deflate skipped: %s\n", e.what());
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void bench_columnar() {
+    // Sensor-like events; the query is "sum of value" over everything written.
+    const size_t n = 200000;
+    std::vector<Event> evs(n);
+    std::vector<std::string> lines(n);
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        evs[i].tp = t0 + std::chrono::microseconds(i);
+        evs[i].source = "temp";
+        evs[i].key = "sensor-" + std::to_string(i % 64);
+        evs[i].payload = {{"value", 20.0 + static_cast<double>(i % 1000) / 10.0}, {"unit", "C"},
+                          {"status", {{"ok", i % 7 != 0}, {"code", static_cast<int>(i % 5)}}}};
+        lines[i] = envelope_json(evs[i]);
+    }
+    const double items = static_cast<double>(n);
+    std::printf("\n== Columnar segments (%zu events) ==\n", n);
+
+    auto dir = std::filesystem::temp_directory_path() / "crossbring_bench_columnar";
+    std::filesystem::remove_all(dir);
+    {
+        ColumnarSink::Options o;
+        o.dir = dir;
+        ColumnarSink sink(o);
+        print(run("ColumnarSink::consume + write", 0, items, [&]{
+            for (auto& ev : evs) sink.consume(ev);
+            sink.flush();
+        }, 1.0));
+    }
+    // Keep one run's worth of segments for the scan.
+    std::filesystem::remove_all(dir);
+    {
+        ColumnarSink::Options o;
+        o.dir = dir;
+        ColumnarSink sink(o);
+        for (auto& ev : evs) sink.consume(ev);
+    }
+
+    double sum = 0;
+    print(run("segment scan: sum(value)", 0, items, [&]{
+        for (auto& path : ColumnarSegment::find(dir, "temp", INT64_MIN, INT64_MAX)) {
+            auto seg = ColumnarSegment::open(path);
+            auto col = seg->find_column("value");
+            if (!col || !col->f64()) continue;
+            const double* v = col->f64();
+            for (size_t r = 0; r < seg->rows(); ++r) sum += v[r];
+        }
+    }, 0.5));
+    print(run("NDJSON parse: sum(payload.value)", 0, items, [&]{
+        for (auto& line : lines) sum += nlohmann::json::parse(line)["payload"]["value"].get<double>();
+    }, 0.5));
+    const int64_t last = to_unix_ns(evs.back().tp);
+    auto all = ColumnarSegment::find(dir, "", INT64_MIN, INT64_MAX);
+    size_t seg_bytes = 0, ndjson_bytes = 0;
+    for (auto& path : all) seg_bytes += std::filesystem::file_size(path);
+    for (auto& line : lines) ndjson_bytes += line.size() + 1;
+    std::printf("  %zu segments (%zu bytes, NDJSON %zu bytes); %zu left after skipping by time to the newest event\n",
+                all.size(), seg_bytes, ndjson_bytes, ColumnarSegment::find(dir, "temp", last, INT64_MAX).size());
+    if (sum == 0) std::printf("  (no rows scanned)\n");
+    std::filesystem::remove_all(dir);
+}
+
+void bench_source_runtime() {
+    // 50 sources ticking every 10 ms, each tick doing ~100 us of work.
+    const size_t sources = 50;
+    const auto period = std::chrono::milliseconds(10);
+    const auto span = std::chrono::seconds(2);
+    const double expected = static_cast<double>(sources) * (span / period);
+    auto work = []{
+        const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(100);
+        while (std::chrono::steady_clock::now() < until) {}
+    };
+    std::printf("\n== Source scheduling (%zu sources x %lld ms period, %lld s) ==\n", sources,
+                static_cast<long long>(period.count()), static_cast<long long>(span.count()));
+
+    // Before: one thread per source, sleeping after each tick's work.
+    std::atomic<bool> running{true};
+    std::atomic<size_t> ticks{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sources; ++i)
+        threads.emplace_back([&]{
+            while (running) {
+                work();
+                ++ticks;
+                std::this_thread::sleep_for(period);
+            }
+        });
+    std::this_thread::sleep_for(span);
+    running = false;
+    for (auto& t : threads) t.join();
+    std::printf("%-34s %6zu threads %8zu ticks (%.1f%% of schedule)\n", "thread per source + sleep_for", sources,
+                ticks.load(), 100.0 * static_cast<double>(ticks.load()) / expected);
+
+    MetricsRegistry reg;
+    SourceRuntime runtime(reg, {});
+    runtime.start();
+    ticks = 0;
+    std::vector<SourceRuntime::TimerId> ids;
+    for (size_t i = 0; i < sources; ++i) ids.push_back(runtime.every(period, [&]{ work(); ++ticks; }));
+    std::this_thread::sleep_for(span);
+    for (auto id : ids) runtime.cancel(id);
+    std::printf("%-34s %6zu threads %8zu ticks (%.1f%% of schedule)\n", "SourceRuntime timer wheel",
+                runtime.threads(), ticks.load(), 100.0 * static_cast<double>(ticks.load()) / expected);
+}
+
+void bench_batching() {
+    // Parsed AF ads (~4 KB payloads) from four producer threads into a sink that drops them.
+    struct NullSink : Sink {
+        std::atomic<size_t> n{0};
+        void consume(const Event&) override { ++n; }
+        void consume_batch(const std::vector<EventPtr>& b) override { n += b.size(); }
+        std::string name() const override { return "null"; }
+    };
+    std::string doc = make_af_doc(64);
+    std::vector<Event> evs;
+    make_record_parser("scan")->for_each(doc, [&](const JsonRecord& rec) {
+        Event ev;
+        ev.source = "af_jobs";
+        ev.key = std::string(rec.key);
+        ev.payload = nlohmann::json::parse(rec.text);
+        evs.push_back(std::move(ev));
+    });
+    const size_t threads = 4, rounds = 32;
+    const double items = static_cast<double>(threads * rounds * evs.size());
+    std::printf("\n== Batching sink (%zu threads x %zu events) ==\n", threads, rounds * evs.size());
+    auto drive = [&](const std::function<void(const Event&)>& fn) {
+        std::vector<std::thread> ts;
+        for (size_t t = 0; t < threads; ++t)
+            ts.emplace_back([&]{ for (size_t r = 0; r < rounds; ++r) for (auto& ev : evs) fn(ev); });
+        for (auto& t : ts) t.join();
+    };
+
+    // Before: every event copied into one vector under the mutex the flusher also takes.
+    {
+        std::mutex mu;
+        std::vector<Event> buf;
+        auto inner = std::make_shared<NullSink>();
+        print(run("copy into shared buffer + mutex", 0, items, [&]{
+            drive([&](const Event& ev) {
+                std::vector<Event> full;
+                {
+                    std::lock_guard<std::mutex> lock(mu);
+                    buf.push_back(ev);
+                    if (buf.size() >= 32) full.swap(buf);
+                }
+                for (auto& e : full) inner->consume(e);
+            });
+        }, 0.5));
+    }
+    auto inner = std::make_shared<NullSink>();
+    BatchingSink sink(inner, 32, 200);
+    print(run("BatchingSink::consume (copies)", 0, items, [&]{
+        drive([&](const Event& ev) { sink.consume(ev); });
+    }, 0.5));
+    // The engine path: the event was moved into a shared allocation once, here
+    // outside the timed loop, and the sink only stores the pointer.
+    std::vector<EventPtr> shared;
+    for (auto& ev : evs) shared.push_back(std::make_shared<const Event>(ev));
+    print(run("BatchingSink::consume_shared", 0, items, [&]{
+        std::vector<std::thread> ts;
+        for (size_t t = 0; t < threads; ++t)
+            ts.emplace_back([&]{ for (size_t r = 0; r < rounds; ++r) for (auto& ev : shared) sink.consume_shared(ev); });
+        for (auto& t : ts) t.join();
+    }, 0.5));
+}
+
+void bench_tracing() {
+    // Per-event cost of tracing on the worker path: a sampling decision plus, for
+    // sampled events, one span per stage.
+    MetricsRegistry reg;
+    Tracer tracer(reg);
+    Tracer::Options opts;
+    opts.enabled = true;
+    opts.sample_rate = 0.001;
+    tracer.configure(opts);
+    const uint32_t name = tracer.intern("stage");
+    const size_t n = 1000000;
+    std::printf("\n== Tracing (%zu events) ==\n", n);
+    uint64_t sink = 0;
+    print(run("sample() at 0.1%", 0, static_cast<double>(n), [&]{
+        for (size_t i = 0; i < n; ++i) sink += tracer.sample();
+    }, 0.5));
+    print(run("Scope, sampled event (records)", 0, static_cast<double>(n), [&]{
+        for (size_t i = 0; i < n; ++i) { Tracer::Scope s(tracer, i + 1, name); }
+    }, 0.5));
+    std::string json;
+    print(run("chrome_json (16384 spans)", 0, 16384, [&]{ json = tracer.chrome_json(); }, 0.5));
+    std::printf("%-34s %10zu bytes\n", "dump size", json.size());
+    if (sink == 0) std::printf("  (nothing sampled)\n");
+}
+
+void bench_ingest() {
+    // An NDJSON body of sensor readings, fed in 16 KB chunks as the HTTP server would.
+    struct NullSink : Sink {
+        void consume(const Event&) override {}
+        std::string name() const override { return "null"; }
+    };
+    std::string body;
+    const size_t records = 100000;
+    for (size_t i = 0; i < records; ++i)
+        body += "{\"id\":" + std::to_string(i) + ",\"sensor\":\"line-" + std::to_string(i % 8) +
+                "\",\"value\":" + std::to_string(20.0 + static_cast<double>(i % 100) * 0.5) + ",\"ok\":true}\n";
+    std::printf("\n== HTTP ingest body handling (%zu records, %.1f MB NDJSON) ==\n", records, body.size() / 1e6);
+    Engine engine(records + 1, 1, Engine::Backpressure::Drop);
+    engine.add_sink(std::make_shared<NullSink>());
+    engine.start();
+    auto wait_drained = [&]{ while (engine.queue_size() > 0) std::this_thread::yield(); };
+
+    // Before: DOM-parse each line and submit it on its own.
+    print(run("parse each line + submit", static_cast<double>(body.size()), static_cast<double>(records), [&]{
+        size_t start = 0;
+        for (size_t nl; (nl = body.find('\n', start)) != std::string::npos; start = nl + 1) {
+            Event ev;
+            ev.source = "http";
+            ev.payload = nlohmann::json::parse(body.begin() + static_cast<std::ptrdiff_t>(start),
+                                               body.begin() + static_cast<std::ptrdiff_t>(nl));
+            engine.submit(std::move(ev));
+        }
+        wait_drained();
+    }, 0.5));
+
+    IngestHandler ingest(engine, {});
+    print(run("IngestHandler NDJSON (scan + bulk)", static_cast<double>(body.size()), static_cast<double>(records), [&]{
+        auto req = ingest.begin(IngestHandler::Format::Ndjson, "", "bench");
+        for (size_t off = 0; off < body.size(); off += 16384)
+            req.feed(body.data() + off, std::min<size_t>(16384, body.size() - off));
+        auto res = req.finish();
+        if (res.accepted != records) std::printf("  (accepted %zu)\n", res.accepted);
+        wait_drained();
+    }, 0.5));
+    engine.stop();
+}
+
+void bench_checkpoint() {
+    auto dir = std::filesystem::temp_directory_path() / "crossbring_bench_checkpoint";
+    std::filesystem::remove_all(dir);
+    spdlog::set_level(spdlog::level::warn); // restore() logs once per run
+    const size_t keys = 100000;
+    MetricsRegistry reg;
+    StateStore state;
+    RecentBuffer recent(500);
+    for (size_t i = 0; i < keys; ++i) {
+        Event ev;
+        ev.tp = std::chrono::steady_clock::now();
+        ev.source = "temp";
+        ev.key = "sensor-" + std::to_string(i);
+        ev.payload = {{"value", static_cast<double>(i) * 0.25}, {"unit", "C"}, {"line", i % 16}, {"ok", true}};
+        auto doc = std::make_shared<const std::string>(envelope_json(ev));
+        if (i % 200 == 0) recent.push(nlohmann::json::parse(*doc));
+        state.upsert(ev.key, static_cast<int64_t>(i), std::move(doc));
+    }
+    CheckpointManager ck(reg, {dir / "engine.ckpt", 1000});
+    ck.add("state", state);
+    ck.add("recent", recent);
+    ck.checkpoint();
+    const double bytes = static_cast<double>(std::filesystem::file_size(dir / "engine.ckpt"));
+    std::printf("\n== Checkpoints (%zu state keys + 500 recent items, %.1f MB file) ==\n", keys, bytes / 1e6);
+
+    int64_t ts = static_cast<int64_t>(keys);
+    print(run("checkpoint, state changed", bytes, static_cast<double>(keys), [&]{
+        state.upsert("sensor-0", ++ts, std::make_shared<const std::string>("{}"));
+        ck.checkpoint();
+    }, 0.5));
+    print(run("checkpoint, nothing changed", 0, 1, [&]{ ck.checkpoint(); }, 0.3));
+    print(run("restore (map + rebuild)", bytes, static_cast<double>(keys), [&]{
+        StateStore s2;
+        RecentBuffer r2(500);
+        CheckpointManager ck2(reg, {dir / "engine.ckpt", 1000});
+        ck2.add("state", s2);
+        ck2.add("recent", r2);
+        ck2.restore();
+    }, 0.5));
+    std::filesystem::remove_all(dir);
+    spdlog::set_level(spdlog::level::info);
+}
+
+#ifdef USE_SQLITE
+void bench_sqlite() {
+    // 24 hours of history, 1000 keys, written in batches of 500 as the batching sink would.
+    auto dir = std::filesystem::temp_directory_path() / "crossbring_bench_sqlite";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const size_t hours = 24, per_hour = 20000, keys = 1000, batch_size = 500;
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::vector<EventPtr>> batches;
+    std::vector<EventPtr> batch;
+    for (size_t i = 0; i < hours * per_hour; ++i) {
+        auto ev = std::make_shared<Event>();
+        ev->tp = now - std::chrono::hours(hours) + std::chrono::milliseconds(i * 3600000 / per_hour);
+        ev->source = "temp";
+        ev->key = "sensor-" + std::to_string(i % keys);
+        ev->raw = "{\"value\":" + std::to_string(static_cast<double>(i % 997) * 0.25) + ",\"unit\":\"C\"}";
+        batch.push_back(std::move(ev));
+        if (batch.size() == batch_size) batches.push_back(std::move(batch)), batch.clear();
+    }
+    const double rows = static_cast<double>(hours * per_hour);
+    std::printf("\n== SQLite history (%zu h x %zu events, %zu keys; query: 1 key, 1 h window) ==\n", hours, per_hour,
+                keys);
+    auto secs = [](std::chrono::steady_clock::time_point t0) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    };
+    auto report = [&](const char* name, double s) { print({name, s, 0, rows}); };
+    const int64_t window_end = 12; // hours before now; a sealed partition in the middle
+
+    // Before: the old sink's single table, no index, one transaction per batch.
+    {
+        sqlite3* db = nullptr;
+        sqlite3_open((dir / "events.sqlite").string().c_str(), &db);
+        sqlite3_exec(db, "CREATE TABLE events (id INTEGER PRIMARY KEY AUTOINCREMENT, ts_ns INTEGER, source TEXT,"
+                         " key TEXT, payload TEXT)", nullptr, nullptr, nullptr);
+        sqlite3_stmt* ins = nullptr;
+        sqlite3_prepare_v2(db, "INSERT INTO events (ts_ns, source, key, payload) VALUES (?,?,?,?)", -1, &ins, nullptr);
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto& b : batches) {
+            sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+            for (auto& ev : b) {
+                sqlite3_reset(ins);
+                sqlite3_bind_int64(ins, 1, std::chrono::duration_cast<std::chrono::nanoseconds>(ev->tp.time_since_epoch()).count());
+                sqlite3_bind_text(ins, 2, ev->source.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(ins, 3, ev->key.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(ins, 4, ev->raw.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_step(ins);
+            }
+            sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+        }
+        report("append, single table", secs(t0));
+        sqlite3_finalize(ins);
+
+        const int64_t to = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            (now - std::chrono::hours(window_end)).time_since_epoch()).count();
+        const int64_t from = to - 3600LL * 1000000000LL;
+        sqlite3_stmt* q = nullptr;
+        sqlite3_prepare_v2(db, "SELECT ts_ns, payload FROM events WHERE source = ?1 AND key = ?2 AND ts_ns >= ?3"
+                               " AND ts_ns < ?4 ORDER BY ts_ns LIMIT 1000", -1, &q, nullptr);
+        print(run("query, single table (scan)", 0, 1, [&]{
+            sqlite3_reset(q);
+            sqlite3_bind_text(q, 1, "temp", -1, SQLITE_STATIC);
+            sqlite3_bind_text(q, 2, "sensor-17", -1, SQLITE_STATIC);
+            sqlite3_bind_int64(q, 3, from);
+            sqlite3_bind_int64(q, 4, to);
+            while (sqlite3_step(q) == SQLITE_ROW) {}
+        }, 0.5));
+        sqlite3_finalize(q);
+        sqlite3_close(db);
+    }
+
+    // After: hourly partition files, indexed once sealed.
+    {
+        MetricsRegistry reg;
+        SqliteStore::Options opts;
+        opts.dir = dir / "parts";
+        SqliteStore store(opts, reg);
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto& b : batches) store.append(b);
+        report("append, hourly partitions", secs(t0));
+
+        auto& index_seconds = reg.histogram("crossbring_sqlite_index_seconds", "");
+        auto indexed = [&] {
+            uint64_t n = 0;
+            for (size_t i = 0; i <= index_seconds.bounds().size(); ++i) n += index_seconds.bucket(i);
+            return n;
+        };
+        while (indexed() < hours - 2) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        SqliteStore::Query q;
+        q.source = "temp";
+        q.key = "sensor-17";
+        q.to_ns = to_unix_ns(now - std::chrono::hours(window_end));
+        q.from_ns = q.to_ns - 3600LL * 1000000000LL;
+        print(run("query, pruned + indexed", 0, 1, [&]{
+            store.query(q, [](const SqliteStore::Row&) { return true; });
+        }, 0.5));
+    }
+    std::filesystem::remove_all(dir);
+}
+#endif
+
+#ifdef USE_SHM_RING
+void bench_shm_ring() {
+    // Envelopes of sensor-sized events to a reader thread in the same process.
+    Event ev;
+    ev.source = "temp";
+    ev.key = "sensor-17";
+    ev.payload = nlohmann::json{{"value", 71.25}, {"unit", "C"}, {"line", "line-1"}};
+    const std::string msg = envelope_json(ev);
+    const size_t count = 200000, samples = 5000;
+    std::printf("\n== Same-host handoff (%zu B envelopes) ==\n", msg.size());
+    auto now_ns = []{
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    auto report = [&](const char* name, double secs, double latency_ns) {
+        std::printf("%-34s %12.0f items/s %10.0f ns one-way (writer idle between events)\n", name,
+                    static_cast<double>(count) / secs, latency_ns);
+    };
+
+    // Before: a stream socket, one write() and one read() per event.
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return;
+        auto pump = [&](size_t n, bool stamp, double& lat_sum) {
+            std::thread rd([&]{
+                std::string buf(msg.size(), '\0');
+                for (size_t i = 0; i < n; ++i) {
+                    size_t got = 0;
+                    while (got < buf.size()) got += static_cast<size_t>(::read(fds[1], &buf[got], buf.size() - got));
+                    if (stamp) {
+                        int64_t t;
+                        std::memcpy(&t, buf.data(), sizeof(t));
+                        lat_sum += static_cast<double>(now_ns() - t);
+                    }
+                }
+            });
+            std::string out = msg;
+            for (size_t i = 0; i < n; ++i) {
+                if (stamp) {
+                    int64_t t = now_ns();
+                    std::memcpy(&out[0], &t, sizeof(t));
+                }
+                if (::write(fds[0], out.data(), out.size()) < 0) break;
+                if (stamp) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            rd.join();
+        };
+        double lat = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        pump(count, false, lat);
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        pump(samples, true, lat);
+        report("unix socket write/read", secs, lat / static_cast<double>(samples));
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    {
+        ShmRingWriter ring("crossbring-bench", {4u << 20, 4});
+        ShmRingReader reader("crossbring-bench");
+        auto pump = [&](size_t n, bool stamp, double& lat_sum) {
+            std::thread rd([&]{
+                size_t seen = 0;
+                while (seen < n) {
+                    reader.wait(std::chrono::milliseconds(100));
+                    seen += reader.poll([&](std::string_view m) {
+                        if (!stamp) return;
+                        int64_t t;
+                        std::memcpy(&t, m.data(), sizeof(t));
+                        lat_sum += static_cast<double>(now_ns() - t);
+                    });
+                }
+            });
+            std::string out = msg;
+            for (size_t i = 0; i < n; ++i) {
+                if (stamp) {
+                    int64_t t = now_ns();
+                    std::memcpy(&out[0], &t, sizeof(t));
+                }
+                while (!ring.write(out)) std::this_thread::yield();
+                if (stamp) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            rd.join();
+        };
+        double lat = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        pump(count, false, lat);
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        pump(samples, true, lat);
+        report("ShmRing write/poll", secs, lat / static_cast<double>(samples));
+        // Ring cost alone, without a wake-up or context switch in between: what a
+        // reader spinning on its own core pays per event.
+        size_t seen = 0;
+        print(run("ShmRing write+poll, same thread", 0, static_cast<double>(count), [&]{
+            for (size_t i = 0; i < count; ++i) {
+                ring.write(msg);
+                seen += reader.poll([](std::string_view) {});
+            }
+        }, 0.5));
+    }
+}
+#endif
+
+} // namespace
+
+int main() {
+    bench_json();
+    bench_expr();
+    bench_sketch();
+    bench_enrich();
+    bench_archive();
+    bench_columnar();
+    bench_source_runtime();
+    bench_batching();
+    bench_tracing();
+    bench_ingest();
+    bench_checkpoint();
+#ifdef USE_SQLITE
+    bench_sqlite();
+#endif
+#ifdef USE_SHM_RING
+    bench_shm_ring();
+#endif
+    return 0;
+}
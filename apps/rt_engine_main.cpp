@@ -8,17 +8,33 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include "crossbring/core/checkpoint.h"
+#include "crossbring/core/clock.h"
 #include "crossbring/core/engine.h"
+#include "crossbring/core/source_runtime.h"
+#include "crossbring/processors/cep.h"
+#include "crossbring/processors/enrich_stage.h"
+#include "crossbring/processors/expression.h"
+#include "crossbring/processors/sketch_stage.h"
 #include "crossbring/sources/sensor_simulator.h"
 #include "crossbring/sources/file_json_source.h"
+#include "crossbring/sinks/archive_sink.h"
+#include "crossbring/sinks/columnar_sink.h"
 #include "crossbring/sinks/console_sink.h"
 #include "crossbring/sinks/sqlite_sink.h"
+#include "crossbring/storage/sqlite_store.h"
 #include "crossbring/sinks/batching_sink.h"
 #include "crossbring/sinks/recent_buffer_sink.h"
+#include "crossbring/sinks/time_series_sink.h"
+#include "crossbring/sinks/event_index_sink.h"
+#include "crossbring/sinks/state_sink.h"
 #include "crossbring/http/http_server.h"
 #include "crossbring/http/event_hub.h"
+#include "crossbring/http/ingest.h"
 #include "crossbring/sinks/zmq_sink.h"
+#include "crossbring/sinks/shm_sink.h"
 #include "crossbring/sources/af_https_source.h"
+#include "crossbring/sources/line_protocol_source.h"
 
 using namespace crossbring;
 
@@ -47,22 +63,210 @@ int main(int argc, char** argv) {
     size_t queue_cap = cfg.value("queue_capacity", 1024);
     size_t workers = cfg.value("workers", std::thread::hardware_concurrency());
     std::string backpressure = cfg.value("backpressure", std::string("block"));
-    bool drop_on_full = (backpressure == "drop");
-    Engine engine(queue_cap, workers, drop_on_full);
+    Engine::Backpressure bp = Engine::Backpressure::Block;
+    if (backpressure == "drop") bp = Engine::Backpressure::Drop;
+    else if (backpressure == "conflate") bp = Engine::Backpressure::Conflate;
+    else if (backpressure != "block") spdlog::warn("Unknown backpressure '{}', using block", backpressure);
+    Engine engine(queue_cap, workers, bp);
 
-    // Example processor: add ingest_ts to payload
-    engine.add_processor([](Event& ev){
-        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(ev.tp.time_since_epoch()).count();
-        ev.payload["ingest_ts_ns"] = ns;
-    });
+    // Low-latency mode: pinned workers that busy-poll before parking
+    if (cfg.contains("low_latency") && cfg["low_latency"].value("enabled", false)) {
+        auto& ll = cfg["low_latency"];
+        Engine::WorkerOptions wopts;
+        wopts.cpus = ll.value("worker_cpus", std::vector<int>{});
+        wopts.numa_local = ll.value("numa_local", false);
+        wopts.spin_us = ll.value("spin_us", 50u);
+        engine.set_worker_options(wopts);
+    }
+
+    // Elastic mode: worker count follows queue depth and queue wait
+    if (cfg.contains("elastic") && cfg["elastic"].value("enabled", false)) {
+        auto& ec = cfg["elastic"];
+        Engine::ElasticOptions eopts;
+        eopts.enabled = true;
+        eopts.min_workers = ec.value("min_workers", eopts.min_workers);
+        eopts.max_workers = ec.value("max_workers", eopts.max_workers);
+        eopts.grow_queue_depth = ec.value("grow_queue_depth", eopts.grow_queue_depth);
+        eopts.grow_wait_us = ec.value("grow_wait_us", eopts.grow_wait_us);
+        eopts.shrink_idle_ms = ec.value("shrink_idle_ms", eopts.shrink_idle_ms);
+        eopts.interval_ms = ec.value("interval_ms", eopts.interval_ms);
+        engine.set_elastic(eopts);
+    }
+
+    // Byte budgets: per-component bounds plus a process-wide limit enforced at submit()
+    const nlohmann::json mem = cfg.value("memory", nlohmann::json::object());
+    const bool mem_enabled = mem.value("enabled", false);
+    auto mem_bytes = [&](const char* key) {
+        return mem_enabled ? static_cast<size_t>(mem.value(key, 0.0) * 1024 * 1024) : size_t{0};
+    };
+    {
+        Engine::MemoryOptions mopts;
+        mopts.enabled = mem_enabled;
+        mopts.limit_bytes = mem_bytes("limit_mb");
+        mopts.queue_max_bytes = mem_bytes("queue_max_mb");
+        engine.set_memory_options(mopts);
+    }
+    if (cfg.contains("tracing")) {
+        auto& tc = cfg["tracing"];
+        Tracer::Options topts;
+        topts.enabled = tc.value("enabled", false);
+        topts.sample_rate = tc.value("sample_rate", topts.sample_rate);
+        topts.buffer_spans = tc.value("buffer_spans", topts.buffer_spans);
+        engine.set_tracing(topts);
+    }
+    // Checkpoints: stateful components register below and are restored before the engine starts.
+    std::unique_ptr<CheckpointManager> checkpoints;
+    if (cfg.contains("checkpoint") && cfg["checkpoint"].value("enabled", false)) {
+        auto& cc = cfg["checkpoint"];
+        CheckpointManager::Options copts;
+        copts.path = cc.value("path", copts.path.string());
+        copts.interval_ms = cc.value("interval_ms", copts.interval_ms);
+        checkpoints = std::make_unique<CheckpointManager>(engine.metrics(), copts);
+    }
+
+    // Priority lanes: per-lane queues served by priority, then weighted round-robin
+    const bool lanes_enabled = cfg.contains("lanes") && cfg["lanes"].value("enabled", false);
+    if (lanes_enabled) {
+        auto& lc = cfg["lanes"];
+        std::vector<Engine::LaneSpec> lanes;
+        for (auto& l : lc.value("lanes", nlohmann::json::array())) {
+            Engine::LaneSpec spec;
+            spec.name = l.value("name", std::string("lane") + std::to_string(lanes.size()));
+            spec.capacity = l.value("capacity", queue_cap);
+            spec.priority = l.value("priority", spec.priority);
+            spec.weight = l.value("weight", spec.weight);
+            lanes.push_back(std::move(spec));
+        }
+        try {
+            engine.set_lanes(lanes, lc.value("default", lanes.empty() ? std::string() : lanes.back().name));
+            for (auto& kv : lc.value("sources", nlohmann::json::object()).items())
+                engine.assign_lane(kv.key(), kv.value().get<std::string>());
+        } catch (const std::exception& e) {
+            spdlog::error("Invalid lanes config: {}", e.what());
+            return 2;
+        }
+    }
+    // A source entry may name its lane with "lane"; checked before any source starts.
+    auto assign_lane = [&](const std::string& source, const nlohmann::json& sc) {
+        if (!lanes_enabled || !sc.contains("lane")) return true;
+        try {
+            engine.assign_lane(source, sc["lane"].get<std::string>());
+            return true;
+        } catch (const std::exception& e) {
+            spdlog::error("Source {}: {}", source, e.what());
+            return false;
+        }
+    };
+
+    // Example processor: add ingest_ts_ns (Unix ns) to payload. set_int keeps a raw payload unparsed.
+    engine.add_processor([](Event& ev){ ev.set_int("ingest_ts_ns", to_unix_ns(ev.tp)); }, "ingest_ts");
+
+    // Reference-data joins from memory-mapped tables, rebuilt when their file changes.
+    // They run before the transforms so filters can use the joined fields.
+    std::vector<std::shared_ptr<EnrichStage>> enrichers;
+    for (auto& ec : cfg.value("enrich", nlohmann::json::array())) {
+        EnrichStage::Options eopts;
+        eopts.name = ec.value("name", std::string("enrich") + std::to_string(enrichers.size()));
+        eopts.table = ec.value("table", std::string());
+        eopts.compiled = ec.value("compiled", std::string());
+        eopts.key_column = ec.value("key_column", eopts.key_column);
+        eopts.on = ec.value("on", std::string());
+        eopts.target = ec.value("target", std::string());
+        eopts.columns = ec.value("columns", eopts.columns);
+        eopts.poll_ms = ec.value("poll_ms", eopts.poll_ms);
+        try {
+            auto stage = std::make_shared<EnrichStage>(engine, eopts);
+            engine.add_processor([stage](Event& ev){ stage->process(ev); }, "enrich:" + eopts.name);
+            enrichers.push_back(std::move(stage));
+        } catch (const std::exception& e) {
+            spdlog::error("Enrich table {}: {}", eopts.name, e.what());
+            return 2;
+        }
+    }
+
+    // Config-driven filters/transforms, compiled once here
+    if (cfg.contains("transforms")) {
+        size_t n = 0;
+        for (auto& t : cfg["transforms"]) {
+            std::vector<std::pair<std::string, std::string>> set;
+            if (t.contains("set")) {
+                for (auto& kv : t["set"].items()) set.emplace_back(kv.key(), kv.value().get<std::string>());
+            }
+            try {
+                const std::string name = "transform " + std::to_string(n++);
+                auto tr = std::make_shared<ExpressionTransform>(
+                    t.value("filter", std::string()), set, t.value("when", std::string()),
+                    &engine.metrics().counter("crossbring_transform_conflicts_total",
+                                              "Transform assignments skipped because the payload path holds a non-object",
+                                              {{"transform", name}}));
+                engine.add_filter([tr](Event& ev){ return (*tr)(ev); }, name);
+            } catch (const std::exception& e) {
+                spdlog::error("Invalid transform: {}", e.what());
+                return 2;
+            }
+        }
+    }
+
+    // Complex event processing: per-partition pattern state machines emitting alerts
+    if (cfg.contains("cep") && cfg["cep"].value("enabled", false)) {
+        auto& cc = cfg["cep"];
+        CepStage::Options copts;
+        copts.shards = cc.value("shards", copts.shards);
+        copts.max_partials_per_shard = cc.value("max_partials_per_shard", copts.max_partials_per_shard);
+        copts.tick_ms = cc.value("tick_ms", copts.tick_ms);
+        std::vector<CepPattern> patterns;
+        for (auto& pc : cc.value("patterns", nlohmann::json::array())) {
+            CepPattern p;
+            p.name = pc.value("name", std::string("pattern") + std::to_string(patterns.size()));
+            p.scope = pc.value("scope", p.scope);
+            p.partition = pc.value("partition", p.partition);
+            p.within_ms = pc.value("within_ms", p.within_ms);
+            p.alert_source = pc.value("alert_source", p.alert_source);
+            for (auto& sc : pc.value("steps", nlohmann::json::array()))
+                p.steps.push_back({sc.value("when", std::string()), sc.value("times", 1u)});
+            patterns.push_back(std::move(p));
+        }
+        try {
+            auto cep = std::make_shared<CepStage>(engine, std::move(patterns), copts);
+            engine.add_processor([cep](Event& ev){ cep->process(ev); }, "cep");
+        } catch (const std::exception& e) {
+            spdlog::error("Invalid CEP pattern: {}", e.what());
+            return 2;
+        }
+    }
+
+    // Streaming sketches: per-source heavy hitters, distinct counts and quantiles on /stats
+    std::shared_ptr<SketchStage> sketches;
+    if (cfg.contains("sketches") && cfg["sketches"].value("enabled", false)) {
+        auto& sc = cfg["sketches"];
+        SketchStage::Options sopts;
+        sopts.shards = sc.value("shards", sopts.shards);
+        sopts.max_sources = sc.value("max_sources", sopts.max_sources);
+        sopts.heavy_hitters = sc.value("heavy_hitters", sopts.heavy_hitters);
+        sopts.distinct = sc.value("distinct", sopts.distinct);
+        sopts.quantile = sc.value("quantile", sopts.quantile);
+        sopts.quantiles = sc.value("quantiles", sopts.quantiles);
+        sopts.top_k = sc.value("top_k", sopts.top_k);
+        try {
+            sketches = std::make_shared<SketchStage>(engine, sopts);
+            engine.add_processor([sk = sketches](Event& ev){ sk->process(ev); }, "sketches");
+        } catch (const std::exception& e) {
+            spdlog::error("Invalid sketch expression: {}", e.what());
+            return 2;
+        }
+    }
 
     // Sinks
     auto add_sink = [&](std::shared_ptr<Sink> s)->std::shared_ptr<Sink>{
         // Optional batching wrapper
         if (cfg["sinks"].contains("batching") && cfg["sinks"]["batching"].value("enabled", false)) {
-            size_t bs = cfg["sinks"]["batching"].value("batch_size", 32);
-            int fm = cfg["sinks"]["batching"].value("flush_ms", 200);
-            s = std::make_shared<BatchingSink>(s, bs, fm);
+            auto& bc = cfg["sinks"]["batching"];
+            BatchingSink::Options bopts;
+            bopts.batch_size = bc.value("batch_size", bopts.batch_size);
+            bopts.flush_ms = bc.value("flush_ms", bopts.flush_ms);
+            bopts.max_batch_bytes = bc.value("max_batch_kb", size_t{0}) << 10;
+            bopts.max_bytes = mem_bytes("batch_max_mb");
+            s = std::make_shared<BatchingSink>(s, bopts);
         }
         engine.add_sink(s);
         return s;
@@ -82,25 +286,140 @@ int main(int argc, char** argv) {
         }
     }
 #endif
+#ifdef USE_SHM_RING
+    // Same-host consumers read from shared memory; batching would only add latency.
+    if (cfg["sinks"].contains("shm_ring") && cfg["sinks"]["shm_ring"].value("enabled", false)) {
+        auto& rc = cfg["sinks"]["shm_ring"];
+        ShmRingSink::Options ropts;
+        ropts.name = rc.value("name", ropts.name);
+        ropts.capacity = rc.value("capacity_mb", ropts.capacity >> 20) << 20;
+        ropts.max_readers = rc.value("max_readers", ropts.max_readers);
+        try {
+            engine.add_sink(std::make_shared<ShmRingSink>(ropts));
+            spdlog::info("Shared-memory ring sink at /dev/shm/{}", ropts.name);
+        } catch (const std::exception& e) {
+            spdlog::warn("Shared-memory ring sink init failed: {}", e.what());
+        }
+    }
+#endif
 #ifdef USE_SQLITE
+    // Time-partitioned history; also served by GET /history.
+    std::shared_ptr<SqliteStore> history;
     if (cfg["sinks"].contains("sqlite") && cfg["sinks"]["sqlite"].value("enabled", false)) {
-        auto path = cfg["sinks"]["sqlite"].value("path", std::string("data/events.sqlite"));
+        auto& sc = cfg["sinks"]["sqlite"];
+        SqliteStore::Options sopts;
+        sopts.dir = sc.value("dir", sopts.dir.string());
+        sopts.partition = sc.value("partition", sopts.partition);
+        sopts.retention_hours = sc.value("retention_hours", sopts.retention_hours);
+        sopts.index_on_write = sc.value("index_on_write", sopts.index_on_write);
+        sopts.open_partitions = sc.value("open_partitions", sopts.open_partitions);
         try {
-            add_sink(make_sqlite_sink(path));
-            spdlog::info("SQLite sink enabled at {}", path);
+            history = std::make_shared<SqliteStore>(sopts, engine.metrics());
+            add_sink(make_sqlite_sink(history));
+            spdlog::info("SQLite sink enabled at {} ({} partitions)", sopts.dir.string(), sopts.partition);
         } catch (const std::exception& e) {
             spdlog::warn("SQLite sink failed to initialize: {}", e.what());
         }
     }
 #endif
 
-    // Sources
+    // Rolling compressed archive segments. The sink batches into its own blocks,
+    // so it skips the batching wrapper.
+    if (cfg["sinks"].contains("archive") && cfg["sinks"]["archive"].value("enabled", false)) {
+        auto& ac = cfg["sinks"]["archive"];
+        ArchiveSink::Options aopts;
+        aopts.dir = ac.value("dir", aopts.dir.string());
+        aopts.prefix = ac.value("prefix", aopts.prefix);
+        aopts.level = ac.value("level", aopts.level);
+        aopts.block_bytes = ac.value("block_kb", aopts.block_bytes >> 10) << 10;
+        aopts.roll_bytes = ac.value("roll_mb", aopts.roll_bytes >> 20) << 20;
+        aopts.roll_seconds = ac.value("roll_seconds", aopts.roll_seconds);
+        aopts.flush_ms = ac.value("flush_ms", aopts.flush_ms);
+        aopts.io_threads = ac.value("io_threads", aopts.io_threads);
+        aopts.max_inflight_bytes = ac.value("max_inflight_mb", aopts.max_inflight_bytes >> 20) << 20;
+        try {
+            aopts.format = ArchiveSink::parse_format(ac.value("format", std::string("ndjson")));
+            aopts.codec = ArchiveSink::parse_codec(ac.value("codec", std::string("deflate")));
+            engine.add_sink(std::make_shared<ArchiveSink>(aopts));
+            spdlog::info("Archive sink writing to {}", aopts.dir.string());
+        } catch (const std::exception& e) {
+            spdlog::error("Archive sink: {}", e.what());
+            return 2;
+        }
+    }
+
+    // Per-source columnar segments for analytical export; batches on its own too.
+    if (cfg["sinks"].contains("columnar") && cfg["sinks"]["columnar"].value("enabled", false)) {
+        auto& cc = cfg["sinks"]["columnar"];
+        ColumnarSink::Options copts;
+        copts.dir = cc.value("dir", copts.dir.string());
+        copts.batch_rows = cc.value("batch_rows", copts.batch_rows);
+        copts.flush_ms = cc.value("flush_ms", copts.flush_ms);
+        copts.max_fields = cc.value("max_fields", copts.max_fields);
+        copts.max_depth = cc.value("max_depth", copts.max_depth);
+        try {
+            if (cc.contains("schemas")) {
+                for (auto& [source, fields] : cc["schemas"].items())
+                    for (auto& [field, type] : fields.items())
+                        copts.schemas[source][field] = parse_column_type(type.get<std::string>());
+            }
+            engine.add_sink(std::make_shared<ColumnarSink>(copts));
+            spdlog::info("Columnar sink writing to {}", copts.dir.string());
+        } catch (const std::exception& e) {
+            spdlog::error("Columnar sink: {}", e.what());
+            return 2;
+        }
+    }
+
+    // Compressed in-memory history of numeric payload fields (served on /series)
+    std::shared_ptr<TimeSeriesStore> tsdb;
+    if (cfg["sinks"].contains("tsdb") && cfg["sinks"]["tsdb"].value("enabled", false)) {
+        auto& tc = cfg["sinks"]["tsdb"];
+        TimeSeriesStore::Options topts;
+        topts.memory_budget_bytes = tc.value("memory_budget_mb", size_t{64}) << 20;
+        topts.points_per_chunk = tc.value("points_per_chunk", topts.points_per_chunk);
+        auto fields = tc.value("fields", std::vector<std::string>{"value"});
+        tsdb = std::make_shared<TimeSeriesStore>(topts, engine.metrics());
+        add_sink(std::make_shared<TimeSeriesSink>(tsdb, fields));
+    }
+
+    // Per source/key event history (served on /query)
+    std::shared_ptr<EventIndex> index;
+    if (cfg["sinks"].contains("index") && cfg["sinks"]["index"].value("enabled", false)) {
+        auto& ic = cfg["sinks"]["index"];
+        EventIndex::Options iopts;
+        iopts.max_events = ic.value("max_events", iopts.max_events);
+        iopts.max_per_key = ic.value("max_per_key", iopts.max_per_key);
+        index = std::make_shared<EventIndex>(iopts);
+        add_sink(std::make_shared<EventIndexSink>(index));
+    }
+
+    // Latest event per key (served on /state)
+    std::shared_ptr<StateStore> state;
+    if (cfg["sinks"].contains("state") && cfg["sinks"]["state"].value("enabled", false)) {
+        state = std::make_shared<StateStore>(cfg["sinks"]["state"].value("shards", size_t{64}));
+        add_sink(std::make_shared<StateSink>(state));
+        if (checkpoints) checkpoints->add("state", *state);
+    }
+
+    // Sources. Polling sources share the runtime's loop threads instead of one thread each.
+    SourceRuntime::Options ropts;
+    if (cfg["sources"].contains("runtime")) {
+        auto& rc = cfg["sources"]["runtime"];
+        ropts.threads = rc.value("threads", ropts.threads);
+        ropts.blocking_threads = rc.value("blocking_threads", ropts.blocking_threads);
+        ropts.tick_ms = rc.value("tick_ms", ropts.tick_ms);
+        ropts.cpus = rc.value("cpus", std::vector<int>{});
+    }
+    SourceRuntime runtime(engine.metrics(), ropts);
+
     std::vector<std::unique_ptr<SensorSimulator>> sensors;
     if (cfg["sources"].contains("sensors")) {
         for (auto& s : cfg["sources"]["sensors"]) {
             auto name = s.value("name", std::string("sensor"));
             int period = s.value("period_ms", 50);
-            sensors.emplace_back(std::make_unique<SensorSimulator>(engine, name, period));
+            if (!assign_lane(name, s)) return 2;
+            sensors.emplace_back(std::make_unique<SensorSimulator>(engine, runtime, name, period));
         }
     }
 
@@ -110,7 +429,10 @@ int main(int argc, char** argv) {
             auto src = f.value("source", std::string("file_json"));
             auto path = f.value("path", std::string("data/af_jobs.json"));
             int interval = f.value("interval_ms", 1000);
-            files.emplace_back(std::make_unique<FileJsonSource>(engine, src, path, interval));
+            auto parser = f.value("parser", std::string("auto"));
+            if (!assign_lane(src, f)) return 2;
+            files.emplace_back(std::make_unique<FileJsonSource>(engine, runtime, src, path, interval, parser));
+            if (checkpoints) checkpoints->add("file_json/" + src, *files.back());
         }
     }
 
@@ -118,14 +440,43 @@ int main(int argc, char** argv) {
 #ifdef USE_CPR
     std::unique_ptr<AfHttpsSource> af_https;
     if (cfg["sources"].contains("af_https") && cfg["sources"]["af_https"].value("enabled", false)) {
-        auto src = cfg["sources"]["af_https"].value("source", std::string("af_https"));
-        int interval = cfg["sources"]["af_https"].value("interval_ms", 5000);
-        std::string payload;
-        if (cfg["sources"]["af_https"].contains("payload") && cfg["sources"]["af_https"]["payload"].is_object())
-            payload = cfg["sources"]["af_https"]["payload"].dump();
+        auto& ac = cfg["sources"]["af_https"];
+        auto src = ac.value("source", std::string("af_https"));
+        AfHttpsSource::Options aopts;
+        aopts.url = ac.value("url", aopts.url);
+        aopts.interval_ms = ac.value("interval_ms", aopts.interval_ms);
+        if (ac.contains("payload") && ac["payload"].is_object())
+            aopts.payload = ac["payload"].dump();
         else
-            payload = cfg["sources"]["af_https"].value("payload", std::string("{}"));
-        af_https = std::make_unique<AfHttpsSource>(engine, src, payload, interval);
+            aopts.payload = ac.value("payload", aopts.payload);
+        aopts.parser = ac.value("parser", aopts.parser);
+        aopts.page_size = ac.value("page_size", aopts.page_size);
+        aopts.max_pages = ac.value("max_pages", aopts.max_pages);
+        aopts.cursor_field = ac.value("cursor_field", aopts.cursor_field);
+        aopts.timeout_ms = ac.value("timeout_ms", aopts.timeout_ms);
+        if (!assign_lane(src, ac)) return 2;
+        try {
+            af_https = std::make_unique<AfHttpsSource>(engine, runtime, src, aopts);
+            if (checkpoints) checkpoints->add("af_https/" + src, *af_https);
+        } catch (const std::exception& e) {
+            spdlog::warn("AF HTTPS source init failed: {}", e.what());
+        }
+    }
+#endif
+
+    // Line-protocol TCP/UDP source (optional)
+#ifdef USE_EPOLL
+    std::unique_ptr<LineProtocolSource> line_src;
+    if (cfg["sources"].contains("line_protocol") && cfg["sources"]["line_protocol"].value("enabled", false)) {
+        auto& lp = cfg["sources"]["line_protocol"];
+        LineProtocolSource::Options opts;
+        opts.host = lp.value("host", opts.host);
+        opts.tcp_port = lp.value("tcp_port", opts.tcp_port);
+        opts.udp_port = lp.value("udp_port", opts.udp_port);
+        opts.batch_size = lp.value("batch_size", opts.batch_size);
+        opts.max_connections = lp.value("max_connections", opts.max_connections);
+        opts.cpu = lp.value("cpu", opts.cpu);
+        line_src = std::make_unique<LineProtocolSource>(engine, opts);
     }
 #endif
 
@@ -134,31 +485,72 @@ int main(int argc, char** argv) {
     std::shared_ptr<EventHub> hub;
 #ifdef USE_HTTP_SERVER
     if (cfg.contains("http") && cfg["http"].value("enabled", true)) {
-        recent = std::make_shared<RecentBuffer>(cfg["http"].value("recent_capacity", 500));
+        recent = std::make_shared<RecentBuffer>(cfg["http"].value("recent_capacity", 500), mem_bytes("recent_max_mb"),
+                                                engine.memory().account("recent_buffer"));
         add_sink(std::make_shared<RecentBufferSink>(recent));
-        hub = std::make_shared<EventHub>();
+        if (checkpoints) checkpoints->add("recent", *recent);
+        hub = std::make_shared<EventHub>(mem_bytes("sse_queue_max_mb"), engine.memory().account("sse_queues"));
         add_sink(std::make_shared<EventHubSink>(hub));
     }
 #endif
 
+    if (checkpoints) {
+        checkpoints->restore();
+        checkpoints->start();
+    }
     engine.start();
+    for (auto& e : enrichers) e->start();
+    runtime.start();
     for (auto& s : sensors) s->start();
     for (auto& f : files) f->start();
 #ifdef USE_CPR
     if (af_https) af_https->start();
 #endif
+#ifdef USE_EPOLL
+    if (line_src) {
+        try {
+            line_src->start();
+        } catch (const std::exception& e) {
+            spdlog::warn("Line-protocol source failed to start: {}", e.what());
+            line_src.reset();
+        }
+    }
+#endif
 
     std::signal(SIGINT, on_sigint);
 #ifdef SIGTERM
     std::signal(SIGTERM, on_sigint);
 #endif
 
-    std::unique_ptr<HttpServer> http;
 #ifdef USE_HTTP_SERVER
+    std::unique_ptr<HttpServer> http;
     if (recent) {
         std::string host = cfg["http"].value("host", std::string("127.0.0.1"));
         int port = cfg["http"].value("port", 9100);
         http = std::make_unique<HttpServer>(engine, recent, host, port, hub);
+        if (index) http->set_event_index(index);
+        if (state) http->set_state_store(state);
+        if (sketches) http->set_sketches(sketches);
+#ifdef USE_SQLITE
+        if (history) http->set_history(history);
+#endif
+        if (tsdb) http->set_time_series(tsdb);
+        auto& hc = cfg["http"];
+        HttpServer::ServerOptions sopts;
+        sopts.threads = hc.value("threads", sopts.threads);
+        sopts.keep_alive_max = hc.value("keep_alive_max", sopts.keep_alive_max);
+        sopts.keep_alive_timeout_s = hc.value("keep_alive_timeout_s", sopts.keep_alive_timeout_s);
+        if (hc.contains("ingest") && hc["ingest"].value("enabled", false)) {
+            auto& ic = hc["ingest"];
+            IngestHandler::Options iopts;
+            iopts.source = ic.value("source", iopts.source);
+            iopts.batch_size = ic.value("batch_size", iopts.batch_size);
+            iopts.max_clients = ic.value("max_clients", iopts.max_clients);
+            sopts.max_body_bytes = ic.value("max_body_mb", sopts.max_body_bytes >> 20) << 20;
+            http->set_ingest(std::make_shared<IngestHandler>(engine, iopts));
+            spdlog::info("HTTP ingestion on POST /ingest (source '{}')", iopts.source);
+        }
+        http->set_server_options(sopts);
         http->start();
         spdlog::info("HTTP server on http://{}:{}/", host, port);
     }
@@ -174,8 +566,16 @@ int main(int argc, char** argv) {
 #ifdef USE_CPR
     if (af_https) af_https->stop();
 #endif
+    runtime.stop();
+#ifdef USE_EPOLL
+    if (line_src) line_src->stop();
+#endif
+#ifdef USE_HTTP_SERVER
     if (http) http->stop();
+#endif
     engine.stop();
+    for (auto& e : enrichers) e->stop();
+    if (checkpoints) checkpoints->stop(); // final checkpoint, after the engine processed its queue
     spdlog::info("Shutdown complete. processed={} dropped={}", engine.processed_count(), engine.dropped_count());
     return 0;
 }
@@ -0,0 +1,37 @@
+#ifdef __linux__
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "crossbring/transport/shm_ring.h"
+
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : std::string("crossbring");
+    while (true) {
+        std::unique_ptr<crossbring::ShmRingReader> reader;
+        try {
+            reader = std::make_unique<crossbring::ShmRingReader>(name);
+        } catch (const std::exception& e) {
+            std::cerr << "Attach failed: " << e.what() << ", retrying\n";
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        std::cerr << "Attached to /dev/shm/" << name << ". Ctrl+C to exit.\n";
+        while (true) {
+            if (!reader->wait(std::chrono::seconds(1))) {
+                if (reader->closed()) break;
+                continue;
+            }
+            reader->poll([](std::string_view msg) { std::cout << msg << std::endl; });
+        }
+        std::cerr << "Ring closed, reattaching\n";
+    }
+    return 0;
+}
+
+#else
+int main(){return 0;}
+#endif
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace crossbring {
+
+// Pins the calling thread to one CPU. Returns false where unsupported or on failure.
+bool pin_current_thread(int cpu);
+
+// Makes later allocations of the calling thread come from its local NUMA node.
+// Requires a build with ENABLE_NUMA; returns false otherwise.
+bool bind_memory_local();
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power while polling.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+} // namespace crossbring
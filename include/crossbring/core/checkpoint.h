@@ -0,0 +1,151 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+namespace crossbring {
+
+// Length-prefixed binary encoding for checkpoint sections, in native byte order.
+class SnapshotWriter {
+public:
+    void u8(uint8_t v) { out_.push_back(static_cast<char>(v)); }
+    void u64(uint64_t v) { put(&v, sizeof(v)); }
+    void i64(int64_t v) { put(&v, sizeof(v)); }
+    void str(std::string_view s) {
+        u64(s.size());
+        put(s.data(), s.size());
+    }
+
+    std::string& buffer() { return out_; }
+
+private:
+    void put(const void* p, size_t n) { out_.append(static_cast<const char*>(p), n); }
+    std::string out_;
+};
+
+// Reads what SnapshotWriter wrote. Strings are views into the snapshot, which
+// stays mapped only for the duration of restore(). Throws std::runtime_error
+// on a truncated section.
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::string_view data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+    uint8_t u8() {
+        need(1);
+        return static_cast<uint8_t>(*p_++);
+    }
+    uint64_t u64() { return get<uint64_t>(); }
+    int64_t i64() { return get<int64_t>(); }
+    std::string_view str() {
+        const uint64_t n = u64();
+        need(n);
+        std::string_view s(p_, static_cast<size_t>(n));
+        p_ += n;
+        return s;
+    }
+    bool done() const { return p_ == end_; }
+
+private:
+    template <typename T> T get() {
+        need(sizeof(T));
+        T v;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+    void need(uint64_t n) const {
+        if (n > static_cast<uint64_t>(end_ - p_)) throw std::runtime_error("checkpoint section truncated");
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// State that survives a restart through the CheckpointManager.
+class Checkpointable {
+public:
+    virtual ~Checkpointable() = default;
+    // Changes whenever the state does; an unchanged component is not encoded again.
+    virtual uint64_t checkpoint_version() const = 0;
+    // Runs on the checkpoint thread. Copy what is needed under the component's
+    // lock (references to immutable data, ideally) and encode outside it.
+    virtual void checkpoint(SnapshotWriter& out) const = 0;
+    // Runs before the component starts.
+    virtual void restore(SnapshotReader& in) = 0;
+};
+
+// Writes registered components into one snapshot file every `interval_ms`,
+// from its own thread, and restores them from it at startup.
+//
+// The file is a header followed by one section per component (name, state
+// version, length, checksum, payload), written to `<path>.tmp` and renamed
+// over the previous snapshot. A component whose version did not change is not
+// encoded again; its bytes from the previous snapshot are reused, and nothing
+// is written when no component changed. restore() maps the file;
+// a section that fails its checksum or does not decode is skipped, leaving that
+// component cold.
+class CheckpointManager {
+public:
+    struct Options {
+        std::filesystem::path path = "data/engine.ckpt";
+        int interval_ms = 10000;
+    };
+
+    CheckpointManager(MetricsRegistry& reg, Options opts);
+    ~CheckpointManager();
+    CheckpointManager(const CheckpointManager&) = delete;
+    CheckpointManager& operator=(const CheckpointManager&) = delete;
+
+    // Components must outlive the manager (or its stop()). Register before restore().
+    void add(std::string name, Checkpointable& component);
+
+    // Restores every registered component found in the snapshot; returns how many.
+    size_t restore();
+
+    void start();
+    // Stops the thread and takes a final checkpoint.
+    void stop();
+    // Writes a snapshot now if anything changed. Returns false on I/O errors.
+    bool checkpoint();
+
+private:
+    struct Entry {
+        std::string name;
+        Checkpointable* component;
+        bool written = false;
+        uint64_t version = 0;
+        std::string bytes; // last encoded section payload
+    };
+
+    void run();
+
+    Options opts_;
+    std::mutex mu_; // entries_ and checkpoint()
+    std::vector<Entry> entries_;
+    bool dirty_ = false; // sections changed since the last successful write
+
+    std::mutex run_mu_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    Counter& snapshots_;
+    Counter& sections_;
+    Counter& errors_;
+    Gauge& bytes_;
+    Histogram& seconds_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace crossbring {
+
+// Events carry steady-clock time points, which restart at boot. Anything that
+// leaves the process (files, the HTTP API) uses Unix ns instead. The offset
+// between the two clocks is taken once per process, so converted times keep
+// the steady clock's order within a run.
+int64_t unix_now_ns();
+int64_t to_unix_ns(std::chrono::steady_clock::time_point tp);
+// For internal clocks kept as steady-clock ns (e.g. Tracer::now_ns()).
+int64_t steady_to_unix_ns(int64_t ns);
+int64_t unix_to_steady_ns(int64_t ns);
+
+} // namespace crossbring
@@ -1,15 +1,22 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
 #include "crossbring/event.h"
+#include "memory.h"
+#include "metrics.h"
 #include "queue.h"
+#include "tracing.h"
 
 namespace crossbring {
 
@@ -18,34 +25,154 @@ class Sink;
 class Engine {
 public:
     using Processor = std::function<void(Event&)>; // in-place mutation allowed
+    using Filter = std::function<bool(Event&)>;    // may mutate; false drops the event
 
-    explicit Engine(size_t queue_capacity = 1024, size_t workers = std::thread::hardware_concurrency(), bool drop_on_full = false);
+    // What submit() does when the queue is full. Conflate replaces the pending
+    // event with the same source and key, so queued events are bounded by key
+    // cardinality; an event for a new key is dropped when the queue is full.
+    enum class Backpressure { Block, Drop, Conflate };
+
+    // Low-latency knobs; the defaults keep plain threads that park right away.
+    struct WorkerOptions {
+        std::vector<int> cpus;    // worker i is pinned to cpus[i % cpus.size()]; empty = no pinning
+        bool numa_local = false;  // allocate from the pinned CPU's NUMA node (ENABLE_NUMA builds)
+        uint32_t spin_us = 0;     // busy-poll the queue this long before parking
+    };
+
+    // Elastic pool: a controller adds a worker while the queue is deep or its oldest
+    // event has waited too long, and retires one after sustained idleness.
+    struct ElasticOptions {
+        bool enabled = false;
+        size_t min_workers = 1;
+        size_t max_workers = 8;
+        size_t grow_queue_depth = 256;
+        uint32_t grow_wait_us = 2000;
+        uint32_t shrink_idle_ms = 5000;  // a worker sat parked this long
+        uint32_t interval_ms = 100;
+    };
+
+    // Byte accounting. With a limit, submit() treats an exhausted budget like a
+    // full queue: block mode waits, the other modes drop.
+    struct MemoryOptions {
+        bool enabled = false;
+        size_t limit_bytes = 0;     // process-wide budget, 0 = account only
+        size_t queue_max_bytes = 0; // engine queue bound next to queue_capacity, 0 = none
+    };
+
+    // Queue lanes; see BoundedQueue. Each lane has its own capacity and events
+    // are routed by source, so a bulk load in one lane cannot delay another.
+    using LaneSpec = BoundedQueue<Event>::LaneSpec;
+
+    explicit Engine(size_t queue_capacity = 1024, size_t workers = std::thread::hardware_concurrency(), Backpressure backpressure = Backpressure::Block);
     ~Engine();
 
     void start();
+    // Refuses new events, then lets the workers finish everything already queued
+    // before joining them, so sources may treat a submitted event as handled.
     void stop();
+    // Set before start().
+    void set_worker_options(WorkerOptions opts) { worker_opts_ = std::move(opts); }
+    void set_elastic(ElasticOptions opts) { elastic_ = opts; }
+    // Call before adding sinks so they can open their memory accounts.
+    void set_memory_options(const MemoryOptions& opts);
+    // Replaces the single queue with `lanes`. Sources without an assignment go to
+    // `default_lane`. Both throw std::invalid_argument for unknown lane names.
+    void set_lanes(const std::vector<LaneSpec>& lanes, const std::string& default_lane);
+    void assign_lane(const std::string& source, const std::string& lane);
+    // Sampled per-event tracing; see Tracer. Set before start().
+    void set_tracing(const Tracer::Options& opts) { tracer_.configure(opts); }
 
     bool submit(Event ev);
+    // Never blocks, whatever the backpressure mode; for producers running on a
+    // worker thread (e.g. derived events), where waiting could deadlock.
+    bool try_submit(Event ev);
+    // Submits a batch under one queue lock; events are moved out and `evs` is cleared.
+    // Returns the number accepted; the rest count as dropped.
+    size_t submit_batch(std::vector<Event>& evs);
+    // Never blocks. Takes events in order up to the first one that does not fit,
+    // so the accepted ones are a prefix of `evs`; the rest count as dropped.
+    size_t try_submit_batch(std::vector<Event>& evs);
+    bool running() const { return running_.load(std::memory_order_relaxed); }
 
-    void add_processor(Processor p);
+    // Safe at any time: workers pick up the new pipeline before their next event.
+    // `name` labels the stage in traces; it defaults to "processor N" / "filter N".
+    void add_processor(Processor p, const std::string& name = {});
+    void add_filter(Filter f, const std::string& name = {});
     void add_sink(std::shared_ptr<Sink> sink);
 
     // Metrics
-    uint64_t processed_count() const { return processed_.load(std::memory_order_relaxed); }
-    uint64_t dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t processed_count() const { return processed_.value(); }
+    uint64_t dropped_count() const { return dropped_.value(); }
     size_t queue_size() const { return queue_.size(); }
+    size_t worker_count() const;
+    // Registry rendered on /metrics; sources and sinks register their series here.
+    MetricsRegistry& metrics() { return metrics_; }
+    MemoryBudget& memory() { return memory_; }
+    Tracer& tracer() { return tracer_; }
 
 private:
-    void worker_loop();
+    // Immutable once published; writers copy, modify and swap in a new one.
+    struct Pipeline {
+        std::vector<Filter> stages;        // processors and filters in registration order
+        std::vector<uint32_t> stage_spans; // parallel to stages: interned trace names
+        std::vector<std::shared_ptr<Sink>> sinks;
+        std::vector<Counter*> sink_events; // parallel to sinks
+        std::vector<uint8_t> retains;      // parallel to sinks: Sink::retains_events()
+        std::vector<uint32_t> sink_spans;  // parallel to sinks: interned trace names
+        size_t retaining = 0;
+    };
+    struct Worker {
+        std::thread th;
+        std::atomic<bool> retire{false};
+        std::atomic<bool> exited{false};
+    };
 
+    void worker_loop(size_t slot, Worker& self);
+    std::optional<Event> spin_pop(int64_t budget_ns, Counter& spin_ns, BoundedQueue<Event>::PopInfo& info);
+    void count_dropped(const std::vector<Event>& evs, size_t from, size_t to);
+    uint64_t trace_batch(std::vector<Event>& evs);
+    bool submit_conflated(Event& ev);
+    bool admit(bool may_wait);
+    size_t lane_of(const std::string& source) const;
+    size_t lane_index(const std::string& name) const;
+    template <typename Fn> void update_pipeline(Fn&& fn);
+    bool spawn_worker_locked();
+    void controller_loop();
+
+    MetricsRegistry metrics_; // declared first: outlives the sinks that hold handles into it
+    MemoryBudget memory_;
+    Tracer tracer_;
+    const uint32_t submit_span_;
+    const uint32_t queue_span_;
+    const uint32_t process_span_;
+    Counter& processed_;
+    Counter& dropped_;
+    CounterVec& source_events_;
+    CounterVec& source_dropped_;
+    Counter& filtered_;
+    Counter& failed_;
+    Counter& conflated_;
+    CounterVec& source_conflated_;
+    Counter& budget_waits_;
+    Gauge& workers_gauge_;
     BoundedQueue<Event> queue_;
-    std::vector<std::thread> workers_;
-    std::vector<Processor> processors_;
-    std::vector<std::shared_ptr<Sink>> sinks_;
+    std::unordered_map<std::string, size_t> source_lanes_; // fixed before start()
+    size_t default_lane_ = 0;
+    size_t fixed_workers_;
+
+    std::mutex pipeline_mu_;                   // serializes writers
+    std::shared_ptr<const Pipeline> pipeline_; // read with std::atomic_load
+    std::atomic<uint64_t> pipeline_version_{0};
+
+    mutable std::mutex pool_mu_;
+    std::vector<std::unique_ptr<Worker>> slots_; // index = worker label; null = free
+    std::thread controller_;
+    std::condition_variable controller_cv_;
+
     std::atomic<bool> running_{false};
-    std::atomic<uint64_t> processed_{0};
-    std::atomic<uint64_t> dropped_{0};
-    bool drop_on_full_{false};
+    WorkerOptions worker_opts_;
+    ElasticOptions elastic_;
+    Backpressure backpressure_;
 };
 
 } // namespace crossbring
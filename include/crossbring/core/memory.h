@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "crossbring/event.h"
+#include "metrics.h"
+
+namespace crossbring {
+
+// Rough heap footprint of a value: container and string capacities plus node
+// overheads of a typical allocator. Cheap enough to run once per event on
+// enqueue; callers keep the number so the release matches the charge.
+size_t approx_bytes(const nlohmann::json& j);
+size_t approx_bytes(const Event& ev);
+
+// Process-wide byte accounting. Components that hold events (queues, buffers)
+// charge what they hold to a named account, exported as
+// crossbring_memory_bytes{component}. Ingress checks over_limit() and applies
+// backpressure before the process outgrows the configured limit.
+class MemoryBudget {
+public:
+    class Account {
+    public:
+        void charge(size_t n) {
+            bytes_.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed);
+            budget_.used_.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed);
+        }
+        void release(size_t n) {
+            bytes_.fetch_sub(static_cast<int64_t>(n), std::memory_order_relaxed);
+            budget_.released(static_cast<int64_t>(n));
+        }
+        int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class MemoryBudget;
+        explicit Account(MemoryBudget& b) : budget_(b) {}
+        MemoryBudget& budget_;
+        alignas(64) std::atomic<int64_t> bytes_{0};
+    };
+
+    explicit MemoryBudget(MetricsRegistry& reg) : reg_(reg) {}
+
+    // limit 0 means no limit. Accounting is off until enabled, so components skip
+    // size estimation entirely in the default configuration.
+    void configure(bool enabled, size_t limit_bytes);
+    bool enabled() const { return enabled_; }
+    size_t limit() const { return limit_; }
+    int64_t used() const { return used_.load(std::memory_order_relaxed); }
+    bool over_limit() const { return limit_ > 0 && used() >= static_cast<int64_t>(limit_); }
+
+    // Same name returns the same account; valid for the budget's lifetime.
+    // Returns nullptr while accounting is disabled.
+    Account* account(const std::string& component);
+
+    // Waits until usage drops below the limit or `timeout` passes; true if there is room.
+    bool wait_for_room(std::chrono::milliseconds timeout);
+
+private:
+    void released(int64_t n) {
+        const int64_t before = used_.fetch_sub(n, std::memory_order_relaxed);
+        // Only the release that crosses back under the limit pays for the wakeup.
+        if (limit_ > 0 && before >= static_cast<int64_t>(limit_) && before - n < static_cast<int64_t>(limit_)) {
+            { std::lock_guard<std::mutex> lock(wait_mu_); }
+            wait_cv_.notify_all();
+        }
+    }
+
+    MetricsRegistry& reg_;
+    bool enabled_ = false;
+    size_t limit_ = 0;
+    alignas(64) std::atomic<int64_t> used_{0};
+    std::mutex mu_; // guards accounts_
+    std::map<std::string, std::unique_ptr<Account>> accounts_;
+    std::mutex wait_mu_;
+    std::condition_variable wait_cv_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crossbring {
+
+class MetricsRegistry;
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+namespace detail {
+// Small per-thread index used to pick a counter shard. Threads are numbered in
+// creation order, so up to kMetricShards threads never share a cache line.
+constexpr size_t kMetricShards = 16;
+inline size_t metric_shard() {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t idx = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return idx;
+}
+} // namespace detail
+
+// Monotonic counter split over cache-line-padded cells. Each thread adds to its
+// own cell; the cells are only summed when the value is read (on scrape).
+class Counter {
+public:
+    void inc(uint64_t n = 1) { cells_[detail::metric_shard()].v.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const {
+        uint64_t sum = 0;
+        for (auto& c : cells_) sum += c.v.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+private:
+    struct alignas(64) Cell { std::atomic<uint64_t> v{0}; };
+    std::array<Cell, detail::kMetricShards> cells_;
+};
+
+// Point-in-time value. Meant for state changes (connections, batches in flight),
+// not per-event updates; use a Counter for those.
+class Gauge {
+public:
+    void set(int64_t v) { v_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n = 1) { v_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1) { v_.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<int64_t> v_{0};
+};
+
+// Cumulative-bucket histogram (Prometheus `_bucket`/`_sum`/`_count`). Buckets are
+// plain atomics without sharding, so give each writer thread its own labeled
+// series (e.g. per worker) when observing on a hot path.
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds_.size() && v > bounds_[i]) ++i;
+        counts_[i].fetch_add(1, std::memory_order_relaxed);
+        double cur = sum_.load(std::memory_order_relaxed);
+        while (!sum_.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {}
+    }
+    const std::vector<double>& bounds() const { return bounds_; }
+    uint64_t bucket(size_t i) const { return counts_[i].load(std::memory_order_relaxed); } // i == bounds().size() is +Inf
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    // 1us .. ~1s in roughly 2.5x steps, in seconds.
+    static std::vector<double> latency_bounds();
+
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<double> sum_{0.0};
+};
+
+// Counters of one family that differ in a single label (e.g. per source name).
+// with() takes a shared lock; hot loops should keep the returned reference.
+class CounterVec {
+public:
+    Counter& with(const std::string& value);
+
+private:
+    friend class MetricsRegistry;
+    CounterVec(MetricsRegistry& reg, std::string name, std::string help, std::string label, Labels base)
+        : reg_(reg), name_(std::move(name)), help_(std::move(help)), label_(std::move(label)), base_(std::move(base)) {}
+
+    MetricsRegistry& reg_;
+    std::string name_, help_, label_;
+    Labels base_;
+    std::shared_mutex mu_;
+    std::unordered_map<std::string, Counter*> cache_;
+};
+
+// Named, labeled metric series rendered as Prometheus text. Registration returns
+// a stable reference that stays valid for the registry's lifetime, so callers look
+// a series up once and update it without allocating or locking afterwards.
+// Registering the same name and labels again returns the existing series.
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {},
+                         std::vector<double> bounds = Histogram::latency_bounds());
+    // Gauge computed at scrape time (e.g. queue depth). fn must stay callable while
+    // the registry is scraped.
+    void gauge_fn(const std::string& name, const std::string& help, const Labels& labels, std::function<double()> fn);
+    CounterVec& counter_vec(const std::string& name, const std::string& help, const std::string& label,
+                            const Labels& base = {});
+
+    void write(std::ostream& os) const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+    struct Series {
+        std::string labels; // rendered `{k="v",...}` or empty
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> fn;
+    };
+    struct Family {
+        std::string help;
+        Type type;
+        std::vector<Series> series;
+    };
+
+    Series& series(const std::string& name, const std::string& help, Type type, const Labels& labels);
+
+    mutable std::mutex mu_;
+    std::map<std::string, Family> families_;
+    std::vector<std::unique_ptr<CounterVec>> vecs_;
+};
+
+} // namespace crossbring
@@ -1,43 +1,244 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "memory.h"
 
 namespace crossbring {
 
-// Simple bounded MPMC queue with condition variables
+// Simple bounded MPMC queue with condition variables. Items are stamped on
+// enqueue so consumers can see how long they waited. Items pushed with a key
+// (push_or_replace) are conflated: a newer item replaces the pending one for
+// the same key in place. An optional byte capacity bounds the estimated size
+// of queued items alongside their count.
+//
+// The queue may be split into lanes, each with its own capacity, so a bulk
+// producer filling one lane never blocks producers on another. Consumers take
+// from the highest-priority non-empty lane; lanes sharing a priority are served
+// by deficit round-robin, `weight` items per turn.
 template <typename T>
 class BoundedQueue {
 public:
-    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+    enum class PushResult { Queued, Replaced, Full, Stopped };
+
+    struct PopInfo {
+        int64_t wait_ns = 0;   // time the item spent queued
+        int64_t wake_ns = -1;  // producer notify -> this consumer running; -1 if it did not park
+        size_t lane = 0;       // lane the item came from
+    };
+
+    struct LaneSpec {
+        std::string name;
+        size_t capacity = 1024;
+        int priority = 0;    // higher is served first
+        uint32_t weight = 1; // items per round among lanes of equal priority
+    };
+
+    // One lane named "default".
+    explicit BoundedQueue(size_t capacity) { set_lanes({LaneSpec{"default", capacity, 0, 1}}); }
+
+    // Call before first use; replaces the lanes. Lane indexes follow `specs`.
+    void set_lanes(const std::vector<LaneSpec>& specs) {
+        lane_count_ = specs.empty() ? 1 : specs.size();
+        lanes_.reset(new Lane[lane_count_]);
+        for (size_t i = 0; i < specs.size(); ++i) {
+            lanes_[i].spec = specs[i];
+            if (lanes_[i].spec.weight == 0) lanes_[i].spec.weight = 1;
+        }
+        rr_ = 0;
+    }
+    size_t lane_count() const { return lane_count_; }
+    const LaneSpec& lane(size_t i) const { return lanes_[i].spec; }
+
+    // Call before first use. `size_of` runs once per item, outside the lock; each
+    // lane admits items while their total stays within max_bytes (0 = no byte
+    // bound, accounting only) and always admits one item into an empty lane.
+    void set_byte_capacity(size_t max_bytes, std::function<size_t(const T&)> size_of,
+                           MemoryBudget::Account* account = nullptr) {
+        max_bytes_ = max_bytes;
+        size_of_ = std::move(size_of);
+        account_ = account;
+    }
 
-    bool push(T item) {
+    // push/try_push only move from `item` when they succeed.
+    bool push(T&& item, size_t lane = 0) {
+        const int64_t now = now_ns();
+        const size_t bytes = size_of_ ? size_of_(item) : 0;
+        Lane& l = lanes_[lane];
         std::unique_lock<std::mutex> lock(m_);
-        not_full_cv_.wait(lock, [&]{ return stop_ || q_.size() < capacity_; });
+        l.not_full_cv.wait(lock, [&]{ return stop_ || has_room_locked(l, bytes); });
         if (stop_) return false;
-        q_.push(std::move(item));
+        l.q.push_back(Slot{std::move(item), now, bytes, {}});
+        pushed_locked(l, 1, bytes);
         not_empty_cv_.notify_one();
         return true;
     }
 
-    bool try_push(T item) {
+    bool try_push(T&& item, size_t lane = 0) {
+        const int64_t now = now_ns();
+        const size_t bytes = size_of_ ? size_of_(item) : 0;
+        Lane& l = lanes_[lane];
         std::lock_guard<std::mutex> lock(m_);
-        if (stop_ || q_.size() >= capacity_) return false;
-        q_.push(std::move(item));
+        if (stop_ || !has_room_locked(l, bytes)) return false;
+        l.q.push_back(Slot{std::move(item), now, bytes, {}});
+        pushed_locked(l, 1, bytes);
         not_empty_cv_.notify_one();
         return true;
     }
 
-    std::optional<T> pop() {
+    // Replaces the pending item for `key` if there is one, keeping its place in
+    // line and its enqueue stamp; otherwise queues the item if there is room.
+    // Never blocks. On Replaced, `item` is swapped with the superseded item so
+    // the caller frees it outside the lock; on Full/Stopped it is untouched.
+    PushResult push_or_replace(const std::string& key, T& item, size_t lane = 0) {
+        const size_t bytes = size_of_ ? size_of_(item) : 0;
+        Lane& l = lanes_[lane];
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            if (stop_) return PushResult::Stopped;
+            auto it = l.keyed.find(key);
+            if (it != l.keyed.end()) {
+                Slot& pending = l.q[static_cast<size_t>(it->second - l.head_seq)];
+                std::swap(pending.item, item);
+                l.bytes += bytes - pending.bytes;
+                if (account_) {
+                    account_->charge(bytes);
+                    account_->release(pending.bytes);
+                }
+                pending.bytes = bytes;
+                return PushResult::Replaced;
+            }
+            if (!has_room_locked(l, bytes)) return PushResult::Full;
+            l.keyed.emplace(key, l.head_seq + l.q.size());
+            l.q.push_back(Slot{std::move(item), now_ns(), bytes, key});
+            pushed_locked(l, 1, bytes);
+        }
+        not_empty_cv_.notify_one();
+        return PushResult::Queued;
+    }
+
+    // Moves [first, last) in, waiting for space as needed. Returns the number
+    // pushed (less than the range only if the queue was stopped).
+    template <typename It>
+    size_t push_bulk(It first, It last, size_t lane = 0) {
+        const std::vector<size_t>& sizes = sizes_of(first, last);
+        Lane& l = lanes_[lane];
+        size_t n = 0;
         std::unique_lock<std::mutex> lock(m_);
-        not_empty_cv_.wait(lock, [&]{ return stop_ || !q_.empty(); });
-        if (stop_ && q_.empty()) return std::nullopt;
-        T item = std::move(q_.front());
-        q_.pop();
-        not_full_cv_.notify_one();
-        return item;
+        while (first != last) {
+            l.not_full_cv.wait(lock, [&]{ return stop_ || has_room_locked(l, sizes[n]); });
+            if (stop_) break;
+            const int64_t now = now_ns();
+            size_t pushed = 0, bytes = 0;
+            for (; first != last && has_room_locked(l, sizes[n + pushed]); ++first, ++pushed) {
+                const size_t b = sizes[n + pushed];
+                l.q.push_back(Slot{std::move(*first), now, b, {}});
+                l.bytes += b;
+                bytes += b;
+            }
+            pushed_locked(l, pushed, 0);
+            if (account_) account_->charge(bytes);
+            n += pushed;
+            if (pushed == 1) not_empty_cv_.notify_one(); else not_empty_cv_.notify_all();
+        }
+        return n;
+    }
+
+    // Moves in as many of [first, last) as fit without waiting.
+    template <typename It>
+    size_t try_push_bulk(It first, It last, size_t lane = 0) {
+        const std::vector<size_t>& sizes = sizes_of(first, last);
+        Lane& l = lanes_[lane];
+        size_t n = 0, bytes = 0;
+        const int64_t now = now_ns();
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            if (stop_) return 0;
+            for (; first != last && has_room_locked(l, sizes[n]); ++first, ++n) {
+                l.q.push_back(Slot{std::move(*first), now, sizes[n], {}});
+                l.bytes += sizes[n];
+                bytes += sizes[n];
+            }
+            if (n > 0) pushed_locked(l, n, 0);
+            if (account_) account_->charge(bytes);
+        }
+        if (n == 1) not_empty_cv_.notify_one(); else if (n > 1) not_empty_cv_.notify_all();
+        return n;
+    }
+
+    // Blocks until an item is available or the queue is stopped.
+    std::optional<T> pop(PopInfo* info = nullptr) {
+        std::unique_lock<std::mutex> lock(m_);
+        bool parked = false;
+        while (!stop_ && size_ == 0) {
+            ++waiters_;
+            not_empty_cv_.wait(lock);
+            --waiters_;
+            parked = true;
+        }
+        if (size_ == 0) return std::nullopt;
+        return take_locked(info, parked);
+    }
+
+    // Like pop(), but gives up after `timeout` so the caller can re-check its own state.
+    template <typename Rep, typename Period>
+    std::optional<T> pop_for(std::chrono::duration<Rep, Period> timeout, PopInfo* info = nullptr) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::unique_lock<std::mutex> lock(m_);
+        bool parked = false;
+        while (!stop_ && size_ == 0) {
+            ++waiters_;
+            auto st = not_empty_cv_.wait_until(lock, deadline);
+            --waiters_;
+            parked = true;
+            if (st == std::cv_status::timeout) break;
+        }
+        if (size_ == 0) return std::nullopt;
+        return take_locked(info, parked);
+    }
+
+    std::optional<T> try_pop(PopInfo* info = nullptr) {
+        std::lock_guard<std::mutex> lock(m_);
+        if (size_ == 0) return std::nullopt;
+        return take_locked(info, false);
+    }
+
+    // Age of the oldest queued item over all lanes, 0 when empty.
+    int64_t oldest_wait_ns() const {
+        std::lock_guard<std::mutex> lock(m_);
+        int64_t oldest = 0;
+        const int64_t now = now_ns();
+        for (size_t i = 0; i < lane_count_; ++i) {
+            if (!lanes_[i].q.empty()) oldest = std::max(oldest, now - lanes_[i].q.front().enq_ns);
+        }
+        return oldest;
+    }
+
+    // Consumers currently parked in pop()/pop_for().
+    size_t waiters() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return waiters_;
+    }
+
+    // Lock-free size estimate for pollers deciding whether try_pop() is worth it.
+    size_t size_hint() const { return size_hint_.load(std::memory_order_relaxed); }
+
+    // After stop() no push succeeds, so a stopped queue that is empty stays empty.
+    bool stopped() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return stop_;
     }
 
     void stop() {
@@ -46,21 +247,146 @@ public:
             stop_ = true;
         }
         not_empty_cv_.notify_all();
-        not_full_cv_.notify_all();
+        for (size_t i = 0; i < lane_count_; ++i) lanes_[i].not_full_cv.notify_all();
     }
 
     size_t size() const {
         std::lock_guard<std::mutex> lock(m_);
-        return q_.size();
+        return size_;
+    }
+
+    size_t lane_size(size_t lane) const {
+        std::lock_guard<std::mutex> lock(m_);
+        return lanes_[lane].q.size();
+    }
+
+    // Estimated bytes queued; 0 unless set_byte_capacity() installed a size function.
+    size_t bytes() const {
+        std::lock_guard<std::mutex> lock(m_);
+        size_t total = 0;
+        for (size_t i = 0; i < lane_count_; ++i) total += lanes_[i].bytes;
+        return total;
     }
 
 private:
-    size_t capacity_;
-    std::queue<T> q_;
+    struct Slot {
+        T item;
+        int64_t enq_ns;
+        size_t bytes;    // estimate from size_of_, 0 without one
+        std::string key; // non-empty for conflated items
+    };
+
+    struct Lane {
+        LaneSpec spec;
+        std::deque<Slot> q;
+        uint64_t head_seq = 0;                           // sequence number of q.front()
+        std::unordered_map<std::string, uint64_t> keyed; // conflation key -> sequence number of its pending slot
+        size_t bytes = 0;
+        uint32_t deficit = 0; // items left in this lane's round-robin turn
+        std::condition_variable not_full_cv;
+    };
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool has_room_locked(const Lane& l, size_t bytes) const {
+        if (l.q.size() >= l.spec.capacity) return false;
+        return max_bytes_ == 0 || l.q.empty() || l.bytes + bytes <= max_bytes_;
+    }
+
+    // Per-item sizes for the bulk pushes, computed before taking the lock.
+    template <typename It>
+    const std::vector<size_t>& sizes_of(It first, It last) {
+        thread_local std::vector<size_t> sizes;
+        sizes.clear();
+        for (; first != last; ++first) sizes.push_back(size_of_ ? size_of_(*first) : 0);
+        return sizes;
+    }
+
+    // Called with m_ held after `count` items were added to `l`. `bytes` is the
+    // size of a single pushed item; bulk pushes account for their own.
+    void pushed_locked(Lane& l, size_t count, size_t bytes) {
+        if (bytes) {
+            l.bytes += bytes;
+            if (account_) account_->charge(bytes);
+        }
+        size_ += count;
+        size_hint_.store(size_, std::memory_order_relaxed);
+        if (waiters_ > 0) signal_ns_ = now_ns();
+    }
+
+    // Strict priority between lanes, deficit round-robin within a priority.
+    // Called with m_ held and size_ > 0; lanes are few, so linear scans are fine.
+    Lane& next_lane_locked(size_t& index) {
+        if (lane_count_ == 1) {
+            index = 0;
+            return lanes_[0];
+        }
+        int best = 0;
+        bool found = false;
+        for (size_t i = 0; i < lane_count_; ++i) {
+            if (!lanes_[i].q.empty() && (!found || lanes_[i].spec.priority > best)) {
+                best = lanes_[i].spec.priority;
+                found = true;
+            }
+        }
+        for (;; rr_ = (rr_ + 1) % lane_count_) {
+            Lane& l = lanes_[rr_];
+            if (l.q.empty()) {
+                l.deficit = 0;
+                continue;
+            }
+            if (l.spec.priority != best) continue;
+            if (l.deficit == 0) l.deficit = l.spec.weight;
+            index = rr_;
+            // Move on once this turn is used up or the lane is about to run dry.
+            if (--l.deficit == 0 || l.q.size() == 1) {
+                l.deficit = 0;
+                rr_ = (rr_ + 1) % lane_count_;
+            }
+            return l;
+        }
+    }
+
+    T take_locked(PopInfo* info, bool parked) {
+        size_t index = 0;
+        Lane& l = next_lane_locked(index);
+        Slot& front = l.q.front();
+        if (info) {
+            const int64_t now = now_ns();
+            info->wait_ns = now - front.enq_ns;
+            info->wake_ns = parked ? now - signal_ns_ : -1;
+            info->lane = index;
+        }
+        if (!front.key.empty()) l.keyed.erase(front.key);
+        if (front.bytes) {
+            l.bytes -= front.bytes;
+            if (account_) account_->release(front.bytes);
+        }
+        T item = std::move(front.item);
+        l.q.pop_front();
+        ++l.head_seq;
+        --size_;
+        size_hint_.store(size_, std::memory_order_relaxed);
+        l.not_full_cv.notify_one();
+        return item;
+    }
+
+    std::unique_ptr<Lane[]> lanes_;
+    size_t lane_count_ = 0;
+    size_t rr_ = 0; // round-robin cursor over lanes
+    size_t size_ = 0;
+    size_t max_bytes_ = 0;
+    std::function<size_t(const T&)> size_of_;
+    MemoryBudget::Account* account_ = nullptr;
     mutable std::mutex m_;
     std::condition_variable not_empty_cv_;
-    std::condition_variable not_full_cv_;
     bool stop_ = false;
+    size_t waiters_ = 0;     // consumers parked in pop()/pop_for()
+    int64_t signal_ns_ = 0;  // last push that had parked consumers to wake
+    std::atomic<size_t> size_hint_{0};
 };
 
 } // namespace crossbring
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "crossbring/core/metrics.h"
+
+namespace crossbring {
+
+// Shared scheduler for sources. A few loop threads each drive a hierarchical
+// timer wheel (4 levels of 256 slots, `tick_ms` resolution) and, on Linux, an
+// epoll set for file descriptors; thread count is fixed by the options instead
+// of growing with the number of sources.
+//
+// Periodic timers are fixed-rate: each deadline is the previous one plus the
+// period, so callback run time and wake-up jitter do not accumulate as drift.
+// Ticks that could not be honoured (a stalled loop, a blocking run still in
+// progress) are skipped and counted rather than fired in a burst.
+//
+// Callbacks run on a loop thread and must not block. Tasks that do (HTTP,
+// large file reads) are scheduled with `blocking` and run on a small separate
+// pool; a blocking timer never overlaps with its own previous run.
+class SourceRuntime {
+public:
+    using TimerId = uint64_t;
+
+    struct Options {
+        size_t threads = 1;            // loop threads
+        size_t blocking_threads = 2;   // pool for blocking tasks
+        int tick_ms = 1;
+        std::vector<int> cpus;         // loop thread i is pinned to cpus[i % n]
+    };
+
+    SourceRuntime(MetricsRegistry& reg, Options opts);
+    ~SourceRuntime();
+    SourceRuntime(const SourceRuntime&) = delete;
+    SourceRuntime& operator=(const SourceRuntime&) = delete;
+
+    void start();
+    void stop(); // cancels nothing; pending timers simply stop firing
+
+    // Runs fn every `period`, first at `first` (default: one period from now).
+    TimerId every(std::chrono::nanoseconds period, std::function<void()> fn, bool blocking = false,
+                  std::chrono::steady_clock::time_point first = {});
+    // Runs fn once after `delay`.
+    TimerId after(std::chrono::nanoseconds delay, std::function<void()> fn, bool blocking = false);
+    // Stops a timer. When it returns the callback is not running and will not run
+    // again, unless cancel() is called from inside that callback.
+    void cancel(TimerId id);
+
+    // Calls fn(events) on a loop thread whenever `fd` is ready for `events`
+    // (EPOLLIN, EPOLLOUT, ...). Linux only; throws std::runtime_error elsewhere
+    // or if the fd cannot be added.
+    void watch_fd(int fd, uint32_t events, std::function<void(uint32_t)> fn);
+    // Same guarantee as cancel().
+    void unwatch_fd(int fd);
+
+    size_t threads() const { return loops_.size(); }
+
+private:
+    struct Timer;
+    struct Watch;
+    struct Loop;
+
+    TimerId add(std::shared_ptr<Timer> t);
+    void run_loop(Loop& l, size_t index);
+    void advance(Loop& l, int64_t now_tick, std::vector<std::shared_ptr<Timer>>& due);
+    void place(Loop& l, std::shared_ptr<Timer> t, int64_t base);
+    int64_t next_tick(Loop& l) const;
+    void fire(Loop& l, const std::shared_ptr<Timer>& t);
+    void run(const std::shared_ptr<Timer>& t);
+    void wake(Loop& l);
+    void blocking_loop();
+    int64_t now_ns() const;
+
+    Options opts_;
+    const std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+    const int64_t tick_ns_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<size_t> next_loop_{0};
+    std::atomic<TimerId> next_id_{1};
+    std::atomic<bool> running_{false};
+
+    std::mutex timers_mu_;
+    std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
+
+    std::mutex pool_mu_;
+    std::condition_variable pool_cv_;
+    std::deque<std::shared_ptr<Timer>> pool_queue_;
+    std::vector<std::thread> pool_;
+
+    Gauge& timers_gauge_;
+    Counter& fires_;
+    Counter& missed_;
+    Histogram& lateness_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics.h"
+
+namespace crossbring {
+
+// Sampled per-event tracing. Engine::submit marks a `sample_rate` fraction of
+// events with a trace id (Event::trace_id); the engine then records spans for
+// that event's submit, queue wait, pipeline stages and sinks.
+//
+// Each thread writes spans into its own ring of `buffer_spans` slots, with no
+// lock and no allocation; the oldest spans are overwritten. Readers copy the
+// rings concurrently and skip slots that are being rewritten (per-slot sequence
+// numbers), so dumping never stalls the pipeline. chrome_json() renders the
+// spans as Chrome trace-event JSON, which Perfetto and chrome://tracing open.
+class Tracer {
+public:
+    struct Options {
+        bool enabled = false;
+        double sample_rate = 0.001; // fraction of submitted events traced
+        size_t buffer_spans = 16384; // per thread, rounded up to a power of two
+    };
+
+    enum class SpanKind : uint8_t {
+        Slice, // nested work on the recording thread
+        Async, // may overlap others (queue wait); drawn on its own track
+    };
+
+    // Records one span when `trace` is nonzero, from construction to destruction.
+    class Scope {
+    public:
+        Scope(Tracer& t, uint64_t trace, uint32_t name)
+            : t_(t), trace_(trace), name_(name), start_(trace ? now_ns() : 0) {}
+        ~Scope() {
+            if (trace_) t_.record(trace_, name_, start_, now_ns());
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Tracer& t_;
+        uint64_t trace_;
+        uint32_t name_;
+        int64_t start_;
+    };
+
+    explicit Tracer(MetricsRegistry& reg);
+
+    // Call before the engine starts.
+    void configure(const Options& opts);
+    bool enabled() const { return enabled_; }
+
+    // A new trace id for a sampled event, 0 for the rest.
+    uint64_t sample() {
+        if (!enabled_ || !coin()) return 0;
+        sampled_.inc();
+        return next_trace_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Span names are interned once; the id is what a span records.
+    uint32_t intern(const std::string& name);
+    void record(uint64_t trace, uint32_t name, int64_t start_ns, int64_t end_ns, SpanKind kind = SpanKind::Slice);
+    // Names the calling thread's track in the dump.
+    void set_thread_name(const std::string& name);
+
+    // Spans that ended at or after `since_ns` (steady-clock ns) as a Chrome
+    // trace-event JSON object.
+    std::string chrome_json(int64_t since_ns = 0) const;
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    struct Buffer;
+    bool coin();
+    Buffer& local_buffer();
+
+    const uint64_t id_; // tells this tracer's thread-local buffers from another's
+    bool enabled_ = false;
+    uint64_t threshold_ = 0; // sample when a 64-bit random number is below this
+    size_t buffer_spans_ = 16384;
+    std::atomic<uint64_t> next_trace_{1};
+
+    mutable std::mutex mu_; // buffers_ and names_
+    std::vector<std::shared_ptr<Buffer>> buffers_;
+    std::vector<std::string> names_; // JSON-escaped, by id
+    std::unordered_map<std::string, uint32_t> name_ids_;
+
+    Counter& sampled_;
+    Counter& spans_;
+};
+
+} // namespace crossbring
@@ -11,7 +11,48 @@ struct Event {
     std::chrono::steady_clock::time_point tp;
     std::string source;   // e.g., sensor name or "af_jobs"
     std::string key;      // e.g., sensor id or job id
-    nlohmann::json payload; // raw data
+    mutable nlohmann::json payload; // raw data
+    // Unparsed payload JSON from sources that defer parsing. While set, `payload`
+    // is null; json() materializes it on first use by a processor or sink.
+    mutable std::string raw;
+    uint64_t trace_id = 0; // nonzero when sampled for tracing; see Tracer
+
+    nlohmann::json& json() { materialize(); return payload; }
+    const nlohmann::json& json() const { materialize(); return payload; }
+
+    // Payload as JSON text without forcing a parse when it is still raw.
+    std::string payload_text() const { return raw.empty() ? payload.dump() : raw; }
+    // Same text appended to `out`, skipping the temporary copy of a raw payload.
+    void append_payload_text(std::string& out) const {
+        if (raw.empty()) out += payload.dump();
+        else out += raw;
+    }
+
+    // Sets a top-level integer member. A raw object payload gets it appended to
+    // its text (a later duplicate wins when parsed), so it stays unparsed.
+    // Payloads that are not objects are left alone.
+    void set_int(const std::string& name, int64_t v) {
+        const size_t close = raw.find_last_not_of(" \t\r\n");
+        if (close != std::string::npos && raw[close] == '}') {
+            const size_t open = raw.find_first_not_of(" \t\r\n");
+            const bool empty = raw.find_first_not_of(" \t\r\n", open + 1) == close;
+            std::string member = nlohmann::json(name).dump();
+            member += ':';
+            member += std::to_string(v);
+            if (!empty) member.insert(member.begin(), ',');
+            raw.insert(close, member);
+            return;
+        }
+        materialize();
+        if (payload.is_object() || payload.is_null()) payload[name] = v;
+    }
+
+private:
+    void materialize() const {
+        if (raw.empty()) return;
+        payload = nlohmann::json::parse(raw);
+        raw.clear();
+    }
 };
 
 } // namespace crossbring
@@ -8,25 +8,48 @@
 
 #include <nlohmann/json.hpp>
 
+#include "crossbring/core/memory.h"
 #include "crossbring/sinks/sink.h"
 
 namespace crossbring {
 
+// Per-subscriber queue. With max_bytes set, a subscriber that falls behind
+// loses its oldest messages instead of growing the queue without limit.
 class JsonQueue {
 public:
-    void push(nlohmann::json j) {
+    explicit JsonQueue(size_t max_bytes = 0, MemoryBudget::Account* account = nullptr)
+        : max_bytes_(max_bytes), account_(account) {}
+    ~JsonQueue() {
+        if (account_) account_->release(bytes_);
+    }
+
+    // `bytes` is the caller's size estimate of `j` (0 when not accounting).
+    void push(nlohmann::json j, size_t bytes = 0) {
         std::lock_guard<std::mutex> lock(mu_);
-        q_.push_back(std::move(j));
+        while (max_bytes_ && !q_.empty() && bytes_ + bytes > max_bytes_) {
+            release_front_locked();
+            q_.pop_front();
+            ++dropped_;
+        }
+        q_.push_back({std::move(j), bytes});
+        bytes_ += bytes;
+        if (account_) account_->charge(bytes);
         cv_.notify_one();
     }
     bool pop(nlohmann::json& out) {
         std::unique_lock<std::mutex> lock(mu_);
         cv_.wait(lock, [&]{ return stop_ || !q_.empty(); });
         if (stop_ && q_.empty()) return false;
-        out = std::move(q_.front());
+        out = std::move(q_.front().item);
+        release_front_locked();
         q_.pop_front();
         return true;
     }
+    // Messages discarded because this subscriber fell behind.
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return dropped_;
+    }
     void stop() {
         {
             std::lock_guard<std::mutex> lock(mu_);
@@ -35,28 +58,49 @@ public:
         cv_.notify_all();
     }
 private:
-    std::deque<nlohmann::json> q_;
-    std::mutex mu_;
+    struct Entry {
+        nlohmann::json item;
+        size_t bytes;
+    };
+
+    void release_front_locked() {
+        bytes_ -= q_.front().bytes;
+        if (account_) account_->release(q_.front().bytes);
+    }
+
+    size_t max_bytes_;
+    MemoryBudget::Account* account_;
+    size_t bytes_ = 0;
+    uint64_t dropped_ = 0;
+    std::deque<Entry> q_;
+    mutable std::mutex mu_;
     std::condition_variable cv_;
     bool stop_ = false;
 };
 
 class EventHub {
 public:
+    // max_queue_bytes bounds each subscriber queue; all queues charge `account`.
+    explicit EventHub(size_t max_queue_bytes = 0, MemoryBudget::Account* account = nullptr)
+        : max_queue_bytes_(max_queue_bytes), account_(account) {}
+
     std::shared_ptr<JsonQueue> register_consumer() {
-        auto q = std::make_shared<JsonQueue>();
+        auto q = std::make_shared<JsonQueue>(max_queue_bytes_, account_);
         std::lock_guard<std::mutex> lock(mu_);
         consumers_.push_back(q);
         return q;
     }
     void publish(const nlohmann::json& j) {
+        const size_t bytes = (account_ || max_queue_bytes_) ? approx_bytes(j) : 0;
         std::lock_guard<std::mutex> lock(mu_);
         for (auto it = consumers_.begin(); it != consumers_.end();) {
-            if (auto q = it->lock()) { q->push(j); ++it; }
+            if (auto q = it->lock()) { q->push(j, bytes); ++it; }
             else { it = consumers_.erase(it); }
         }
     }
 private:
+    size_t max_queue_bytes_;
+    MemoryBudget::Account* account_;
     std::vector<std::weak_ptr<JsonQueue>> consumers_;
     std::mutex mu_;
 };
@@ -68,7 +112,7 @@ public:
         nlohmann::json j = {
             {"source", ev.source},
             {"key", ev.key},
-            {"payload", ev.payload}
+            {"payload", ev.json()}
         };
         hub_->publish(j);
     }
@@ -13,8 +13,28 @@ class RecentBuffer; // fwd (stores last N events)
 
 class EventHub; // fwd
 
+class TimeSeriesStore; // fwd (compressed numeric history)
+
+class EventIndex; // fwd (per source/key event history)
+
+class StateStore; // fwd (latest event per source/key)
+
+class SketchStage; // fwd (per-source streaming summaries)
+
+class IngestHandler; // fwd (POST /ingest bodies to events)
+
+class SqliteStore; // fwd (time-partitioned SQLite history)
+
 class HttpServer {
 public:
+    // Connection handling for the whole server.
+    struct ServerOptions {
+        size_t threads = 8;               // request threads; each open /sse stream holds one
+        size_t keep_alive_max = 100;      // requests per connection
+        int keep_alive_timeout_s = 5;
+        size_t max_body_bytes = 64 << 20; // after decompression; larger requests get 413
+    };
+
     HttpServer(Engine& engine, std::shared_ptr<RecentBuffer> recent,
                const std::string& host = "127.0.0.1", int port = 9100,
                std::shared_ptr<EventHub> hub = nullptr);
@@ -23,12 +43,33 @@ public:
     void start();
     void stop();
 
+    // Serves /series from the given store. Set before start().
+    void set_time_series(std::shared_ptr<TimeSeriesStore> store) { tsdb_ = std::move(store); }
+    // Serves /query from the given index. Set before start().
+    void set_event_index(std::shared_ptr<EventIndex> index) { index_ = std::move(index); }
+    // Serves /state from the given store. Set before start().
+    void set_state_store(std::shared_ptr<StateStore> state) { state_ = std::move(state); }
+    // Serves /stats from the given sketches. Set before start().
+    void set_sketches(std::shared_ptr<SketchStage> sketches) { sketches_ = std::move(sketches); }
+    // Serves POST /ingest through the given handler. Set before start().
+    void set_ingest(std::shared_ptr<IngestHandler> ingest) { ingest_ = std::move(ingest); }
+    // Serves /history from the given store (USE_SQLITE builds). Set before start().
+    void set_history(std::shared_ptr<SqliteStore> history) { history_ = std::move(history); }
+    void set_server_options(const ServerOptions& opts) { server_opts_ = opts; }
+
 private:
     void run();
 
     Engine& engine_;
     std::shared_ptr<RecentBuffer> recent_;
     std::shared_ptr<EventHub> hub_;
+    std::shared_ptr<TimeSeriesStore> tsdb_;
+    std::shared_ptr<EventIndex> index_;
+    std::shared_ptr<StateStore> state_;
+    std::shared_ptr<SketchStage> sketches_;
+    std::shared_ptr<IngestHandler> ingest_;
+    std::shared_ptr<SqliteStore> history_;
+    ServerOptions server_opts_;
     std::string host_;
     int port_;
     std::atomic<bool> running_{false};
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "crossbring/core/engine.h"
+#include "crossbring/json/record_parser.h"
+
+namespace crossbring {
+
+// Turns HTTP request bodies into events for POST /ingest. Kept apart from the
+// HTTP server so it can be driven (and benchmarked) without a socket.
+//
+// A body is either NDJSON, one record per line, parsed as lines arrive, or a
+// JSON document accepted by RecordParser: a top-level array or an object with
+// an "ads" array. Records become raw events (parsed lazily, like FileJsonSource)
+// and are submitted in batches through Engine::try_submit_batch, which never
+// blocks. Processing stops at the first malformed record or the first record
+// the engine refuses; since batches are accepted as a prefix, `accepted` tells
+// the client where to resume.
+class IngestHandler {
+public:
+    struct Options {
+        std::string source = "http"; // default event source; ?source= overrides it
+        size_t batch_size = 512;
+        size_t max_clients = 256;    // distinct client labels before the rest share "other"
+    };
+
+    enum class Format { Ndjson, Json };
+
+    struct Result {
+        int status = 202;  // 202, 400 malformed, 429 queue full, 503 over memory budget or stopping
+        size_t accepted = 0;
+        size_t rejected = 0; // refused by the engine, plus the malformed record on a 400
+        std::string error;
+        std::string json() const;
+    };
+
+    // One request body. Feed it chunks, then call finish().
+    class Request {
+    public:
+        // Returns false once processing has stopped; the rest of the body can be skipped.
+        bool feed(const char* data, size_t n);
+        Result finish();
+
+    private:
+        friend class IngestHandler;
+        Request(IngestHandler& h, Format format, std::string source, const std::string& client);
+
+        void add_lines(const char* begin, const char* end);
+        void add_doc(std::string_view doc, size_t expected);
+        void flush();
+        void reject(std::string error);
+        void fail(int status, std::string error);
+
+        IngestHandler& h_;
+        const Format format_;
+        const std::string source_;
+        Counter& accepted_;
+        Counter& rejected_;
+        std::string pending_; // NDJSON: partial last line; JSON: the whole body
+        std::string doc_;     // NDJSON lines wrapped as one array for the record parser
+        std::vector<Event> batch_;
+        size_t records_ = 0;
+        Result result_;
+        bool stopped_ = false;
+    };
+
+    IngestHandler(Engine& engine, Options opts);
+
+    // `client` labels the per-client counters (X-Client-Id or the peer address).
+    Request begin(Format format, const std::string& source, const std::string& client);
+    // NDJSON for application/x-ndjson, application/jsonl and friends, else JSON.
+    static Format format_for(const std::string& content_type);
+
+private:
+    std::string client_label(const std::string& client);
+
+    Engine& engine_;
+    Options opts_;
+    CounterVec& accepted_;
+    CounterVec& rejected_;
+    Counter& malformed_;
+    std::mutex clients_mu_;
+    std::unordered_set<std::string> clients_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace crossbring {
+
+// One element of a record array, located without building a DOM.
+struct JsonRecord {
+    std::string_view key;   // "id" (or "job_id" when no "id"): a string unescaped, a number as written; empty if absent
+    std::string_view text;  // the element's JSON text, a view into the input document
+    std::string_view field; // the member named by RecordParser::capture(), like key; empty if absent
+};
+
+// Splits a JSON document into records: either a top-level array or an object
+// whose "ads" member is an array (the AF search response shape). The input is
+// fully validated, including UTF-8 and \u surrogate pairs; malformed documents
+// throw std::runtime_error. Views are valid only during the callback.
+class RecordParser {
+public:
+    virtual ~RecordParser() = default;
+    virtual size_t for_each(std::string_view doc, const std::function<void(const JsonRecord&)>& fn) = 0;
+    virtual std::string name() const = 0;
+
+    // Also pick out this top-level string or number member of each record
+    // (e.g. a timestamp), in the same pass. Empty turns it off.
+    void capture(std::string member) { capture_ = std::move(member); }
+
+protected:
+    std::string capture_;
+};
+
+// kind: "scan" (SIMD structural scanner, the default for "auto") or "nlohmann" (DOM reference path).
+std::unique_ptr<RecordParser> make_record_parser(const std::string& kind = "auto");
+
+// Instruction set picked at runtime for string scanning: "avx2", "sse2" or "scalar".
+const char* json_scan_isa();
+
+} // namespace crossbring
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "crossbring/core/engine.h"
+#include "crossbring/processors/expression.h"
+
+namespace crossbring {
+
+// Declarative pattern: within `within_ms` of its first match, a partition must see
+// steps[0] `times` times in a row, then steps[1], and so on. Events outside `scope`
+// are ignored; an in-scope event that misses the current step breaks a run of
+// repeats but otherwise waits for the next step (skip till next match).
+struct CepPattern {
+    struct Step {
+        std::string when;   // expression
+        uint32_t times = 1; // consecutive matches needed
+    };
+    std::string name;
+    std::string scope;             // optional filter expression
+    std::string partition = "key"; // expression giving the state-machine key
+    std::vector<Step> steps;
+    int64_t within_ms = 5000;
+    std::string alert_source = "cep";
+};
+
+// Complex event processing stage. Each (pattern, partition) pair is a small state
+// machine held in a shard-local hash map; shards are picked by hash so workers
+// rarely share a lock. Partial matches expire through a per-shard timing wheel
+// in which each partial owns exactly one entry, removed with it, so memory stays
+// bounded by max_partials_per_shard. Completed matches are submitted back into
+// the engine as alert events.
+class CepStage {
+public:
+    struct Options {
+        size_t shards = 16;
+        size_t max_partials_per_shard = 65536; // new partial matches beyond this are not started
+        uint32_t tick_ms = 50;                 // timing-wheel resolution
+        uint32_t wheel_slots = 1024;
+    };
+
+    // Compiles all expressions; throws std::invalid_argument on bad patterns.
+    CepStage(Engine& engine, std::vector<CepPattern> patterns, Options opts);
+
+    // Runs as an engine processor; never modifies the event.
+    void process(const Event& ev);
+
+private:
+    struct Compiled {
+        CepPattern spec;
+        std::unique_ptr<Expression> scope;
+        Expression partition;
+        std::vector<Expression> steps;
+        Counter* matches;
+    };
+    struct Partial {
+        uint32_t step = 0;
+        uint32_t count = 0;
+        int64_t first_ns = 0;
+        uint32_t slot = 0; // where its timer sits: wheel[slot][pos]
+        uint32_t pos = 0;
+    };
+    using PartialMap = std::unordered_map<std::string, Partial>;
+    struct Timer {
+        uint32_t pattern;
+        int64_t deadline_ns;
+        PartialMap::value_type* owner; // map nodes do not move on rehash
+    };
+    struct alignas(64) Shard {
+        std::mutex mu;
+        std::vector<PartialMap> by_pattern;
+        std::vector<std::vector<Timer>> wheel;
+        int64_t cursor = -1; // last tick processed
+        size_t partials = 0;
+    };
+
+    void advance(Shard& s, int64_t now_ns);
+    void expire_slot(Shard& s, size_t slot, int64_t now_ns);
+    void erase_partial(Shard& s, uint32_t pattern, PartialMap::iterator it);
+    Event make_alert(const Compiled& p, const std::string& key, const Partial& st, const Event& last) const;
+
+    Engine& engine_;
+    Options opts_;
+    int64_t tick_ns_;
+    std::vector<Compiled> patterns_;
+    std::unordered_set<std::string> alert_sources_;
+    std::unique_ptr<Shard[]> shards_;
+    Gauge& active_;
+    Counter& expired_;
+    Counter& overflow_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "crossbring/core/engine.h"
+#include "crossbring/processors/expression.h"
+#include "crossbring/storage/lookup_table.h"
+
+namespace crossbring {
+
+// Joins events against a reference table (occupation codes, regions, ...). The
+// `on` expression gives the lookup key; a hit copies the row's columns into the
+// payload object at `target`, creating missing or null path elements. An event
+// whose payload or path holds any other value there is left untouched and
+// counted as a conflict. The table is a memory-mapped LookupTable: lookups
+// are a hash probe into shared read-only pages.
+//
+// A watcher thread polls the source file. On change it compiles a new table
+// beside the old one, maps it and publishes it with a version bump. Workers keep
+// the table they hold until they see the new version on their next event, so a
+// reload never blocks them, and the old mapping goes away with its last reader.
+class EnrichStage {
+public:
+    struct Options {
+        std::string name;                 // metrics label
+        std::filesystem::path table;      // .csv, .json, or an already compiled table
+        std::filesystem::path compiled;   // output of compiling `table`; default table + ".lut"
+        std::string key_column = "code";
+        std::string on;                   // expression giving the key
+        std::string target;               // payload path for the columns; default `name`
+        std::vector<std::string> columns; // subset to copy; empty copies all
+        int poll_ms = 2000;               // 0 disables reloading
+    };
+
+    // Builds and maps the table and compiles `on`; throws on any failure. A table
+    // file that does not exist yet is not an error: events pass through unjoined
+    // until the watcher finds it.
+    EnrichStage(Engine& engine, Options opts);
+    ~EnrichStage();
+
+    void start(); // watcher thread
+    void stop();
+
+    // Runs as an engine processor.
+    void process(Event& ev);
+
+    // Rebuilds and publishes the table now. Throws on failure and keeps serving
+    // the current table.
+    void reload();
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    // Everything a worker needs for one table generation.
+    struct Snapshot {
+        std::shared_ptr<const LookupTable> table;
+        std::vector<size_t> columns;          // table column per output field
+        std::vector<std::string> names;
+    };
+
+    std::shared_ptr<const Snapshot> load() const;
+    const Snapshot* current(); // nullptr until a table is loaded
+    std::string fingerprint() const;
+    void run();
+
+    Options opts_;
+    bool precompiled_;
+    Expression on_;
+    std::vector<std::string> target_;
+    const uint64_t id_; // tells this stage's thread-local cache entries apart from other stages'
+
+    mutable std::mutex mu_; // guards snap_
+    std::shared_ptr<const Snapshot> snap_;
+    std::atomic<uint64_t> version_{0};
+    std::mutex reload_mu_; // one build at a time
+    std::string last_fingerprint_, pending_fingerprint_; // watcher only
+
+    Counter& hits_;
+    Counter& misses_;
+    Counter& conflicts_;
+    Counter& reloads_;
+    Counter& reload_errors_;
+    Gauge& rows_;
+
+    std::atomic<bool> running_{false};
+    std::mutex wake_mu_;
+    std::condition_variable wake_cv_;
+    std::thread th_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "crossbring/event.h"
+
+namespace crossbring {
+
+class Counter;
+
+// Result of evaluating an Expression. Strings are views into the event, its
+// payload or the compiled expression, so evaluation never allocates.
+struct ExprValue {
+    enum class Type : uint8_t { Null, Bool, Number, String };
+    Type type = Type::Null;
+    bool b = false;
+    double num = 0.0;
+    std::string_view str;
+
+    static ExprValue boolean(bool v) { ExprValue r; r.type = Type::Bool; r.b = v; return r; }
+    static ExprValue number(double v) { ExprValue r; r.type = Type::Number; r.num = v; return r; }
+    static ExprValue string(std::string_view v) { ExprValue r; r.type = Type::String; r.str = v; return r; }
+
+    bool truthy() const;
+    // Text form for use as a map key, written into `out` (reusing its capacity).
+    // False for null.
+    bool to_key(std::string& out) const;
+};
+
+// Small expression language over one event, compiled once into a closure tree:
+//   source == 'temp' && value > 70
+//   value * 1.8 + 32
+//   exists(tags.site) && starts_with(key, "sensor-")
+// `source` and `key` are the event fields; any other identifier is a payload path
+// (dotted for nested objects; `payload.` may prefix a path to bypass the names above).
+// Operators: || && ! == != < <= > >= + - * / % and parentheses. Functions: abs, min,
+// max, len, exists, contains, starts_with. Missing fields and type mismatches yield
+// null, which compares unequal to everything but null and is falsy.
+class Expression {
+public:
+    // Throws std::invalid_argument naming the offending position.
+    static Expression compile(const std::string& text);
+
+    ExprValue eval(const Event& ev) const { return root_(ev); }
+    bool test(const Event& ev) const { return root_(ev).truthy(); }
+    const std::string& text() const { return text_; }
+
+    using Fn = std::function<ExprValue(const Event&)>;
+
+private:
+    Expression(std::string text, Fn root) : text_(std::move(text)), root_(std::move(root)) {}
+
+    std::string text_;
+    Fn root_;
+};
+
+// Config-driven processor: drops events failing `filter`, then assigns each `set`
+// expression to its payload path in order (later ones see earlier results).
+// Missing or null path elements become objects; an assignment that would
+// replace any other value (a scalar payload, `a` in `a.b` holding a number) is
+// skipped and counted in `conflicts` instead.
+class ExpressionTransform {
+public:
+    // `when` (optional) limits `set` to events it holds for; the filter still sees every event.
+    ExpressionTransform(const std::string& filter, const std::vector<std::pair<std::string, std::string>>& set,
+                        const std::string& when = {}, Counter* conflicts = nullptr);
+
+    // Returns false when the event should be dropped.
+    bool operator()(Event& ev) const;
+
+private:
+    std::unique_ptr<Expression> filter_;
+    std::unique_ptr<Expression> when_;
+    std::vector<std::pair<std::vector<std::string>, Expression>> set_;
+    Counter* conflicts_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "crossbring/core/engine.h"
+#include "crossbring/processors/expression.h"
+#include "crossbring/storage/sketches.h"
+
+namespace crossbring {
+
+// Per-source streaming summaries: heavy hitters (Count-Min + top-k), distinct
+// count (HyperLogLog) and quantiles (KLL). Each worker thread updates its own
+// shard, so the hot path takes an uncontended lock; readers merge the shards.
+// Memory is fixed per source and shard, whatever the stream length.
+class SketchStage {
+public:
+    struct Options {
+        size_t shards = 8;
+        size_t max_sources = 256;         // per shard; events of further sources are not sketched
+        std::string heavy_hitters = "key"; // expressions; empty disables that sketch
+        std::string distinct = "key";
+        std::string quantile = "value";
+        std::vector<double> quantiles{0.5, 0.9, 0.99};
+        size_t top_k = 16;
+        size_t cm_width = 128;
+        size_t cm_depth = 4;
+        unsigned hll_precision = 10;
+        uint32_t kll_k = 128;
+    };
+
+    // Compiles the expressions; throws std::invalid_argument on bad ones.
+    SketchStage(Engine& engine, Options opts);
+
+    // Runs as an engine processor; never modifies the event.
+    void process(const Event& ev);
+
+    // {"sources": {"<source>": {...}}} with every source merged over all shards.
+    nlohmann::json stats() const;
+    // One source's summary, or null if it was never seen.
+    nlohmann::json stats(const std::string& source) const;
+
+private:
+    struct Summary {
+        uint64_t events = 0;
+        HeavyHitters hh;
+        HyperLogLog hll;
+        QuantileSketch q;
+        explicit Summary(const Options& o) : hh(o.cm_width, o.cm_depth, o.top_k), hll(o.hll_precision), q(o.kll_k) {}
+        void merge(const Summary& o);
+        size_t memory_bytes() const;
+    };
+    struct alignas(64) Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, Summary> sources;
+    };
+
+    nlohmann::json to_json(const Summary& s, size_t held_bytes) const;
+
+    Options opts_;
+    std::unique_ptr<Expression> hh_expr_, distinct_expr_, quantile_expr_;
+    std::unique_ptr<Shard[]> shards_;
+    Counter& overflow_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "crossbring/core/memory.h"
+#include "crossbring/core/metrics.h"
+#include "crossbring/sinks/sink.h"
+
+namespace crossbring {
+
+// Append-only archive of every event in rolling segment files.
+//
+// Workers only encode records into a per-shard block buffer (4 KiB aligned,
+// `block_bytes` large). Full or stale blocks are handed to `io_threads` writer
+// threads, which compress them, reserve an offset in the open segment and
+// write them with positional writes, so blocks of one segment are written in
+// parallel. Each block is self-describing (header with codec, sizes, record
+// count, time range and CRC) and is listed in a sidecar `.idx` of fixed-size
+// entries, which lets readers seek by time without decompressing.
+//
+// Segments roll by size or age. While open they carry an `.open` suffix; the
+// rename on close marks them complete. When `max_inflight_bytes` of sealed
+// blocks are waiting for the disk, consume() blocks, backing up the engine
+// queue instead of growing memory.
+class ArchiveSink : public Sink {
+public:
+    enum class Format : uint8_t { Ndjson = 0, Binary = 1 };
+    enum class Codec : uint8_t { None = 0, Deflate = 1 };
+
+    struct Options {
+        std::filesystem::path dir = "data/archive";
+        std::string prefix = "events";
+        Format format = Format::Ndjson;
+        Codec codec = Codec::Deflate;
+        int level = 1;                       // deflate level; 1 favours speed
+        size_t block_bytes = 1 << 20;
+        uint64_t roll_bytes = 256ull << 20;  // stored bytes per segment
+        int roll_seconds = 3600;
+        int flush_ms = 1000;                 // seals partly filled blocks older than this
+        size_t io_threads = 2;
+        size_t shards = 8;
+        size_t max_inflight_bytes = 64 << 20;
+    };
+
+    // Creates `dir`; throws std::invalid_argument for Deflate without zlib support
+    // and std::runtime_error if the directory cannot be created.
+    explicit ArchiveSink(Options opts);
+    ~ArchiveSink() override;
+
+    void consume(const Event& ev) override;
+    std::string name() const override { return "archive"; }
+    void bind_metrics(MetricsRegistry& reg) override;
+    void bind_memory(MemoryBudget& budget) override;
+
+    // Seals every open block and waits until all of them are on disk.
+    void flush();
+
+    static Codec parse_codec(const std::string& s); // "deflate" | "none"; throws std::invalid_argument
+    static Format parse_format(const std::string& s); // "ndjson" | "binary"; throws std::invalid_argument
+
+private:
+    struct Block;
+    struct Segment;
+    struct BlockDeleter { void operator()(Block* b) const; };
+    using BlockPtr = std::unique_ptr<Block, BlockDeleter>;
+
+    struct alignas(64) Shard {
+        std::mutex mu;
+        BlockPtr open;
+    };
+
+    BlockPtr new_block(size_t min_bytes);
+    void append(Shard& s, const std::string& rec, int64_t ts_ns);
+    void seal(BlockPtr b);
+    void seal_stale(bool all);
+    void io_loop();
+    void timer_loop();
+    void write_block(Block& b, std::string& scratch);
+    std::shared_ptr<Segment> segment_for(uint64_t stored, uint64_t& offset);
+
+    Options opts_;
+    std::unique_ptr<Shard[]> shards_;
+
+    std::mutex q_mu_;
+    std::condition_variable q_cv_;    // writers: a block is queued or we are stopping
+    std::condition_variable room_cv_; // producers: in-flight bytes dropped
+    std::condition_variable idle_cv_; // flush(): everything written
+    std::deque<BlockPtr> queue_;
+    std::vector<BlockPtr> free_;      // written blocks kept for reuse, already faulted in
+    size_t inflight_bytes_ = 0;       // queued or being written
+    size_t inflight_blocks_ = 0;
+    bool stopping_ = false;
+
+    std::mutex seg_mu_;
+    std::shared_ptr<Segment> seg_;
+    uint64_t next_seq_ = 0;
+
+    std::atomic<bool> running_{true};
+    std::mutex timer_mu_;
+    std::condition_variable timer_cv_;
+    std::vector<std::thread> io_threads_;
+    std::thread timer_;
+
+    Counter* records_ = nullptr; // set by bind_metrics
+    Counter* raw_bytes_ = nullptr;
+    Counter* stored_bytes_ = nullptr;
+    Counter* blocks_ = nullptr;
+    Counter* segments_ = nullptr;
+    Counter* errors_ = nullptr;
+    Gauge* inflight_ = nullptr;
+    MemoryBudget::Account* account_ = nullptr; // set by bind_memory when accounting is on
+};
+
+// Reads archive segments back, using the sidecar index to skip blocks outside
+// the requested time range (and scanning block headers when it is missing).
+class ArchiveReader {
+public:
+    struct Record {
+        int64_t ts_ns; // Unix ns
+        std::string_view source;
+        std::string_view key;
+        std::string_view payload; // JSON text
+    };
+
+    // Complete segments in `dir` in write order; `.open` ones are skipped.
+    static std::vector<std::filesystem::path> segments(const std::filesystem::path& dir, const std::string& prefix = "");
+
+    explicit ArchiveReader(std::filesystem::path segment) : path_(std::move(segment)) {}
+
+    // Calls fn for each record with from_ns <= ts_ns < to_ns (Unix ns); returns the number
+    // visited. Throws std::runtime_error on corrupt blocks.
+    size_t for_each(int64_t from_ns, int64_t to_ns, const std::function<void(const Record&)>& fn) const;
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace crossbring
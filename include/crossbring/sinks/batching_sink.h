@@ -1,74 +1,93 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "crossbring/core/memory.h"
+#include "crossbring/core/metrics.h"
 #include "crossbring/sinks/sink.h"
 
 namespace crossbring {
 
+// Buffers events and hands them to the inner sink a batch at a time through
+// consume_batch(). Workers append shared event pointers to their own shard's
+// batch, so appends neither copy the event nor contend with each other or the
+// flush thread. A batch is sealed when it reaches `batch_size` events or
+// `max_batch_bytes`, or is `flush_ms` old; sealing swaps in an empty buffer and
+// queues the full one for the flush thread.
+//
+// max_bytes bounds the estimated size of buffered plus in-flight events; when it
+// is reached consume() blocks until a flush completes, which backs up the engine
+// queue instead of growing the buffer without limit.
 class BatchingSink : public Sink {
 public:
-    BatchingSink(std::shared_ptr<Sink> inner, size_t batch_size, int flush_ms)
-        : inner_(std::move(inner)), batch_size_(batch_size), flush_ms_(flush_ms) {
-        running_ = true;
-        th_ = std::thread([this]{ loop(); });
-    }
-    ~BatchingSink() override {
-        {
-            std::lock_guard<std::mutex> lock(mu_);
-            running_ = false;
-        }
-        cv_.notify_all();
-        if (th_.joinable()) th_.join();
-        flush();
-    }
+    struct Options {
+        size_t batch_size = 32;
+        int flush_ms = 200;
+        size_t max_batch_bytes = 0; // 0 = no byte trigger
+        size_t max_bytes = 0;       // 0 = unbounded
+        size_t shards = 8;
+    };
+
+    BatchingSink(std::shared_ptr<Sink> inner, Options opts);
+    BatchingSink(std::shared_ptr<Sink> inner, size_t batch_size, int flush_ms, size_t max_bytes = 0)
+        : BatchingSink(std::move(inner), Options{batch_size, flush_ms, 0, max_bytes}) {}
+    ~BatchingSink() override;
 
-    void consume(const Event& ev) override {
-        std::lock_guard<std::mutex> lock(mu_);
-        buf_.push_back(ev);
-        if (buf_.size() >= batch_size_) cv_.notify_all();
+    void consume(const Event& ev) override { consume_shared(std::make_shared<const Event>(ev)); }
+    bool retains_events() const override { return true; }
+    void consume_shared(const EventPtr& ev) override;
+    void consume_batch(const std::vector<EventPtr>& batch) override {
+        for (auto& ev : batch) consume_shared(ev);
     }
 
     std::string name() const override { return std::string("batch(") + inner_->name() + ")"; }
+    void bind_metrics(MetricsRegistry& reg) override;
+    void bind_memory(MemoryBudget& budget) override;
 
 private:
-    void loop() {
-        std::unique_lock<std::mutex> lock(mu_);
-        while (running_) {
-            cv_.wait_for(lock, std::chrono::milliseconds(flush_ms_));
-            flush_unlocked();
-        }
-    }
-
-    void flush() {
-        std::lock_guard<std::mutex> lock(mu_);
-        flush_unlocked();
-    }
+    struct Batch {
+        std::vector<EventPtr> events;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point first; // when the oldest event was buffered
+    };
+    struct alignas(64) Shard {
+        std::mutex mu;
+        Batch open;
+    };
 
-    void flush_unlocked() {
-        if (buf_.empty()) return;
-        auto items = std::move(buf_);
-        buf_.clear();
-        // unlock before forwarding to avoid blocking producers
-        mu_.unlock();
-        for (auto& e : items) inner_->consume(e);
-        mu_.lock();
-    }
+    void seal_locked(Shard& s, std::vector<Batch>& out);
+    void seal_stale(bool all);
+    void enqueue(std::vector<Batch>& sealed);
+    void deliver(Batch& b);
+    void loop();
 
     std::shared_ptr<Sink> inner_;
-    size_t batch_size_;
-    int flush_ms_;
-    std::vector<Event> buf_;
-    std::mutex mu_;
-    std::condition_variable cv_;
-    std::atomic<bool> running_{false};
+    Options opts_;
+    std::unique_ptr<Shard[]> shards_;
+
+    std::mutex q_mu_;
+    std::condition_variable q_cv_;    // flush thread: a batch is queued, pressure, or stopping
+    std::condition_variable room_cv_; // producers waiting on max_bytes
+    std::deque<Batch> queue_;
+    std::vector<std::vector<EventPtr>> spare_; // delivered buffers, kept for their capacity
+    bool pressure_ = false;                    // a producer is blocked: seal everything now
+    std::atomic<size_t> held_bytes_{0};        // buffered plus being delivered
+    std::atomic<bool> running_{true};
     std::thread th_;
+
+    Gauge* pending_ = nullptr;  // set by bind_metrics
+    Gauge* inflight_ = nullptr;
+    Histogram* batch_events_ = nullptr;
+    Histogram* flush_seconds_ = nullptr;
+    Histogram* latency_seconds_ = nullptr;
+    MemoryBudget::Account* account_ = nullptr; // set by bind_memory when accounting is on
 };
 
 } // namespace crossbring
-
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "crossbring/core/memory.h"
+#include "crossbring/core/metrics.h"
+#include "crossbring/sinks/sink.h"
+#include "crossbring/storage/columnar_segment.h"
+
+namespace crossbring {
+
+// Buffers events per source into column batches and writes each batch as a
+// columnar segment (see write_columnar_segment) under `dir/<source>/`.
+//
+// Every batch has a `ts_ns` Int64 column (Unix ns) and a dictionary-encoded
+// `key`; the payload is flattened into dotted paths (`a.b.c`, up to `max_depth`
+// levels, arrays and deeper objects kept as JSON text). Column types are inferred per
+// batch unless `schemas` pins them: integers give int64, integers mixed with
+// reals float64, booleans bool, strings a dict column when they repeat and a
+// string column otherwise, and anything mixed falls back to string. Values
+// that do not fit a pinned type are written as nulls.
+//
+// Batches are sealed at `batch_rows` rows or after `flush_ms`, then encoded and
+// written by a background thread. When `max_pending` batches are waiting for
+// it, consume() blocks.
+class ColumnarSink : public Sink {
+public:
+    struct Options {
+        std::filesystem::path dir = "data/columnar";
+        size_t batch_rows = 65536;
+        int flush_ms = 5000;
+        size_t max_fields = 128;  // payload columns per batch; further fields are dropped
+        int max_depth = 4;
+        size_t shards = 8;
+        size_t max_pending = 4;
+        // source (or "*") -> field path -> type
+        std::map<std::string, std::map<std::string, ColumnType>> schemas;
+    };
+
+    // Creates `dir`; throws std::runtime_error if it cannot be created.
+    explicit ColumnarSink(Options opts);
+    ~ColumnarSink() override;
+
+    void consume(const Event& ev) override;
+    std::string name() const override { return "columnar"; }
+    void bind_metrics(MetricsRegistry& reg) override;
+    void bind_memory(MemoryBudget& budget) override;
+
+    // Seals every open batch and waits until all of them are written.
+    void flush();
+
+private:
+    struct Batch;
+    using BatchPtr = std::unique_ptr<Batch>;
+
+    struct alignas(64) Shard {
+        std::mutex mu;
+        std::unordered_map<std::string, BatchPtr> open; // by source
+    };
+
+    void append(Batch& b, const Event& ev);
+    void seal(BatchPtr b);
+    void seal_stale(bool all);
+    void writer_loop();
+    void timer_loop();
+    void write_batch(Batch& b);
+    const std::map<std::string, ColumnType>* schema_for(const std::string& source) const;
+
+    Options opts_;
+    std::unique_ptr<Shard[]> shards_;
+
+    std::mutex q_mu_;
+    std::condition_variable q_cv_;    // writer: a batch is queued or we are stopping
+    std::condition_variable room_cv_; // producers: the queue drained
+    std::condition_variable idle_cv_; // flush(): everything written
+    std::deque<BatchPtr> queue_;
+    size_t inflight_ = 0;             // queued or being written
+    bool stopping_ = false;
+    uint64_t next_seq_ = 0;           // writer thread only
+
+    std::atomic<bool> running_{true};
+    std::mutex timer_mu_;
+    std::condition_variable timer_cv_;
+    std::thread writer_;
+    std::thread timer_;
+
+    Counter* rows_ = nullptr; // set by bind_metrics
+    Counter* segments_ = nullptr;
+    Counter* bytes_ = nullptr;
+    Counter* dropped_fields_ = nullptr;
+    Counter* errors_ = nullptr;
+    MemoryBudget::Account* account_ = nullptr; // set by bind_memory when accounting is on
+};
+
+} // namespace crossbring
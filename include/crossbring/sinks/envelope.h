@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "crossbring/core/clock.h"
+#include "crossbring/event.h"
+
+namespace crossbring {
+
+// Serialized event as served by the HTTP query endpoints:
+// {"source":..,"key":..,"ts_ns":..,"payload":..} with ts_ns in Unix ns. Raw
+// payloads are spliced in unparsed.
+// Appends to `doc`, so hot paths can reuse one buffer.
+inline void append_envelope_json(std::string& doc, const Event& ev) {
+    const int64_t ns = to_unix_ns(ev.tp);
+    doc.reserve(doc.size() + 64 + ev.source.size() + ev.key.size() + ev.raw.size());
+    doc += "{\"source\":";
+    doc += nlohmann::json(ev.source).dump();
+    doc += ",\"key\":";
+    doc += nlohmann::json(ev.key).dump();
+    doc += ",\"ts_ns\":";
+    doc += std::to_string(ns);
+    doc += ",\"payload\":";
+    ev.append_payload_text(doc);
+    doc += '}';
+}
+
+inline std::string envelope_json(const Event& ev) {
+    std::string doc;
+    append_envelope_json(doc, ev);
+    return doc;
+}
+
+} // namespace crossbring
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+
+#include "crossbring/sinks/envelope.h"
+#include "crossbring/sinks/sink.h"
+#include "crossbring/storage/event_index.h"
+
+namespace crossbring {
+
+// Serializes each event once and files the reference under (source, key) for /query.
+class EventIndexSink : public Sink {
+public:
+    explicit EventIndexSink(std::shared_ptr<EventIndex> index) : index_(std::move(index)) {}
+
+    void consume(const Event& ev) override {
+        const int64_t ns = to_unix_ns(ev.tp);
+        index_->add(ev.source, ev.key, ns, std::make_shared<const std::string>(envelope_json(ev)));
+    }
+    std::string name() const override { return "event_index"; }
+
+private:
+    std::shared_ptr<EventIndex> index_;
+};
+
+} // namespace crossbring
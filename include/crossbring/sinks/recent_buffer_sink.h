@@ -1,21 +1,40 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
 
+#include "crossbring/core/checkpoint.h"
+#include "crossbring/core/memory.h"
 #include "crossbring/sinks/sink.h"
 
 namespace crossbring {
 
-class RecentBuffer {
+// Ring of the newest items, bounded by count and optionally by estimated bytes
+// (the oldest items are evicted to make room). Items are immutable once pushed,
+// so a checkpoint only copies references under the lock.
+class RecentBuffer : public Checkpointable {
 public:
-    explicit RecentBuffer(size_t capacity) : capacity_(capacity) {}
+    explicit RecentBuffer(size_t capacity, size_t max_bytes = 0, MemoryBudget::Account* account = nullptr)
+        : capacity_(capacity), max_bytes_(max_bytes), account_(account) {}
+    ~RecentBuffer() {
+        if (account_) account_->release(bytes_);
+    }
 
     void push(nlohmann::json item) {
+        const size_t bytes = (account_ || max_bytes_) ? approx_bytes(item) : 0;
         std::lock_guard<std::mutex> lock(mu_);
-        if (buf_.size() >= capacity_) buf_.pop_front();
-        buf_.push_back(std::move(item));
+        while (!buf_.empty() && (buf_.size() >= capacity_ || (max_bytes_ && bytes_ + bytes > max_bytes_))) {
+            bytes_ -= buf_.front().bytes;
+            if (account_) account_->release(buf_.front().bytes);
+            buf_.pop_front();
+        }
+        buf_.push_back({std::make_shared<const nlohmann::json>(std::move(item)), bytes});
+        bytes_ += bytes;
+        if (account_) account_->charge(bytes);
+        pushes_.fetch_add(1, std::memory_order_relaxed);
     }
 
     nlohmann::json snapshot_json(size_t max_items = 0) {
@@ -23,14 +42,27 @@ public:
         nlohmann::json arr = nlohmann::json::array();
         size_t start = 0;
         if (max_items > 0 && buf_.size() > max_items) start = buf_.size() - max_items;
-        for (size_t i = start; i < buf_.size(); ++i) arr.push_back(buf_[i]);
+        for (size_t i = start; i < buf_.size(); ++i) arr.push_back(*buf_[i].item);
         return arr;
     }
 
+    uint64_t checkpoint_version() const override { return pushes_.load(std::memory_order_relaxed); }
+    void checkpoint(SnapshotWriter& out) const override;
+    void restore(SnapshotReader& in) override;
+
 private:
+    struct Entry {
+        std::shared_ptr<const nlohmann::json> item;
+        size_t bytes;
+    };
+
     size_t capacity_;
-    std::deque<nlohmann::json> buf_;
-    std::mutex mu_;
+    size_t max_bytes_;
+    MemoryBudget::Account* account_;
+    size_t bytes_ = 0;
+    std::deque<Entry> buf_;
+    mutable std::mutex mu_;
+    std::atomic<uint64_t> pushes_{0};
 };
 
 class RecentBufferSink : public Sink {
@@ -40,7 +72,7 @@ public:
         nlohmann::json j = {
             {"source", ev.source},
             {"key", ev.key},
-            {"payload", ev.payload}
+            {"payload", ev.json()}
         };
         buf_->push(std::move(j));
     }
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "crossbring/core/metrics.h"
+#include "crossbring/sinks/sink.h"
+#include "crossbring/transport/shm_ring.h"
+
+namespace crossbring {
+
+// Publishes each event as its JSON envelope (see envelope.h) into a
+// shared-memory ring for consumers on the same host; see ShmRingReader and
+// apps/shm_sub_demo.cpp. Workers encode outside the lock and only serialise on
+// the copy into the ring. Events that do not fit behind the slowest reader are
+// dropped and counted rather than stalling the engine.
+class ShmRingSink : public Sink {
+public:
+    struct Options {
+        std::string name = "crossbring";
+        size_t capacity = 64u << 20;
+        uint32_t max_readers = 16;
+    };
+
+    // Throws std::runtime_error if the segment cannot be created.
+    explicit ShmRingSink(Options opts);
+
+    void consume(const Event& ev) override;
+    std::string name() const override { return "shm(" + ring_->name() + ")"; }
+    void bind_metrics(MetricsRegistry& reg) override;
+
+private:
+    std::shared_ptr<ShmRingWriter> ring_; // shared with the scrape-time gauges, which hold it weakly
+    std::mutex mu_;
+
+    Counter* records_ = nullptr; // set by bind_metrics
+    Counter* bytes_ = nullptr;
+    Counter* dropped_ = nullptr;
+};
+
+} // namespace crossbring
+
+#endif // __linux__
@@ -2,16 +2,40 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "crossbring/event.h"
 
 namespace crossbring {
 
+class MemoryBudget;
+class MetricsRegistry;
+
+// An event shared read-only between sinks that hold on to it.
+using EventPtr = std::shared_ptr<const Event>;
+
 class Sink {
 public:
     virtual ~Sink() = default;
     virtual void consume(const Event& ev) = 0;
     virtual std::string name() const = 0;
+
+    // Sinks that keep events after consume() returns (batching, queues) return
+    // true and get consume_shared() instead: the engine moves the event into one
+    // shared allocation rather than each such sink copying it. Such sinks get the
+    // event last, after which the worker no longer touches it.
+    virtual bool retains_events() const { return false; }
+    virtual void consume_shared(const EventPtr& ev) { consume(*ev); }
+    // A whole batch in one call, as delivered by BatchingSink. Override to write
+    // it in one go (one transaction, one syscall); the default forwards each event.
+    virtual void consume_batch(const std::vector<EventPtr>& batch) {
+        for (auto& ev : batch) consume(*ev);
+    }
+
+    // Called once when the sink is added to an Engine; register extra series here.
+    virtual void bind_metrics(MetricsRegistry&) {}
+    // Called right after bind_metrics; sinks that buffer events open an account here.
+    virtual void bind_memory(MemoryBudget&) {}
 };
 
 } // namespace crossbring
@@ -7,7 +7,11 @@
 namespace crossbring {
 
 #ifdef USE_SQLITE
-std::shared_ptr<Sink> make_sqlite_sink(const std::string& path);
+class SqliteStore;
+
+// Appends events to a time-partitioned SqliteStore; batches go in one
+// transaction per partition.
+std::shared_ptr<Sink> make_sqlite_sink(std::shared_ptr<SqliteStore> store);
 #endif
 
 } // namespace crossbring
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+
+#include "crossbring/sinks/envelope.h"
+#include "crossbring/sinks/sink.h"
+#include "crossbring/storage/state_store.h"
+
+namespace crossbring {
+
+// Keeps the latest event per source and key in a StateStore (served on /state).
+class StateSink : public Sink {
+public:
+    explicit StateSink(std::shared_ptr<StateStore> store) : store_(std::move(store)) {}
+
+    // "<source>/<key>", so sources that reuse ids do not overwrite each other.
+    static std::string state_key(const Event& ev) { return ev.source + '/' + ev.key; }
+
+    void consume(const Event& ev) override {
+        const int64_t ns = to_unix_ns(ev.tp);
+        store_->upsert(state_key(ev), ns, std::make_shared<const std::string>(envelope_json(ev)));
+    }
+    std::string name() const override { return "state"; }
+
+private:
+    std::shared_ptr<StateStore> store_;
+};
+
+} // namespace crossbring
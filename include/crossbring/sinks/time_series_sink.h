@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crossbring/core/clock.h"
+#include "crossbring/sinks/sink.h"
+#include "crossbring/storage/time_series_store.h"
+
+namespace crossbring {
+
+// Feeds numeric payload fields into a TimeSeriesStore. The series for field
+// "value" is named after the event key; other fields use "<key>.<field>".
+class TimeSeriesSink : public Sink {
+public:
+    TimeSeriesSink(std::shared_ptr<TimeSeriesStore> store, std::vector<std::string> fields = {"value"})
+        : store_(std::move(store)), fields_(std::move(fields)) {}
+
+    void consume(const Event& ev) override {
+        const auto& p = ev.json();
+        if (!p.is_object()) return;
+        const int64_t ns = to_unix_ns(ev.tp);
+        for (const auto& f : fields_) {
+            auto it = p.find(f);
+            if (it == p.end() || !it->is_number()) continue;
+            store_->append(f == "value" ? ev.key : ev.key + "." + f, ns, it->get<double>());
+        }
+    }
+    std::string name() const override { return "time_series"; }
+
+private:
+    std::shared_ptr<TimeSeriesStore> store_;
+    std::vector<std::string> fields_;
+};
+
+} // namespace crossbring
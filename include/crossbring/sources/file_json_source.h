@@ -3,33 +3,51 @@
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <thread>
 
+#include "crossbring/core/checkpoint.h"
 #include "crossbring/core/engine.h"
+#include "crossbring/core/source_runtime.h"
+#include "crossbring/json/record_parser.h"
 
 namespace crossbring {
 
-// Polls a JSON file containing an array of objects and emits events for each
-class FileJsonSource {
+// Polls a JSON file containing an array of objects and emits events for each.
+// Records are split and keyed by a RecordParser; payloads stay raw until used.
+// Polls run as blocking tasks of the shared source runtime. The fingerprint of
+// the last file read (size and mtime) is its checkpoint, so a restart does not
+// emit an unchanged file again.
+class FileJsonSource : public Checkpointable {
 public:
-    FileJsonSource(Engine& engine, std::string source_name, std::filesystem::path file, int interval_ms = 1000)
-        : engine_(engine), source_name_(std::move(source_name)), file_(std::move(file)), interval_ms_(interval_ms) {}
+    FileJsonSource(Engine& engine, SourceRuntime& runtime, std::string source_name, std::filesystem::path file,
+                   int interval_ms = 1000, const std::string& parser = "auto")
+        : engine_(engine), runtime_(runtime), source_name_(std::move(source_name)), file_(std::move(file)),
+          interval_ms_(interval_ms), parser_(make_record_parser(parser)) {}
+    ~FileJsonSource() { stop(); }
 
     void start();
     void stop();
 
+    uint64_t checkpoint_version() const override { return loads_.load(std::memory_order_relaxed); }
+    void checkpoint(SnapshotWriter& out) const override;
+    void restore(SnapshotReader& in) override;
+
 private:
-    void run();
+    void poll();
     bool load_once();
 
     Engine& engine_;
+    SourceRuntime& runtime_;
     std::string source_name_;
     std::filesystem::path file_;
     int interval_ms_;
-    std::atomic<bool> running_{false};
-    std::thread th_;
-    std::string last_fingerprint_;
+    std::unique_ptr<RecordParser> parser_;
+    SourceRuntime::TimerId timer_ = 0;
+    mutable std::mutex fp_mu_;
+    std::string last_fingerprint_; // guarded by fp_mu_
+    std::atomic<uint64_t> loads_{0};
 };
 
 } // namespace crossbring
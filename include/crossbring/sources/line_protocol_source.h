@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#ifdef USE_EPOLL
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "crossbring/core/engine.h"
+
+namespace crossbring {
+
+// Ingests line protocol (`measurement,tag=v field=1.23 [ts]`) over TCP and UDP.
+// A single thread drives an epoll loop over the listeners and every accepted
+// connection; UDP datagrams are drained with recvmmsg. Lines are parsed in place
+// from the receive buffers and submitted to the engine in batches.
+class LineProtocolSource {
+public:
+    struct Options {
+        std::string host = "0.0.0.0";
+        int tcp_port = 8094;   // 0 disables TCP
+        int udp_port = 8094;   // 0 disables UDP
+        size_t batch_size = 256;
+        size_t max_line = 64 * 1024;
+        int max_connections = 10000;
+        int cpu = -1;  // pin the epoll thread to this CPU; -1 = unpinned
+    };
+
+    LineProtocolSource(Engine& engine, Options opts);
+    ~LineProtocolSource();
+
+    void start();
+    void stop();
+
+    // Parses one line (without trailing newline) into `ev`. Returns false on malformed input.
+    static bool parse_line(std::string_view line, Event& ev);
+
+private:
+    struct Conn {
+        int fd = -1;
+        std::vector<char> buf;
+        size_t len = 0;
+        bool discarding = false; // dropping an oversized line up to its '\n'
+    };
+
+    void run();
+    bool open_listeners();
+    void close_all();
+    void accept_ready();
+    void read_conn(Conn& c);
+    void read_udp();
+    size_t consume_lines(const char* data, size_t len, bool final);
+    void emit(std::string_view line);
+    void flush_batch();
+    void close_conn(int fd);
+
+    Engine& engine_;
+    Options opts_;
+    int epfd_ = -1;
+    int tcp_fd_ = -1;
+    int udp_fd_ = -1;
+    int wake_fd_ = -1;
+    std::unordered_map<int, std::unique_ptr<Conn>> conns_;
+    std::vector<Event> batch_;
+    std::atomic<bool> running_{false};
+    std::thread th_;
+
+    // Registered in engine_.metrics()
+    Gauge& connections_;
+    Counter& accepted_total_;
+    Counter& bytes_total_;
+    Counter& lines_total_;
+    Counter& parse_errors_total_;
+    Counter& datagrams_total_;
+};
+
+} // namespace crossbring
+
+#endif // USE_EPOLL
@@ -1,30 +1,35 @@
 ﻿#pragma once
 
-#include <atomic>
 #include <random>
 #include <string>
-#include <thread>
 
 #include "crossbring/core/engine.h"
+#include "crossbring/core/source_runtime.h"
 
 namespace crossbring {
 
+// Emits one normally distributed reading every `period_ms`, on a fixed-rate
+// timer of the shared source runtime. Readings are dropped, not queued, while
+// the engine queue is full.
 class SensorSimulator {
 public:
-    SensorSimulator(Engine& engine, std::string sensor_name, int period_ms = 50)
-        : engine_(engine), sensor_name_(std::move(sensor_name)), period_ms_(period_ms) {}
+    SensorSimulator(Engine& engine, SourceRuntime& runtime, std::string sensor_name, int period_ms = 50)
+        : engine_(engine), runtime_(runtime), sensor_name_(std::move(sensor_name)), period_ms_(period_ms) {}
+    ~SensorSimulator() { stop(); }
 
     void start();
     void stop();
 
 private:
-    void run();
+    void sample();
 
     Engine& engine_;
+    SourceRuntime& runtime_;
     std::string sensor_name_;
     int period_ms_;
-    std::atomic<bool> running_{false};
-    std::thread th_;
+    std::mt19937 rng_{std::random_device{}()};
+    std::normal_distribution<double> dist_{50.0, 10.0};
+    SourceRuntime::TimerId timer_ = 0;
 };
 
 } // namespace crossbring
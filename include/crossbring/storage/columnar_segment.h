@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crossbring/storage/mapped_file.h"
+
+namespace crossbring {
+
+// Column types of a columnar segment. Dict columns hold one uint32 code per row
+// into a per-column dictionary of strings.
+enum class ColumnType : uint8_t { Int64 = 0, Float64 = 1, Bool = 2, String = 3, Dict = 4 };
+
+const char* column_type_name(ColumnType t);
+// "int64" | "float64" | "bool" | "string" | "dict"; throws std::invalid_argument.
+ColumnType parse_column_type(const std::string& s);
+
+// Subdirectory holding a source's segments: the name with anything outside
+// [A-Za-z0-9_-] replaced by '_'.
+std::string segment_dir_name(const std::string& source);
+
+// One column of a batch, as handed to write_columnar_segment().
+struct ColumnBuffer {
+    std::string name;
+    ColumnType type = ColumnType::Int64;
+    std::vector<uint8_t> valid;       // one flag per row; empty means no nulls
+    std::vector<int64_t> i64;         // Int64
+    std::vector<double> f64;          // Float64
+    std::vector<uint8_t> b;           // Bool
+    std::vector<uint32_t> codes;      // Dict
+    std::vector<std::string> strings; // String: one per row; Dict: the dictionary
+};
+
+// Writes one batch as a segment file: a fixed header, a column directory and
+// 64-byte-aligned buffers (validity bitmap, values, string offsets and bytes),
+// in the spirit of an Arrow IPC record batch. Numeric columns carry min/max, and
+// the header carries the time range of the `ts_ns` column, so readers can skip
+// a segment after touching one page. Writes `out` + ".tmp" and renames it.
+// Throws std::runtime_error on I/O failure.
+void write_columnar_segment(const std::filesystem::path& out, const std::string& source,
+                            const std::vector<ColumnBuffer>& columns, size_t rows);
+
+// Zero-copy reader over a mapped segment. Column accessors return pointers into
+// the mapping, valid while the segment is alive.
+class ColumnarSegment {
+public:
+    class Column {
+    public:
+        std::string_view name() const;
+        ColumnType type() const;
+        bool is_null(size_t row) const;
+        size_t null_count() const;
+        bool has_stats() const;   // Int64 and Float64 columns with a valid row
+        double min() const;
+        double max() const;
+
+        const int64_t* i64() const;  // Int64
+        const double* f64() const;   // Float64
+        const uint8_t* bools() const; // Bool
+        const uint32_t* codes() const; // Dict
+        // String value of a String or Dict row; empty for nulls.
+        std::string_view str(size_t row) const;
+        size_t dict_size() const;
+        std::string_view dict(size_t code) const;
+
+    private:
+        friend class ColumnarSegment;
+        const ColumnarSegment* seg_ = nullptr;
+        const void* meta_ = nullptr;
+    };
+
+    // Maps a segment; throws std::runtime_error if it is missing or corrupt.
+    static std::shared_ptr<const ColumnarSegment> open(const std::filesystem::path& file);
+
+    // Segments under `dir` (one subdirectory per source, see segment_dir_name)
+    // whose time range meets [from_ns, to_ns) in Unix ns; an empty `source` means all
+    // sources. Reads only each file's header, so files with a bad header are
+    // skipped but other corruption surfaces in open(). Sorted by path, which is
+    // write order within a source.
+    static std::vector<std::filesystem::path> find(const std::filesystem::path& dir, const std::string& source,
+                                                   int64_t from_ns, int64_t to_ns);
+
+    std::string_view source() const;
+    size_t rows() const;
+    int64_t min_ts() const;
+    int64_t max_ts() const;
+    size_t columns() const;
+    Column column(size_t i) const;
+    std::optional<Column> find_column(std::string_view name) const;
+    size_t file_bytes() const { return file_.size(); }
+
+private:
+    ColumnarSegment() = default;
+    const char* at(uint64_t off) const { return file_.data() + off; }
+
+    MappedFile file_;
+    const void* header_ = nullptr;
+    const void* dir_ = nullptr;
+};
+
+} // namespace crossbring
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace crossbring {
+
+// In-memory index from (source, key) to time-ordered references of serialized
+// events. Lookups binary-search the time bounds; results are handed out in
+// batches of shared references so queries never copy event bodies or hold a
+// series lock while the caller writes them out.
+class EventIndex {
+public:
+    struct Options {
+        size_t max_events = 200000;   // across all series; oldest-inserted evicted first
+        size_t max_per_key = 10000;
+    };
+    using DocRef = std::shared_ptr<const std::string>;
+    using BatchFn = std::function<bool(const std::vector<DocRef>&)>;
+
+    explicit EventIndex(Options opts) : opts_(opts) {}
+    EventIndex() : EventIndex(Options{}) {}
+
+    void add(const std::string& source, const std::string& key, int64_t ts_ns, DocRef doc);
+
+    // Streams events with from_ns <= ts <= to_ns in ascending time, at most `limit`,
+    // in batches of up to `batch`. An empty key matches every key of `source`.
+    // fn returns false to stop. Returns the number of events delivered.
+    size_t query(const std::string& source, const std::string& key, int64_t from_ns, int64_t to_ns,
+                 size_t limit, const BatchFn& fn, size_t batch = 256) const;
+
+    size_t size() const { return total_.load(std::memory_order_relaxed); }
+    size_t series_count() const;
+
+private:
+    struct Entry {
+        int64_t ts;
+        DocRef doc;
+    };
+    struct Series {
+        mutable std::mutex mu;
+        std::deque<Entry> entries;  // ascending ts
+        size_t trimmed = 0;         // local evictions not yet matched in the global FIFO
+    };
+
+    std::shared_ptr<Series> find(const std::string& source, const std::string& key) const;
+    std::vector<std::shared_ptr<Series>> find_source(const std::string& source) const;
+    size_t query_series(const Series& s, int64_t from_ns, int64_t to_ns, size_t limit,
+                        const BatchFn& fn, size_t batch) const;
+    void evict_global();
+    void compact_fifo();
+
+    Options opts_;
+    mutable std::shared_mutex map_mu_;
+    std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<Series>>> by_source_;
+    std::mutex fifo_mu_;
+    std::deque<std::shared_ptr<Series>> fifo_; // one entry per inserted event
+    std::atomic<size_t> total_{0};
+};
+
+} // namespace crossbring
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "crossbring/storage/mapped_file.h"
+
+namespace crossbring {
+
+// Read-only reference table served straight from a memory-mapped file. The file
+// is an open-addressing hash index (load factor <= 1/2, linear probing) over
+// fixed-size row cells plus one string blob, so a lookup hashes the key, probes
+// a slot or two and returns views into the mapping without copying or parsing.
+// The layout uses native byte order; compile tables on the machine that reads them.
+class LookupTable {
+public:
+    struct Value {
+        enum class Type : uint8_t { Null, Bool, Number, String, Json };
+        Type type = Type::Null;
+        bool b = false;
+        double num = 0.0;
+        std::string_view str; // String text, or serialized JSON for nested values
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Builds a table file from CSV (header row, RFC 4180 quoting) or JSON (an
+    // array of objects, or an object mapping key to object). `key_column` names
+    // the join key; every other column is stored. Writes `out` + ".tmp" and
+    // renames it over `out`, so readers never see a partial file.
+    // Throws std::runtime_error on unreadable input or a missing key column.
+    static void compile(const std::filesystem::path& src, const std::filesystem::path& out,
+                        const std::string& key_column);
+
+    // Maps a compiled table; throws std::runtime_error if it is missing or corrupt.
+    static std::shared_ptr<const LookupTable> open(const std::filesystem::path& file);
+
+    LookupTable(const LookupTable&) = delete;
+    LookupTable& operator=(const LookupTable&) = delete;
+
+    size_t rows() const { return rows_; }
+    size_t columns() const { return columns_; }
+    std::string_view column(size_t c) const;
+    size_t column_index(std::string_view name) const; // npos if absent
+
+    // Row holding `key`, or npos.
+    size_t find(std::string_view key) const;
+    Value value(size_t row, size_t column) const;
+    size_t file_bytes() const { return file_.size(); }
+
+private:
+    struct Header;
+    struct Slot;
+    struct Cell;
+
+    LookupTable() = default;
+    std::string_view blob(uint64_t off, uint32_t len) const;
+
+    MappedFile file_;
+    const Header* header_ = nullptr;
+    const Slot* slots_ = nullptr;
+    const Cell* cells_ = nullptr; // rows_ x columns_
+    const Cell* names_ = nullptr; // columns_
+    const char* blob_ = nullptr;
+    size_t blob_len_ = 0;
+    size_t rows_ = 0, columns_ = 0;
+    uint64_t slot_mask_ = 0;
+};
+
+} // namespace crossbring
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace crossbring {
+
+// Read-only memory mapping of a whole file. The mapping outlives the file name,
+// so writers can replace the file (write + rename) while readers keep theirs.
+class MappedFile {
+public:
+    MappedFile() = default;
+    // Throws std::runtime_error if the file cannot be opened or mapped (or is empty).
+    explicit MappedFile(const std::filesystem::path& file);
+    ~MappedFile();
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(map_); }
+    size_t size() const { return size_; }
+
+private:
+    void reset();
+
+    void* map_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+} // namespace crossbring
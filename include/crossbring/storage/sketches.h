@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crossbring {
+
+// 64-bit string hash with well-mixed bits (FNV-1a plus a splitmix64 finisher).
+// The sketches index by hash bits directly, which std::hash does not make safe.
+uint64_t sketch_hash(std::string_view s);
+
+// Count-Min sketch with conservative update, plus the k keys with the highest
+// estimates seen so far. Estimates never undercount; they overcount by at most
+// about e/width of the total with high probability.
+class HeavyHitters {
+public:
+    explicit HeavyHitters(size_t width = 128, size_t depth = 4, size_t k = 16);
+
+    void add(std::string_view key, uint64_t n = 1);
+    uint64_t estimate(std::string_view key) const { return estimate_hashed(sketch_hash(key)); }
+    // Both sketches must have the same width and depth.
+    void merge(const HeavyHitters& other);
+    // Heaviest keys, largest first.
+    std::vector<std::pair<std::string, uint64_t>> top() const;
+    size_t memory_bytes() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t hash;
+        uint64_t count;
+    };
+
+    size_t cell(size_t row, uint64_t hash) const;
+    uint64_t estimate_hashed(uint64_t hash) const;
+    void offer(std::string_view key, uint64_t hash, uint64_t count);
+
+    size_t width_, depth_, k_;
+    std::vector<uint64_t> cells_; // depth_ rows of width_
+    std::vector<Entry> top_;      // at most k_, unordered
+    uint64_t min_count_ = 0;      // smallest count in top_ once it is full
+};
+
+// HyperLogLog distinct counter with 2^precision one-byte registers; standard
+// error is about 1.04 / sqrt(2^precision) (3.3% at the default 1 KB).
+class HyperLogLog {
+public:
+    explicit HyperLogLog(unsigned precision = 10);
+
+    void add_hash(uint64_t hash);
+    void add(std::string_view key) { add_hash(sketch_hash(key)); }
+    void merge(const HyperLogLog& other); // same precision
+    double estimate() const;
+    size_t memory_bytes() const { return registers_.size(); }
+
+private:
+    unsigned p_;
+    std::vector<uint8_t> registers_;
+};
+
+// KLL quantile sketch: a stack of compactors whose capacities shrink
+// geometrically towards the bottom level. Space is O(k) regardless of stream
+// length and rank error is roughly 1.7 / k; sketches merge by concatenating levels.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(uint32_t k = 128);
+
+    void add(double v);
+    void merge(const QuantileSketch& other);
+    // q in [0, 1]; NaN when empty.
+    double quantile(double q) const;
+    uint64_t count() const { return n_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+    size_t memory_bytes() const;
+
+private:
+    size_t capacity(size_t level) const { return caps_[level]; }
+    void add_level();
+    void compress();
+
+    uint32_t k_;
+    uint64_t n_ = 0;
+    double min_, max_;
+    uint64_t coin_ = 0x9e3779b97f4a7c15ull; // xorshift state for compaction offsets
+    std::vector<std::vector<double>> levels_; // item weight is 2^level
+    std::vector<size_t> caps_;                // per level, recomputed when a level is added
+};
+
+} // namespace crossbring
@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#ifdef USE_SQLITE
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "crossbring/core/metrics.h"
+#include "crossbring/sinks/sink.h"
+
+struct sqlite3;
+
+namespace crossbring {
+
+// Event history in SQLite, one database file per hour or day of UTC time:
+// <dir>/events-YYYYMMDDHH.sqlite (or events-YYYYMMDD.sqlite). ts_ns is Unix ns.
+//
+// Writers only append to the newest `open_partitions` files, so insert cost
+// does not grow with history. A partition is indexed on (source, key, ts_ns)
+// by a background thread once it is sealed (its writer slot went to a newer
+// partition), so the hot partition takes plain appends; `index_on_write`
+// indexes it as rows arrive instead. Retention deletes whole files older than
+// `retention_hours`, without row DELETEs or any writer lock. Queries open only
+// the partitions overlapping the requested range.
+class SqliteStore {
+public:
+    struct Options {
+        std::filesystem::path dir = "data/sqlite";
+        std::string partition = "hour"; // "hour" or "day"
+        int retention_hours = 0;         // 0 keeps every partition
+        bool index_on_write = false;
+        size_t open_partitions = 2;      // writers kept open for late events
+    };
+
+    struct Row {
+        int64_t ts_ns;
+        std::string_view source;
+        std::string_view key;
+        std::string_view payload;
+    };
+
+    struct Query {
+        std::string source; // empty matches any
+        std::string key;    // empty matches any
+        int64_t from_ns = 0;
+        int64_t to_ns = std::numeric_limits<int64_t>::max(); // exclusive
+        size_t limit = 1000;
+    };
+
+    struct Partition {
+        int64_t start_ns;
+        int64_t end_ns;
+        std::filesystem::path path;
+    };
+
+    // Throws std::runtime_error for a bad partition name or an unusable dir.
+    SqliteStore(Options opts, MetricsRegistry& reg);
+    ~SqliteStore();
+    SqliteStore(const SqliteStore&) = delete;
+    SqliteStore& operator=(const SqliteStore&) = delete;
+
+    void append(const Event& ev);
+    // One transaction per partition the batch touches.
+    void append(const std::vector<EventPtr>& batch);
+
+    // Matching rows in ts_ns order, until `limit` rows or fn returns false.
+    // Returns the number of partitions read.
+    size_t query(const Query& q, const std::function<bool(const Row&)>& fn) const;
+    // Partition files on disk, oldest first.
+    std::vector<Partition> partitions() const;
+
+private:
+    struct Writer;
+
+    Writer* writer_for(int64_t part); // caller holds mu_; nullptr if it cannot be opened
+    void insert(Writer& w, const Event& ev, int64_t ts);
+    void seal(std::unique_ptr<Writer> w);
+    void maintain();
+    void sweep();
+    bool build_index(const std::filesystem::path& path);
+    std::filesystem::path path_of(int64_t part) const;
+
+    Options opts_;
+    int64_t span_ns_;
+
+    std::mutex mu_; // writers_
+    std::vector<std::unique_ptr<Writer>> writers_; // least recently used first
+
+    std::mutex maint_mu_;
+    std::condition_variable maint_cv_;
+    bool stop_ = false;
+    std::vector<std::filesystem::path> to_index_;
+    std::unordered_set<std::string> indexed_; // maintenance thread only
+    std::thread maint_;
+
+    Counter& rows_;
+    Counter& errors_;
+    Counter& late_;
+    Counter& dropped_;
+    Gauge& partitions_;
+    Histogram& index_seconds_;
+};
+
+} // namespace crossbring
+
+#endif // USE_SQLITE
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crossbring/core/checkpoint.h"
+
+namespace crossbring {
+
+// Latest serialized event per key, split over independently locked shards so an
+// upsert only excludes readers of its own shard. Every change takes a version
+// from a global counter, which lets pollers ask for "changed since N".
+class StateStore : public Checkpointable {
+public:
+    using DocRef = std::shared_ptr<const std::string>;
+    using VisitFn = std::function<void(const std::string& key, uint64_t version, const DocRef& doc)>;
+
+    explicit StateStore(size_t shards = 64);
+
+    // Keeps the event with the newest ts_ns per key; older arrivals are ignored.
+    void upsert(const std::string& key, int64_t ts_ns, DocRef doc);
+
+    DocRef get(const std::string& key, uint64_t* version = nullptr) const;
+
+    // Visits keys whose version is greater than `since` and returns the version a
+    // poller should pass next time. Nothing changed after that point is missed.
+    uint64_t changed_since(uint64_t since, const VisitFn& fn) const;
+
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+    size_t size() const;
+
+    // Documents are shared and immutable, so a checkpoint holds each shard's
+    // read lock only while copying references. Restored entries rank older
+    // than any new event for their key.
+    uint64_t checkpoint_version() const override { return version(); }
+    void checkpoint(SnapshotWriter& out) const override;
+    void restore(SnapshotReader& in) override;
+
+private:
+    struct Entry {
+        uint64_t version;
+        int64_t ts;
+        DocRef doc;
+    };
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mu;
+        std::unordered_map<std::string, Entry> map;
+    };
+
+    Shard& shard_for(const std::string& key) const { return shards_[std::hash<std::string>{}(key) % shards_.size()]; }
+
+    mutable std::vector<Shard> shards_;
+    std::atomic<uint64_t> version_{0};
+};
+
+} // namespace crossbring
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crossbring/core/metrics.h"
+
+namespace crossbring {
+
+// Gorilla-style compressed block of (timestamp, double) points: delta-of-delta
+// timestamps at microsecond resolution and XOR-encoded values.
+class GorillaChunk {
+public:
+    void append(int64_t ts_us, double value);
+    // Decodes in append order; fn returns false to stop early.
+    void decode(const std::function<bool(int64_t ts_us, double value)>& fn) const;
+    void seal() { words_.shrink_to_fit(); }
+
+    uint32_t count() const { return count_; }
+    int64_t min_ts() const { return min_ts_; }
+    int64_t max_ts() const { return max_ts_; }
+    size_t bytes() const { return sizeof(*this) + words_.capacity() * sizeof(uint64_t); }
+
+private:
+    void put(uint64_t bits, int n);
+
+    std::vector<uint64_t> words_;
+    size_t nbits_ = 0;
+    uint32_t count_ = 0;
+    int64_t min_ts_ = 0;
+    int64_t max_ts_ = 0;
+    int64_t prev_ts_ = 0;
+    int64_t prev_delta_ = 0;
+    uint64_t prev_value_ = 0;
+    int prev_lead_ = -1;
+    int prev_trail_ = 0;
+};
+
+// In-memory per-series store of compressed chunks under a global memory budget.
+// When the budget is exceeded the oldest chunks (by creation) are evicted.
+class TimeSeriesStore {
+public:
+    struct Options {
+        size_t memory_budget_bytes = 64u << 20;
+        uint32_t points_per_chunk = 1024;
+    };
+
+    // Registers crossbring_tsdb_* in reg; the store must outlive scrapes of it.
+    TimeSeriesStore(Options opts, MetricsRegistry& reg);
+
+    void append(const std::string& series, int64_t ts_ns, double value);
+
+    // Visits points of `series` with from_ns <= ts <= to_ns, decoding straight from
+    // the compressed chunks. fn returns false to stop. Returns the points visited.
+    size_t scan(const std::string& series, int64_t from_ns, int64_t to_ns,
+                const std::function<bool(int64_t ts_ns, double value)>& fn) const;
+
+    std::vector<std::string> series_names() const;
+    size_t memory_bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t point_count() const { return points_.load(std::memory_order_relaxed); }
+
+private:
+    struct Series {
+        mutable std::mutex mu;
+        std::deque<std::shared_ptr<const GorillaChunk>> sealed;
+        GorillaChunk active;
+        uint64_t first_seq = 0;   // creation sequence of the oldest chunk held
+        uint64_t next_seq = 0;    // creation sequence of the active chunk
+    };
+    struct ChunkRef {
+        std::shared_ptr<Series> series;
+        uint64_t seq;
+    };
+
+    std::shared_ptr<Series> find_or_create(const std::string& series);
+    void enforce_budget();
+
+    Options opts_;
+    mutable std::shared_mutex map_mu_;
+    std::unordered_map<std::string, std::shared_ptr<Series>> series_;
+    std::mutex evict_mu_;
+    std::deque<ChunkRef> fifo_; // chunks in creation order, oldest first
+    std::atomic<size_t> bytes_{0};
+    std::atomic<uint64_t> points_{0};
+    Counter& evicted_chunks_;
+    Counter& evicted_points_;
+};
+
+} // namespace crossbring
@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace crossbring {
+
+// Broadcast ring in POSIX shared memory (/dev/shm/<name>): one writer, up to
+// `max_readers` readers, each with its own cursor. Records are length-prefixed
+// and 8-byte aligned; a record that would straddle the end of the ring is
+// preceded by a padding record and starts again at offset 0.
+//
+// The writer never blocks. It may reuse space only once every attached reader
+// has moved past it; when the slowest reader leaves no room the record is
+// dropped and counted. Slots of readers whose process has exited are reclaimed
+// when the ring is full.
+//
+// Readers see records in place (no copy) and wake through a futex on the shared
+// mapping, after an optional spin, so an idle reader costs no CPU and a busy one
+// makes no syscalls.
+//
+// This header and src/transport/shm_ring.cpp have no dependencies beyond libc,
+// so consumers link the small crossbring_shm library only.
+namespace shm {
+
+inline constexpr char kMagic[8] = {'C', 'B', 'S', 'H', 'M', 'R', 'G', '1'};
+inline constexpr uint32_t kRecordData = 1;
+inline constexpr uint32_t kRecordPad = 2;
+
+struct RecordHeader {
+    uint32_t size; // payload bytes (data) or bytes to skip including this header (pad)
+    uint32_t type;
+};
+
+enum SlotState : uint32_t { kSlotFree = 0, kSlotClaiming = 1, kSlotActive = 2 };
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> cursor;
+    std::atomic<uint32_t> state;
+    std::atomic<int32_t> pid;
+};
+
+struct alignas(64) Header {
+    char magic[8];          // written last by the writer, once the ring is initialised
+    uint64_t capacity;      // data bytes, a power of two
+    uint32_t max_readers;
+    int32_t writer_pid;
+    alignas(64) std::atomic<uint64_t> write_pos; // bytes published so far
+    std::atomic<uint32_t> closed;
+    alignas(64) std::atomic<uint32_t> seq;       // futex word, bumped on publish when someone waits
+    std::atomic<uint32_t> waiters;
+    // ReaderSlot[max_readers] follows, then `capacity` data bytes.
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory ring needs lock-free atomics");
+
+inline size_t slots_offset() { return sizeof(Header); }
+inline size_t data_offset(uint32_t max_readers) { return sizeof(Header) + sizeof(ReaderSlot) * max_readers; }
+inline size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+} // namespace shm
+
+class ShmRingWriter {
+public:
+    struct Options {
+        size_t capacity = 64u << 20; // rounded up to a power of two
+        uint32_t max_readers = 16;
+    };
+
+    // Creates (or replaces) /dev/shm/<name>. Readers still attached to a replaced
+    // ring see it as closed. Throws std::runtime_error on failure.
+    ShmRingWriter(const std::string& name, Options opts);
+    // Marks the ring closed, wakes every reader and unlinks the name.
+    ~ShmRingWriter();
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Publishes one record. Returns false (and writes nothing) when it does not
+    // fit behind the slowest reader or is larger than the ring. Not thread-safe:
+    // callers serialise writes.
+    bool write(std::string_view data);
+
+    size_t readers() const;
+    uint64_t max_lag() const; // bytes the slowest reader has yet to read
+    const std::string& name() const { return name_; }
+    size_t capacity() const { return static_cast<size_t>(hdr_->capacity); }
+
+private:
+    uint64_t rescan(bool reap);
+
+    std::string name_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    shm::Header* hdr_ = nullptr;
+    shm::ReaderSlot* slots_ = nullptr;
+    char* data_ = nullptr;
+    uint64_t mask_ = 0;
+    uint64_t pos_ = 0;   // local copy of write_pos
+    uint64_t limit_ = 0; // write_pos may advance up to here without rescanning readers
+};
+
+class ShmRingReader {
+public:
+    // Attaches to /dev/shm/<name> and starts at the newest record. Throws
+    // std::runtime_error if the ring does not exist, is not initialised yet, or
+    // has no free reader slot.
+    explicit ShmRingReader(const std::string& name);
+    ~ShmRingReader();
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // Calls fn(std::string_view) for each published record, up to `max`, and
+    // returns how many it saw. The view points into the ring and is only valid
+    // during the call. Never blocks.
+    template <class F>
+    size_t poll(F&& fn, size_t max = SIZE_MAX) {
+        const uint64_t end = hdr_->write_pos.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (cursor_ < end && n < max) {
+            const char* p = data_ + (cursor_ & mask_);
+            shm::RecordHeader rh;
+            std::memcpy(&rh, p, sizeof(rh));
+            if (rh.type == shm::kRecordPad) {
+                cursor_ += rh.size;
+                continue;
+            }
+            fn(std::string_view(p + sizeof(rh), rh.size));
+            cursor_ += shm::align8(sizeof(rh) + rh.size);
+            ++n;
+        }
+        slot_->cursor.store(cursor_, std::memory_order_release); // frees the space for the writer
+        return n;
+    }
+
+    // Waits until a record is available, the ring is closed or `timeout` passes.
+    // Spins for up to `spin` first, then sleeps on the futex. Returns true when
+    // there is something to poll.
+    bool wait(std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin = std::chrono::microseconds(50));
+
+    // The writer closed the ring, replaced it, or exited without closing it.
+    bool closed() const;
+    uint64_t lag() const { return hdr_->write_pos.load(std::memory_order_relaxed) - cursor_; }
+
+private:
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    shm::Header* hdr_ = nullptr;
+    shm::ReaderSlot* slot_ = nullptr;
+    const char* data_ = nullptr;
+    uint64_t mask_ = 0;
+    uint64_t cursor_ = 0;
+};
+
+} // namespace crossbring
+
+#endif // __linux__
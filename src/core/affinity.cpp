@@ -0,0 +1,41 @@
+#include "crossbring/core/affinity.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#ifdef USE_NUMA
+#include <numa.h>
+#endif
+
+namespace crossbring {
+
+bool pin_current_thread(int cpu) {
+    if (cpu < 0) return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    return false;
+#endif
+}
+
+bool bind_memory_local() {
+#ifdef USE_NUMA
+    if (numa_available() < 0) return false;
+    numa_set_localalloc();
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace crossbring
@@ -0,0 +1,30 @@
+#include "crossbring/core/clock.h"
+
+namespace crossbring {
+
+namespace {
+
+int64_t steady_ns(std::chrono::steady_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+// Unix minus steady-clock ns, fixed at first use.
+int64_t offset_ns() {
+    static const int64_t offset = unix_now_ns() - steady_ns(std::chrono::steady_clock::now());
+    return offset;
+}
+
+} // namespace
+
+int64_t unix_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t to_unix_ns(std::chrono::steady_clock::time_point tp) { return steady_ns(tp) + offset_ns(); }
+
+int64_t steady_to_unix_ns(int64_t ns) { return ns + offset_ns(); }
+
+int64_t unix_to_steady_ns(int64_t ns) { return ns - offset_ns(); }
+
+} // namespace crossbring
@@ -1,65 +1,540 @@
 #include "crossbring/core/engine.h"
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
 #include <mutex>
+#include <stdexcept>
+#include <unordered_map>
 
+#include "crossbring/core/affinity.h"
 #include "crossbring/sinks/sink.h"
 
 namespace crossbring {
 
-Engine::Engine(size_t queue_capacity, size_t workers, bool drop_on_full)
-    : queue_(queue_capacity), drop_on_full_(drop_on_full) {
-    if (workers == 0) workers = 1;
-    workers_.reserve(workers);
+Engine::Engine(size_t queue_capacity, size_t workers, Backpressure backpressure)
+    : memory_(metrics_),
+      tracer_(metrics_),
+      submit_span_(tracer_.intern("submit")),
+      queue_span_(tracer_.intern("queued")),
+      process_span_(tracer_.intern("process")),
+      processed_(metrics_.counter("crossbring_processed_total", "Total processed events")),
+      dropped_(metrics_.counter("crossbring_dropped_total", "Total dropped events")),
+      source_events_(metrics_.counter_vec("crossbring_source_events_total", "Processed events per source", "source")),
+      source_dropped_(metrics_.counter_vec("crossbring_source_dropped_total", "Dropped events per source", "source")),
+      filtered_(metrics_.counter("crossbring_filtered_total", "Events dropped by pipeline filters")),
+      failed_(metrics_.counter("crossbring_failed_total", "Events dropped because a processor or sink threw")),
+      conflated_(metrics_.counter("crossbring_conflated_total", "Queued events replaced by a newer one for their key")),
+      source_conflated_(metrics_.counter_vec("crossbring_source_conflated_total", "Conflated events per source", "source")),
+      budget_waits_(metrics_.counter("crossbring_memory_backpressure_total", "Submits delayed or shed because the memory budget was exhausted")),
+      workers_gauge_(metrics_.gauge("crossbring_workers", "Engine worker threads")),
+      queue_(queue_capacity), fixed_workers_(workers == 0 ? 1 : workers),
+      pipeline_(std::make_shared<const Pipeline>()), backpressure_(backpressure) {
+    metrics_.gauge_fn("crossbring_queue_depth", "Events waiting in the engine queue", {},
+                      [this]{ return static_cast<double>(queue_.size()); });
+    metrics_.gauge("crossbring_queue_capacity", "Engine queue capacity").set(static_cast<int64_t>(queue_capacity));
 }
 
 Engine::~Engine() { stop(); }
 
+void Engine::set_memory_options(const MemoryOptions& opts) {
+    memory_.configure(opts.enabled, opts.limit_bytes);
+    if (!opts.enabled) return;
+    queue_.set_byte_capacity(opts.queue_max_bytes, [](const Event& ev){ return approx_bytes(ev); },
+                             memory_.account("engine_queue"));
+    spdlog::info("Memory accounting on: budget={} bytes, queue bound={} bytes", opts.limit_bytes, opts.queue_max_bytes);
+}
+
 void Engine::start() {
     if (running_.exchange(true)) return;
-    spdlog::info("Engine starting with {} worker(s)", workers_.capacity());
-    for (size_t i = 0; i < workers_.capacity(); ++i) {
-        workers_.emplace_back([this]{ worker_loop(); });
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    size_t initial = fixed_workers_;
+    if (elastic_.enabled) {
+        elastic_.min_workers = std::max<size_t>(1, elastic_.min_workers);
+        elastic_.max_workers = std::max(elastic_.min_workers, elastic_.max_workers);
+        initial = elastic_.min_workers;
+        slots_.resize(elastic_.max_workers);
+        spdlog::info("Engine starting elastic pool with {}..{} worker(s)", elastic_.min_workers, elastic_.max_workers);
+    } else {
+        slots_.resize(fixed_workers_);
+        spdlog::info("Engine starting with {} worker(s)", fixed_workers_);
     }
+    if (worker_opts_.spin_us > 0 || !worker_opts_.cpus.empty())
+        spdlog::info("Low-latency workers: spin={}us, pinned CPUs={}", worker_opts_.spin_us, worker_opts_.cpus.size());
+    if (tracer_.enabled()) spdlog::info("Tracing sampled events; dump them from /trace");
+    for (size_t i = 0; i < initial; ++i) spawn_worker_locked();
+    if (elastic_.enabled) controller_ = std::thread([this]{ controller_loop(); });
 }
 
 void Engine::stop() {
     if (!running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(pool_mu_); // pairs with the controller's predicate check
+    }
+    controller_cv_.notify_all();
+    if (controller_.joinable()) controller_.join();
+    // Wakes parked workers; pop() keeps handing out queued events until the
+    // queue is empty, so the workers drain it before they exit.
     queue_.stop();
-    for (auto& t : workers_) {
-        if (t.joinable()) t.join();
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    for (auto& w : slots_) {
+        if (w && w->th.joinable()) w->th.join();
+    }
+    slots_.clear();
+    workers_gauge_.set(0);
+    spdlog::info("Engine stopped. processed={}, dropped={}", processed_.value(), dropped_.value());
+}
+
+size_t Engine::worker_count() const {
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    size_t n = 0;
+    for (auto& w : slots_) n += w && !w->retire.load(std::memory_order_relaxed);
+    return n;
+}
+
+// Called with pool_mu_ held. Takes the lowest free slot so worker labels stay compact.
+bool Engine::spawn_worker_locked() {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i]) continue;
+        auto w = std::make_unique<Worker>();
+        Worker* self = w.get();
+        w->th = std::thread([this, i, self]{ worker_loop(i, *self); });
+        slots_[i] = std::move(w);
+        workers_gauge_.add();
+        return true;
     }
-    workers_.clear();
-    spdlog::info("Engine stopped. processed={}, dropped={}", processed_.load(), dropped_.load());
+    return false;
+}
+
+void Engine::controller_loop() {
+    using Clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::milliseconds(std::max<uint32_t>(1, elastic_.interval_ms));
+    const auto shrink_after = std::chrono::milliseconds(elastic_.shrink_idle_ms);
+    const int64_t grow_wait_ns = static_cast<int64_t>(elastic_.grow_wait_us) * 1000;
+    bool idle = false;
+    Clock::time_point idle_since;
+
+    std::unique_lock<std::mutex> lock(pool_mu_);
+    while (true) {
+        controller_cv_.wait_for(lock, interval, [this]{ return !running_.load(); });
+        if (!running_.load()) break;
+
+        // Reap workers that finished retiring.
+        size_t live = 0;
+        for (auto& w : slots_) {
+            if (!w) continue;
+            if (w->exited.load(std::memory_order_acquire)) {
+                w->th.join();
+                w.reset();
+            } else if (!w->retire.load(std::memory_order_relaxed)) {
+                ++live;
+            }
+        }
+
+        const size_t depth = queue_.size();
+        const int64_t wait_ns = queue_.oldest_wait_ns();
+        if ((depth >= elastic_.grow_queue_depth || (grow_wait_ns > 0 && wait_ns >= grow_wait_ns)) &&
+            live < elastic_.max_workers && spawn_worker_locked()) {
+            spdlog::info("Elastic pool grew to {} worker(s) (queue={}, oldest wait={}us)", live + 1, depth, wait_ns / 1000);
+            idle = false;
+            continue;
+        }
+
+        // Idle = at least one worker parked on an empty queue at every sample.
+        if (depth == 0 && queue_.waiters() > 0) {
+            const auto now = Clock::now();
+            if (!idle) {
+                idle = true;
+                idle_since = now;
+            } else if (now - idle_since >= shrink_after && live > elastic_.min_workers) {
+                for (size_t i = slots_.size(); i-- > 0;) {
+                    auto& w = slots_[i];
+                    if (!w || w->retire.load(std::memory_order_relaxed)) continue;
+                    w->retire.store(true, std::memory_order_relaxed);
+                    workers_gauge_.sub();
+                    spdlog::info("Elastic pool shrank to {} worker(s)", live - 1);
+                    break;
+                }
+                idle_since = now;
+            }
+        } else {
+            idle = false;
+        }
+    }
+}
+
+void Engine::set_lanes(const std::vector<LaneSpec>& lanes, const std::string& default_lane) {
+    if (lanes.empty()) throw std::invalid_argument("at least one lane is required");
+    queue_.set_lanes(lanes);
+    source_lanes_.clear();
+    default_lane_ = lane_index(default_lane);
+    size_t capacity = 0;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        capacity += lanes[i].capacity;
+        metrics_.gauge_fn("crossbring_lane_depth", "Events waiting per queue lane", {{"lane", lanes[i].name}},
+                          [this, i]{ return static_cast<double>(queue_.lane_size(i)); });
+        metrics_.gauge("crossbring_lane_capacity", "Capacity per queue lane", {{"lane", lanes[i].name}})
+            .set(static_cast<int64_t>(lanes[i].capacity));
+    }
+    metrics_.gauge("crossbring_queue_capacity", "Engine queue capacity").set(static_cast<int64_t>(capacity));
+}
+
+void Engine::assign_lane(const std::string& source, const std::string& lane) {
+    source_lanes_[source] = lane_index(lane);
+}
+
+size_t Engine::lane_index(const std::string& name) const {
+    for (size_t i = 0; i < queue_.lane_count(); ++i) {
+        if (queue_.lane(i).name == name) return i;
+    }
+    throw std::invalid_argument("unknown lane '" + name + "'");
+}
+
+size_t Engine::lane_of(const std::string& source) const {
+    if (source_lanes_.empty()) return default_lane_;
+    auto it = source_lanes_.find(source);
+    return it == source_lanes_.end() ? default_lane_ : it->second;
+}
+
+// Budget check ahead of the queue. Over the limit, a blocking producer waits
+// for room (re-checking shutdown every 10ms); false tells the caller to shed.
+bool Engine::admit(bool may_wait) {
+    if (!memory_.over_limit()) return true;
+    budget_waits_.inc();
+    while (may_wait && running_.load(std::memory_order_relaxed)) {
+        if (memory_.wait_for_room(std::chrono::milliseconds(10))) return true;
+    }
+    return false;
 }
 
 bool Engine::submit(Event ev) {
     if (!running_.load(std::memory_order_relaxed)) return false;
-    bool ok = drop_on_full_ ? queue_.try_push(std::move(ev)) : queue_.push(std::move(ev));
-    if (!ok) {
-        dropped_.fetch_add(1, std::memory_order_relaxed);
+    if (tracer_.enabled()) ev.trace_id = tracer_.sample();
+    Tracer::Scope span(tracer_, ev.trace_id, submit_span_);
+    if (admit(backpressure_ == Backpressure::Block)) {
+        if (backpressure_ == Backpressure::Conflate) return submit_conflated(ev);
+        const size_t lane = lane_of(ev.source);
+        if (backpressure_ == Backpressure::Drop ? queue_.try_push(std::move(ev), lane)
+                                                : queue_.push(std::move(ev), lane)) return true;
+    }
+    // A failed push does not move from `ev`, so its source is still readable.
+    dropped_.inc();
+    source_dropped_.with(ev.source).inc();
+    return false;
+}
+
+bool Engine::try_submit(Event ev) {
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    if (tracer_.enabled()) ev.trace_id = tracer_.sample();
+    Tracer::Scope span(tracer_, ev.trace_id, submit_span_);
+    if (admit(false) && queue_.try_push(std::move(ev), lane_of(ev.source))) return true;
+    dropped_.inc();
+    source_dropped_.with(ev.source).inc();
+    return false;
+}
+
+size_t Engine::submit_batch(std::vector<Event>& evs) {
+    if (!running_.load(std::memory_order_relaxed)) {
+        evs.clear();
+        return 0;
+    }
+    Tracer::Scope span(tracer_, trace_batch(evs), submit_span_);
+    if (!admit(backpressure_ == Backpressure::Block)) {
+        count_dropped(evs, 0, evs.size());
+        evs.clear();
+        return 0;
+    }
+    if (backpressure_ == Backpressure::Conflate) {
+        // Each event needs its own key lookup, so there is no bulk path here.
+        size_t n = 0;
+        for (auto& ev : evs) n += submit_conflated(ev);
+        evs.clear();
+        return n;
+    }
+    // Push runs of events bound for the same lane; a batch usually has one source.
+    size_t n = 0;
+    for (size_t first = 0; first < evs.size();) {
+        const size_t lane = lane_of(evs[first].source);
+        size_t last = first + 1;
+        while (last < evs.size() && (evs[last].source == evs[first].source || lane_of(evs[last].source) == lane)) ++last;
+        const auto b = evs.begin() + static_cast<std::ptrdiff_t>(first);
+        const auto e = evs.begin() + static_cast<std::ptrdiff_t>(last);
+        const size_t pushed = backpressure_ == Backpressure::Drop ? queue_.try_push_bulk(b, e, lane)
+                                                                  : queue_.push_bulk(b, e, lane);
+        n += pushed;
+        // Unpushed events were not moved from, so their sources are intact.
+        if (first + pushed < last) count_dropped(evs, first + pushed, last);
+        first = last;
+    }
+    evs.clear();
+    return n;
+}
+
+size_t Engine::try_submit_batch(std::vector<Event>& evs) {
+    if (!running_.load(std::memory_order_relaxed)) {
+        evs.clear();
+        return 0;
+    }
+    Tracer::Scope span(tracer_, trace_batch(evs), submit_span_);
+    size_t n = 0;
+    if (!admit(false)) {
+        count_dropped(evs, 0, evs.size());
+    } else if (backpressure_ == Backpressure::Conflate) {
+        for (; n < evs.size(); ++n) {
+            if (!submit_conflated(evs[n])) { // counted that one already
+                count_dropped(evs, n + 1, evs.size());
+                break;
+            }
+        }
+    } else {
+        for (size_t first = 0; first < evs.size();) {
+            const size_t lane = lane_of(evs[first].source);
+            size_t last = first + 1;
+            while (last < evs.size() && (evs[last].source == evs[first].source || lane_of(evs[last].source) == lane)) ++last;
+            const size_t pushed = queue_.try_push_bulk(evs.begin() + static_cast<std::ptrdiff_t>(first),
+                                                       evs.begin() + static_cast<std::ptrdiff_t>(last), lane);
+            n += pushed;
+            if (first + pushed < last) {
+                count_dropped(evs, first + pushed, evs.size());
+                break;
+            }
+            first = last;
+        }
+    }
+    evs.clear();
+    return n;
+}
+
+// Samples each event of a batch; the batch's submit span carries the first
+// sampled event's trace id.
+uint64_t Engine::trace_batch(std::vector<Event>& evs) {
+    if (!tracer_.enabled()) return 0;
+    uint64_t trace = 0;
+    for (auto& ev : evs) {
+        ev.trace_id = tracer_.sample();
+        if (!trace) trace = ev.trace_id;
+    }
+    return trace;
+}
+
+bool Engine::submit_conflated(Event& ev) {
+    thread_local std::string key;
+    key.assign(ev.source).push_back('\x1f');
+    key.append(ev.key);
+    switch (queue_.push_or_replace(key, ev, lane_of(ev.source))) {
+    case BoundedQueue<Event>::PushResult::Queued:
+        return true;
+    case BoundedQueue<Event>::PushResult::Replaced:
+        // `ev` now holds the superseded event, which has the same source.
+        conflated_.inc();
+        source_conflated_.with(ev.source).inc();
+        return true;
+    default:
+        dropped_.inc();
+        source_dropped_.with(ev.source).inc();
         return false;
     }
-    return true;
 }
 
-void Engine::add_processor(Processor p) { processors_.push_back(std::move(p)); }
+void Engine::count_dropped(const std::vector<Event>& evs, size_t from, size_t to) {
+    dropped_.inc(to - from);
+    // Batches usually come from one source; only look the series up when it changes.
+    const std::string* last = nullptr;
+    Counter* c = nullptr;
+    for (size_t i = from; i < to; ++i) {
+        if (!last || evs[i].source != *last) {
+            last = &evs[i].source;
+            c = &source_dropped_.with(*last);
+        }
+        c->inc();
+    }
+}
+
+template <typename Fn>
+void Engine::update_pipeline(Fn&& fn) {
+    std::lock_guard<std::mutex> lock(pipeline_mu_);
+    auto next = std::make_shared<Pipeline>(*std::atomic_load(&pipeline_));
+    fn(*next);
+    std::atomic_store(&pipeline_, std::shared_ptr<const Pipeline>(std::move(next)));
+    pipeline_version_.fetch_add(1, std::memory_order_release);
+}
 
-void Engine::add_sink(std::shared_ptr<Sink> sink) { sinks_.push_back(std::move(sink)); }
+void Engine::add_processor(Processor p, const std::string& name) {
+    update_pipeline([&](Pipeline& pl){
+        pl.stage_spans.push_back(tracer_.intern(name.empty() ? "processor " + std::to_string(pl.stages.size()) : name));
+        pl.stages.push_back([p = std::move(p)](Event& ev){ p(ev); return true; });
+    });
+}
+
+void Engine::add_filter(Filter f, const std::string& name) {
+    update_pipeline([&](Pipeline& pl){
+        pl.stage_spans.push_back(tracer_.intern(name.empty() ? "filter " + std::to_string(pl.stages.size()) : name));
+        pl.stages.push_back(std::move(f));
+    });
+}
 
-void Engine::worker_loop() {
+void Engine::add_sink(std::shared_ptr<Sink> sink) {
+    sink->bind_metrics(metrics_);
+    sink->bind_memory(memory_);
+    Counter* events = &metrics_.counter("crossbring_sink_events_total", "Events consumed per sink", {{"sink", sink->name()}});
+    const bool retains = sink->retains_events();
+    const uint32_t span = tracer_.intern(sink->name());
+    update_pipeline([&](Pipeline& pl){
+        pl.sink_spans.push_back(span);
+        pl.sinks.push_back(std::move(sink));
+        pl.sink_events.push_back(events);
+        pl.retains.push_back(retains);
+        pl.retaining += retains;
+    });
+}
+
+// Busy-polls the queue for up to budget_ns, backing off from one to 64 pause
+// instructions between checks. The size hint keeps spinners off the queue lock.
+std::optional<Event> Engine::spin_pop(int64_t budget_ns, Counter& spin_ns, BoundedQueue<Event>::PopInfo& info) {
+    const auto start = std::chrono::steady_clock::now();
+    int64_t elapsed = 0;
+    unsigned pauses = 1;
     while (running_.load(std::memory_order_relaxed)) {
-        auto item = queue_.pop();
-        if (!item.has_value()) break;
+        if (queue_.size_hint() > 0) {
+            if (auto item = queue_.try_pop(&info)) {
+                spin_ns.inc(static_cast<uint64_t>(elapsed));
+                return item;
+            }
+        }
+        for (unsigned i = 0; i < pauses; ++i) cpu_relax();
+        if (pauses < 64) pauses <<= 1;
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budget_ns) break;
+    }
+    spin_ns.inc(static_cast<uint64_t>(elapsed));
+    return std::nullopt;
+}
+
+void Engine::worker_loop(size_t slot, Worker& self) {
+    const Labels labels{{"worker", std::to_string(slot)}};
+    Counter& worker_events = metrics_.counter("crossbring_worker_events_total", "Processed events per worker", labels);
+    Counter& parks = metrics_.counter("crossbring_worker_parks_total", "Times a worker blocked on an empty queue", labels);
+    Counter& spin_ns = metrics_.counter("crossbring_worker_spin_ns_total", "Time spent busy-polling the queue", labels);
+    Histogram& wake = metrics_.histogram("crossbring_worker_wake_latency_seconds",
+                                         "Delay from a producer's notify to the parked worker running", labels);
+    Histogram& queue_wait = metrics_.histogram("crossbring_queue_wait_seconds",
+                                               "Time events spent queued before a worker took them", labels);
+    // Per-lane split of queue_wait, only when lanes are configured.
+    std::vector<Histogram*> lane_wait;
+    if (queue_.lane_count() > 1) {
+        for (size_t i = 0; i < queue_.lane_count(); ++i) {
+            Labels ll = labels;
+            ll.emplace_back("lane", queue_.lane(i).name);
+            lane_wait.push_back(&metrics_.histogram("crossbring_lane_wait_seconds",
+                                                    "Time events spent queued per lane before a worker took them", ll));
+        }
+    }
+    if (!worker_opts_.cpus.empty()) {
+        int cpu = worker_opts_.cpus[slot % worker_opts_.cpus.size()];
+        if (!pin_current_thread(cpu)) spdlog::warn("Worker {}: cannot pin to CPU {}", slot, cpu);
+        if (worker_opts_.numa_local && !bind_memory_local())
+            spdlog::warn("Worker {}: NUMA-local allocation unavailable (build with ENABLE_NUMA)", slot);
+    }
+    const int64_t spin_budget = static_cast<int64_t>(worker_opts_.spin_us) * 1000;
+    // Elastic workers wake up periodically to notice a retire request.
+    const bool elastic = elastic_.enabled;
+    if (tracer_.enabled()) tracer_.set_thread_name("worker " + std::to_string(slot));
+
+    std::shared_ptr<const Pipeline> pipe;
+    uint64_t pipe_version = ~uint64_t{0};
+    BoundedQueue<Event>::PopInfo info;
+    // Worker-local view of source_events_ so the hot path never takes its lock.
+    std::unordered_map<std::string, Counter*> by_source;
+    while (!self.retire.load(std::memory_order_relaxed)) {
+        std::optional<Event> item;
+        if (spin_budget > 0) item = spin_pop(spin_budget, spin_ns, info);
+        if (!item) {
+            item = elastic ? queue_.pop_for(std::chrono::milliseconds(100), &info) : queue_.pop(&info);
+            if (!item.has_value()) {
+                if (queue_.stopped()) break; // and drained
+                continue;                     // an elastic timeout
+            }
+            if (info.wake_ns >= 0) {
+                parks.inc();
+                wake.observe(static_cast<double>(info.wake_ns) * 1e-9);
+            }
+        }
+        queue_wait.observe(static_cast<double>(info.wait_ns) * 1e-9);
+        if (!lane_wait.empty()) lane_wait[info.lane]->observe(static_cast<double>(info.wait_ns) * 1e-9);
+
+        // RCU-style read side: only touch the shared pointer when the version moved.
+        const uint64_t v = pipeline_version_.load(std::memory_order_acquire);
+        if (v != pipe_version) {
+            pipe = std::atomic_load(&pipeline_);
+            pipe_version = v;
+        }
         auto& ev = item.value();
-        for (auto& p : processors_) {
-            p(ev);
+        // Sampled events get a span per stage and sink, nested in one for the whole
+        // event, plus the queue wait that just ended.
+        const uint64_t trace = ev.trace_id;
+        Tracer::Scope process(tracer_, trace, process_span_);
+        if (trace) {
+            const int64_t now = Tracer::now_ns();
+            tracer_.record(trace, queue_span_, now - info.wait_ns, now, Tracer::SpanKind::Async);
         }
-        for (auto& s : sinks_) {
-            s->consume(ev);
+        // A processor or sink that throws (e.g. on a payload that fails to parse
+        // when materialized) drops this event, not the worker. The event may be
+        // moved out by then, so the warning names the source through `source`,
+        // which switches to the by_source key (stable across rehashes) before that.
+        const std::string* source = &ev.source;
+        try {
+            bool keep = true;
+            for (size_t i = 0; i < pipe->stages.size(); ++i) {
+                Tracer::Scope span(tracer_, trace, pipe->stage_spans[i]);
+                if (!pipe->stages[i](ev)) { keep = false; break; }
+            }
+            auto it = by_source.find(ev.source);
+            if (it == by_source.end()) it = by_source.emplace(ev.source, &source_events_.with(ev.source)).first;
+            it->second->inc();
+            source = &it->first;
+            if (keep && pipe->retaining == 0) {
+                for (size_t i = 0; i < pipe->sinks.size(); ++i) {
+                    {
+                        Tracer::Scope span(tracer_, trace, pipe->sink_spans[i]);
+                        pipe->sinks[i]->consume(ev);
+                    }
+                    pipe->sink_events[i]->inc();
+                }
+            } else if (keep) {
+                // Sinks that use the event in place go first; then it moves into one
+                // shared allocation for the sinks that keep it.
+                for (size_t i = 0; i < pipe->sinks.size(); ++i) {
+                    if (pipe->retains[i]) continue;
+                    {
+                        Tracer::Scope span(tracer_, trace, pipe->sink_spans[i]);
+                        pipe->sinks[i]->consume(ev);
+                    }
+                    pipe->sink_events[i]->inc();
+                }
+                // A raw payload is parsed lazily on first use, which is not safe from
+                // two threads at once; several holders get it parsed up front.
+                if (pipe->retaining > 1) ev.json();
+                EventPtr shared = std::make_shared<const Event>(std::move(ev));
+                for (size_t i = 0; i < pipe->sinks.size(); ++i) {
+                    if (!pipe->retains[i]) continue;
+                    {
+                        Tracer::Scope span(tracer_, trace, pipe->sink_spans[i]);
+                        pipe->sinks[i]->consume_shared(shared);
+                    }
+                    pipe->sink_events[i]->inc();
+                }
+            } else {
+                filtered_.inc();
+            }
+        } catch (const std::exception& e) {
+            failed_.inc();
+            const uint64_t n = failed_.value();
+            if ((n & (n - 1)) == 0) spdlog::warn("Event from {} dropped ({} so far): {}", *source, n, e.what());
         }
-        processed_.fetch_add(1, std::memory_order_relaxed);
+        worker_events.inc();
+        processed_.inc();
     }
+    self.exited.store(true, std::memory_order_release);
 }
 
 } // namespace crossbring
@@ -0,0 +1,76 @@
+#include "crossbring/core/memory.h"
+
+namespace crossbring {
+
+namespace {
+
+// libstdc++/MSVC strings keep up to 15 chars inline.
+constexpr size_t kInlineString = 15;
+// Red-black tree node header plus malloc overhead, per object member.
+constexpr size_t kMapNode = 48;
+
+size_t string_heap(const std::string& s) {
+    return s.capacity() > kInlineString ? s.capacity() + 1 : 0;
+}
+
+} // namespace
+
+size_t approx_bytes(const nlohmann::json& j) {
+    switch (j.type()) {
+    case nlohmann::json::value_t::object: {
+        const auto& obj = j.get_ref<const nlohmann::json::object_t&>();
+        size_t n = sizeof(nlohmann::json::object_t);
+        for (const auto& [k, v] : obj) n += kMapNode + sizeof(std::string) + string_heap(k) + approx_bytes(v);
+        return n;
+    }
+    case nlohmann::json::value_t::array: {
+        const auto& arr = j.get_ref<const nlohmann::json::array_t&>();
+        size_t n = sizeof(nlohmann::json::array_t) + (arr.capacity() - arr.size()) * sizeof(nlohmann::json);
+        for (const auto& v : arr) n += approx_bytes(v);
+        return n;
+    }
+    case nlohmann::json::value_t::string: {
+        const auto& s = j.get_ref<const std::string&>();
+        return sizeof(nlohmann::json) + sizeof(std::string) + string_heap(s);
+    }
+    default:
+        return sizeof(nlohmann::json);
+    }
+}
+
+size_t approx_bytes(const Event& ev) {
+    return sizeof(Event) + string_heap(ev.source) + string_heap(ev.key) + string_heap(ev.raw) +
+           (ev.payload.is_null() ? 0 : approx_bytes(ev.payload) - sizeof(nlohmann::json));
+}
+
+void MemoryBudget::configure(bool enabled, size_t limit_bytes) {
+    enabled_ = enabled;
+    limit_ = enabled ? limit_bytes : 0;
+    reg_.gauge("crossbring_memory_limit_bytes", "Process-wide memory budget (0 = unlimited)")
+        .set(static_cast<int64_t>(limit_));
+    if (enabled_) {
+        reg_.gauge_fn("crossbring_memory_used_bytes", "Bytes held across all accounted components", {},
+                      [this]{ return static_cast<double>(used()); });
+    }
+}
+
+MemoryBudget::Account* MemoryBudget::account(const std::string& component) {
+    if (!enabled_) return nullptr;
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& slot = accounts_[component];
+    if (!slot) {
+        slot.reset(new Account(*this));
+        Account* a = slot.get();
+        reg_.gauge_fn("crossbring_memory_bytes", "Estimated bytes held per component", {{"component", component}},
+                      [a]{ return static_cast<double>(a->bytes()); });
+    }
+    return slot.get();
+}
+
+bool MemoryBudget::wait_for_room(std::chrono::milliseconds timeout) {
+    if (!over_limit()) return true;
+    std::unique_lock<std::mutex> lock(wait_mu_);
+    return wait_cv_.wait_for(lock, timeout, [this]{ return !over_limit(); });
+}
+
+} // namespace crossbring
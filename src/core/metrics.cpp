@@ -0,0 +1,164 @@
+#include "crossbring/core/metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace crossbring {
+
+namespace {
+
+void append_escaped(std::string& out, const std::string& v) {
+    for (char c : v) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+}
+
+std::string render_labels(const Labels& labels) {
+    if (labels.empty()) return {};
+    std::string out = "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i) out += ',';
+        out += labels[i].first;
+        out += "=\"";
+        append_escaped(out, labels[i].second);
+        out += '"';
+    }
+    out += '}';
+    return out;
+}
+
+std::string format_double(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", v);
+    return buf;
+}
+
+// `labels` is empty or `{...}`; the `le` label is appended to it.
+void write_histogram(std::string& out, const std::string& name, const std::string& labels, const Histogram& h) {
+    const std::string prefix = labels.empty() ? "{" : labels.substr(0, labels.size() - 1) + ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= h.bounds().size(); ++i) {
+        cumulative += h.bucket(i);
+        out += name + "_bucket" + prefix + "le=\"";
+        out += i < h.bounds().size() ? format_double(h.bounds()[i]) : std::string("+Inf");
+        out += "\"} " + std::to_string(cumulative) + '\n';
+    }
+    out += name + "_sum" + labels + ' ' + format_double(h.sum()) + '\n';
+    out += name + "_count" + labels + ' ' + std::to_string(cumulative) + '\n';
+}
+
+} // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)), counts_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+    std::sort(bounds_.begin(), bounds_.end());
+    for (size_t i = 0; i <= bounds_.size(); ++i) counts_[i].store(0, std::memory_order_relaxed);
+}
+
+std::vector<double> Histogram::latency_bounds() {
+    return {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 1e-2, 0.1, 1.0};
+}
+
+Counter& CounterVec::with(const std::string& value) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        auto it = cache_.find(value);
+        if (it != cache_.end()) return *it->second;
+    }
+    Labels labels = base_;
+    labels.emplace_back(label_, value);
+    Counter& c = reg_.counter(name_, help_, labels);
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    cache_.emplace(value, &c);
+    return c;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name, const std::string& help, Type type,
+                                                 const Labels& labels) {
+    auto& fam = families_[name];
+    if (fam.series.empty()) {
+        fam.help = help;
+        fam.type = type;
+    } else if (fam.type != type) {
+        throw std::invalid_argument("metric " + name + " registered with a different type");
+    }
+    std::string rendered = render_labels(labels);
+    for (auto& s : fam.series) {
+        if (s.labels == rendered) return s;
+    }
+    fam.series.push_back(Series{std::move(rendered), nullptr, nullptr, nullptr, nullptr});
+    return fam.series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& s = series(name, help, Type::Counter, labels);
+    if (!s.counter) s.counter = std::make_unique<Counter>();
+    return *s.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& s = series(name, help, Type::Gauge, labels);
+    if (s.fn) throw std::invalid_argument("metric " + name + " is a computed gauge");
+    if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+    return *s.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const Labels& labels,
+                                     std::vector<double> bounds) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& s = series(name, help, Type::Histogram, labels);
+    if (!s.histogram) s.histogram = std::make_unique<Histogram>(std::move(bounds));
+    return *s.histogram;
+}
+
+void MetricsRegistry::gauge_fn(const std::string& name, const std::string& help, const Labels& labels,
+                               std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& s = series(name, help, Type::Gauge, labels);
+    if (s.gauge) throw std::invalid_argument("metric " + name + " is a stored gauge");
+    s.fn = std::move(fn);
+}
+
+CounterVec& MetricsRegistry::counter_vec(const std::string& name, const std::string& help, const std::string& label,
+                                         const Labels& base) {
+    std::lock_guard<std::mutex> lock(mu_);
+    vecs_.push_back(std::unique_ptr<CounterVec>(new CounterVec(*this, name, help, label, base)));
+    return *vecs_.back();
+}
+
+void MetricsRegistry::write(std::ostream& os) const {
+    std::string out;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        out.reserve(families_.size() * 160);
+        for (auto& kv : families_) {
+            const auto& fam = kv.second;
+            out += "# HELP " + kv.first + ' ' + fam.help + '\n';
+            out += "# TYPE " + kv.first;
+            out += fam.type == Type::Counter ? " counter\n" : fam.type == Type::Gauge ? " gauge\n" : " histogram\n";
+            for (auto& s : fam.series) {
+                if (s.histogram) {
+                    write_histogram(out, kv.first, s.labels, *s.histogram);
+                    continue;
+                }
+                out += kv.first;
+                out += s.labels;
+                out += ' ';
+                if (s.counter) out += std::to_string(s.counter->value());
+                else if (s.gauge) out += std::to_string(s.gauge->value());
+                else if (s.fn) out += format_double(s.fn());
+                else out += '0';
+                out += '\n';
+            }
+        }
+    }
+    os << out;
+}
+
+} // namespace crossbring
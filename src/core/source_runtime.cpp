@@ -0,0 +1,423 @@
+#include "crossbring/core/source_runtime.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "crossbring/core/affinity.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace crossbring {
+
+namespace {
+
+constexpr int kBits = 8;
+constexpr int kLevels = 4;
+constexpr int64_t kSlots = int64_t{1} << kBits;
+constexpr int64_t kMask = kSlots - 1;
+
+thread_local const void* t_running = nullptr; // timer or watch whose callback this thread is in
+thread_local const void* t_loop = nullptr;    // loop driven by this thread
+
+} // namespace
+
+struct SourceRuntime::Timer {
+    TimerId id = 0;
+    std::function<void()> fn;
+    int64_t period_ns = 0;  // 0 = one-shot
+    int64_t deadline_ns = 0; // since epoch_; loop thread only after add()
+    int64_t tick = 0;        // deadline rounded up to a tick
+    bool blocking = false;
+    Loop* loop = nullptr;
+    std::mutex run_mu;       // held while fn runs
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> busy{false}; // blocking run queued or in progress
+};
+
+struct SourceRuntime::Watch {
+    std::function<void(uint32_t)> fn;
+    std::mutex run_mu;
+    std::atomic<bool> removed{false};
+};
+
+struct SourceRuntime::Loop {
+    std::mutex mu; // guards the wheel, cur and count
+    std::vector<std::shared_ptr<Timer>> wheel[kLevels][kSlots];
+    int64_t cur = 0;   // last tick processed
+    size_t count = 0;  // entries in the wheel, including cancelled ones not yet dropped
+    std::thread th;
+#if defined(__linux__)
+    int epfd = -1;
+    int wake_fd = -1;
+#else
+    std::condition_variable cv;
+    bool woken = false;
+#endif
+    std::mutex watch_mu;
+    std::unordered_map<int, std::shared_ptr<Watch>> watches;
+};
+
+SourceRuntime::SourceRuntime(MetricsRegistry& reg, Options opts)
+    : opts_(std::move(opts)),
+      tick_ns_(int64_t{std::max(1, opts_.tick_ms)} * 1000000),
+      timers_gauge_(reg.gauge("crossbring_source_runtime_timers", "Timers scheduled on the source runtime")),
+      fires_(reg.counter("crossbring_source_runtime_fires_total", "Source timer callbacks run")),
+      missed_(reg.counter("crossbring_source_runtime_missed_ticks_total",
+                          "Fixed-rate ticks skipped because the loop or a blocking run was late")),
+      lateness_(reg.histogram("crossbring_source_runtime_lateness_seconds",
+                              "Delay between a timer's deadline and its dispatch")) {
+    if (opts_.threads == 0) opts_.threads = 1;
+    for (size_t i = 0; i < opts_.threads; ++i) {
+        auto l = std::make_unique<Loop>();
+#if defined(__linux__)
+        l->epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        l->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (l->epfd < 0 || l->wake_fd < 0) throw std::runtime_error("source runtime: cannot create epoll set");
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = l->wake_fd;
+        ::epoll_ctl(l->epfd, EPOLL_CTL_ADD, l->wake_fd, &ev);
+#endif
+        loops_.push_back(std::move(l));
+    }
+}
+
+SourceRuntime::~SourceRuntime() {
+    stop();
+#if defined(__linux__)
+    for (auto& l : loops_) {
+        ::close(l->wake_fd);
+        ::close(l->epfd);
+    }
+#endif
+}
+
+void SourceRuntime::start() {
+    if (running_.exchange(true)) return;
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        Loop& l = *loops_[i];
+        l.th = std::thread([this, &l, i]{ run_loop(l, i); });
+    }
+    for (size_t i = 0; i < opts_.blocking_threads; ++i) pool_.emplace_back([this]{ blocking_loop(); });
+    spdlog::info("Source runtime: {} loop thread(s), {} blocking thread(s), {} ms tick", loops_.size(),
+                 opts_.blocking_threads, tick_ns_ / 1000000);
+}
+
+void SourceRuntime::stop() {
+    if (!running_.exchange(false)) return;
+    for (auto& l : loops_) {
+        wake(*l);
+        if (l->th.joinable()) l->th.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool_mu_);
+        pool_queue_.clear();
+    }
+    pool_cv_.notify_all();
+    for (auto& t : pool_) t.join();
+    pool_.clear();
+}
+
+int64_t SourceRuntime::now_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+SourceRuntime::TimerId SourceRuntime::every(std::chrono::nanoseconds period, std::function<void()> fn, bool blocking,
+                                            std::chrono::steady_clock::time_point first) {
+    if (period.count() <= 0) throw std::invalid_argument("source runtime: period must be positive");
+    auto t = std::make_shared<Timer>();
+    t->fn = std::move(fn);
+    t->period_ns = period.count();
+    t->deadline_ns = first == std::chrono::steady_clock::time_point{}
+        ? now_ns() + t->period_ns
+        : std::chrono::duration_cast<std::chrono::nanoseconds>(first - epoch_).count();
+    t->blocking = blocking;
+    return add(std::move(t));
+}
+
+SourceRuntime::TimerId SourceRuntime::after(std::chrono::nanoseconds delay, std::function<void()> fn, bool blocking) {
+    auto t = std::make_shared<Timer>();
+    t->fn = std::move(fn);
+    t->deadline_ns = now_ns() + std::max<int64_t>(0, delay.count());
+    t->blocking = blocking;
+    return add(std::move(t));
+}
+
+SourceRuntime::TimerId SourceRuntime::add(std::shared_ptr<Timer> t) {
+    t->id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    t->tick = (t->deadline_ns + tick_ns_ - 1) / tick_ns_;
+    t->loop = loops_[next_loop_.fetch_add(1, std::memory_order_relaxed) % loops_.size()].get();
+    const TimerId id = t->id;
+    Loop& l = *t->loop;
+    {
+        std::lock_guard<std::mutex> lock(timers_mu_);
+        timers_.emplace(id, t);
+        timers_gauge_.set(static_cast<int64_t>(timers_.size()));
+    }
+    {
+        std::lock_guard<std::mutex> lock(l.mu);
+        place(l, std::move(t), l.cur + 1);
+    }
+    if (t_loop != &l) wake(l);
+    return id;
+}
+
+void SourceRuntime::cancel(TimerId id) {
+    std::shared_ptr<Timer> t;
+    {
+        std::lock_guard<std::mutex> lock(timers_mu_);
+        auto it = timers_.find(id);
+        if (it == timers_.end()) return;
+        t = std::move(it->second);
+        timers_.erase(it);
+        timers_gauge_.set(static_cast<int64_t>(timers_.size()));
+    }
+    t->cancelled = true; // the wheel drops it when its slot comes up
+    if (t_running != t.get()) {
+        std::lock_guard<std::mutex> wait(t->run_mu); // let an in-flight run finish
+    }
+}
+
+// Puts a timer into the slot that comes due at its tick, relative to l.cur.
+// `base` is the earliest tick it may fire at. Caller holds l.mu.
+void SourceRuntime::place(Loop& l, std::shared_ptr<Timer> t, int64_t base) {
+    const int64_t d = std::max(t->tick, base);
+    const uint64_t delta = static_cast<uint64_t>(d - l.cur);
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t{1} << (kBits * (level + 1)))) ++level;
+    l.wheel[level][(d >> (kBits * level)) & kMask].push_back(std::move(t));
+    ++l.count;
+}
+
+void SourceRuntime::advance(Loop& l, int64_t now_tick, std::vector<std::shared_ptr<Timer>>& due) {
+    std::lock_guard<std::mutex> lock(l.mu);
+    if (l.count == 0) {
+        l.cur = std::max(l.cur, now_tick);
+        return;
+    }
+    while (l.cur < now_tick) {
+        const int64_t t = ++l.cur;
+        // Pull the next stretch of each higher level down once the one below wraps.
+        for (int level = 1; level < kLevels && (t & ((int64_t{1} << (kBits * level)) - 1)) == 0; ++level) {
+            auto& slot = l.wheel[level][(t >> (kBits * level)) & kMask];
+            if (slot.empty()) continue;
+            std::vector<std::shared_ptr<Timer>> items;
+            items.swap(slot);
+            l.count -= items.size();
+            for (auto& x : items)
+                if (!x->cancelled) place(l, std::move(x), t);
+        }
+        auto& slot = l.wheel[0][t & kMask];
+        if (slot.empty()) continue;
+        l.count -= slot.size();
+        for (auto& x : slot) {
+            if (x->cancelled) continue;
+            if (x->tick <= t) due.push_back(std::move(x));
+            else place(l, std::move(x), t + 1); // parked on the top level beyond its range
+        }
+        slot.clear(); // place() never targets this slot, so the capacity is kept
+    }
+}
+
+// First tick the loop must wake for: a non-empty level-0 slot or the next
+// cascade. Caller holds l.mu; -1 when the wheel is empty.
+int64_t SourceRuntime::next_tick(Loop& l) const {
+    if (l.count == 0) return -1;
+    for (int64_t t = l.cur + 1;; ++t)
+        if ((t & kMask) == 0 || !l.wheel[0][t & kMask].empty()) return t;
+}
+
+void SourceRuntime::fire(Loop& l, const std::shared_ptr<Timer>& t) {
+    lateness_.observe(static_cast<double>(std::max<int64_t>(0, now_ns() - t->deadline_ns)) / 1e9);
+    if (!t->blocking) {
+        run(t);
+    } else if (t->busy.exchange(true)) {
+        missed_.inc(); // still running from last time
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(pool_mu_);
+            pool_queue_.push_back(t);
+        }
+        pool_cv_.notify_one();
+    }
+    if (t->period_ns == 0 || t->cancelled) return;
+
+    // Fixed rate: the next deadline follows from the last one, not from now.
+    int64_t next = t->deadline_ns + t->period_ns;
+    const int64_t now = now_ns();
+    if (next <= now) {
+        const int64_t skipped = (now - next) / t->period_ns + 1;
+        next += skipped * t->period_ns;
+        missed_.inc(static_cast<uint64_t>(skipped));
+    }
+    t->deadline_ns = next;
+    t->tick = (next + tick_ns_ - 1) / tick_ns_;
+    std::lock_guard<std::mutex> lock(l.mu);
+    place(l, t, l.cur + 1);
+}
+
+void SourceRuntime::run(const std::shared_ptr<Timer>& t) {
+    {
+        std::lock_guard<std::mutex> lock(t->run_mu);
+        if (t->cancelled) return;
+        t_running = t.get();
+        try {
+            t->fn();
+        } catch (const std::exception& e) {
+            spdlog::error("Source runtime: timer {} threw: {}", t->id, e.what());
+        }
+        t_running = nullptr;
+    }
+    fires_.inc();
+    if (t->period_ns == 0) {
+        std::lock_guard<std::mutex> lock(timers_mu_);
+        timers_.erase(t->id);
+        timers_gauge_.set(static_cast<int64_t>(timers_.size()));
+    }
+}
+
+void SourceRuntime::blocking_loop() {
+    for (;;) {
+        std::shared_ptr<Timer> t;
+        {
+            std::unique_lock<std::mutex> lock(pool_mu_);
+            pool_cv_.wait(lock, [this]{ return !running_ || !pool_queue_.empty(); });
+            if (!running_) return;
+            t = std::move(pool_queue_.front());
+            pool_queue_.pop_front();
+        }
+        run(t);
+        t->busy = false;
+    }
+}
+
+void SourceRuntime::wake(Loop& l) {
+#if defined(__linux__)
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(l.wake_fd, &one, sizeof(one));
+#else
+    {
+        std::lock_guard<std::mutex> lock(l.mu);
+        l.woken = true;
+    }
+    l.cv.notify_one();
+#endif
+}
+
+void SourceRuntime::run_loop(Loop& l, size_t index) {
+    if (!opts_.cpus.empty()) {
+        const int cpu = opts_.cpus[index % opts_.cpus.size()];
+        if (!pin_current_thread(cpu)) spdlog::warn("Source runtime: cannot pin loop {} to CPU {}", index, cpu);
+    }
+    t_loop = &l;
+    std::vector<std::shared_ptr<Timer>> due;
+#if defined(__linux__)
+    epoll_event events[64];
+#endif
+    while (running_) {
+        due.clear();
+        advance(l, now_ns() / tick_ns_, due);
+        for (auto& t : due) fire(l, t);
+
+        int64_t next;
+        {
+            std::lock_guard<std::mutex> lock(l.mu);
+            next = next_tick(l);
+        }
+#if defined(__linux__)
+        int timeout = -1;
+        if (next >= 0) {
+            const int64_t wait_ns = next * tick_ns_ - now_ns();
+            timeout = wait_ns <= 0 ? 0 : static_cast<int>((wait_ns + 999999) / 1000000);
+        }
+        const int n = ::epoll_wait(l.epfd, events, 64, timeout);
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == l.wake_fd) {
+                uint64_t v;
+                [[maybe_unused]] ssize_t r = ::read(l.wake_fd, &v, sizeof(v));
+                continue;
+            }
+            std::shared_ptr<Watch> w;
+            {
+                std::lock_guard<std::mutex> lock(l.watch_mu);
+                auto it = l.watches.find(fd);
+                if (it != l.watches.end()) w = it->second;
+            }
+            if (!w) continue;
+            std::lock_guard<std::mutex> lock(w->run_mu);
+            if (w->removed) continue;
+            t_running = w.get();
+            try {
+                w->fn(events[i].events);
+            } catch (const std::exception& e) {
+                spdlog::error("Source runtime: fd {} handler threw: {}", fd, e.what());
+            }
+            t_running = nullptr;
+        }
+#else
+        std::unique_lock<std::mutex> lock(l.mu);
+        auto woken = [&]{ return l.woken || !running_; };
+        if (next < 0) l.cv.wait(lock, woken);
+        else l.cv.wait_until(lock, epoch_ + std::chrono::nanoseconds(next * tick_ns_), woken);
+        l.woken = false;
+#endif
+    }
+    t_loop = nullptr;
+}
+
+void SourceRuntime::watch_fd(int fd, uint32_t events, std::function<void(uint32_t)> fn) {
+#if defined(__linux__)
+    Loop& l = *loops_[next_loop_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+    auto w = std::make_shared<Watch>();
+    w->fn = std::move(fn);
+    {
+        std::lock_guard<std::mutex> lock(l.watch_mu);
+        l.watches[fd] = w;
+    }
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (::epoll_ctl(l.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        std::lock_guard<std::mutex> lock(l.watch_mu);
+        l.watches.erase(fd);
+        throw std::runtime_error("source runtime: cannot watch fd " + std::to_string(fd));
+    }
+#else
+    (void)fd;
+    (void)events;
+    (void)fn;
+    throw std::runtime_error("source runtime: fd watches need epoll (Linux)");
+#endif
+}
+
+void SourceRuntime::unwatch_fd(int fd) {
+#if defined(__linux__)
+    for (auto& l : loops_) {
+        std::shared_ptr<Watch> w;
+        {
+            std::lock_guard<std::mutex> lock(l->watch_mu);
+            auto it = l->watches.find(fd);
+            if (it == l->watches.end()) continue;
+            w = std::move(it->second);
+            l->watches.erase(it);
+        }
+        ::epoll_ctl(l->epfd, EPOLL_CTL_DEL, fd, nullptr);
+        w->removed = true;
+        if (t_running != w.get()) {
+            std::lock_guard<std::mutex> wait(w->run_mu); // let an in-flight run finish
+        }
+        return;
+    }
+#else
+    (void)fd;
+#endif
+}
+
+} // namespace crossbring
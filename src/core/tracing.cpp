@@ -0,0 +1,190 @@
+#include "crossbring/core/tracing.h"
+
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+namespace crossbring {
+
+namespace {
+
+std::atomic<uint64_t> next_tracer_id{1};
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void append_us(std::string& out, int64_t ns) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(ns) / 1000.0);
+    out += buf;
+}
+
+} // namespace
+
+struct Tracer::Buffer {
+    struct Slot {
+        std::atomic<uint64_t> seq{0}; // 2i+1 while span i is written, 2i+2 once complete
+        std::atomic<uint64_t> trace{0};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> end{0};
+        std::atomic<uint64_t> meta{0}; // name id << 8 | kind
+    };
+
+    Buffer(size_t n, uint32_t tid) : slots(new Slot[n]), mask(n - 1), tid(tid) {}
+
+    std::unique_ptr<Slot[]> slots;
+    const size_t mask;
+    const uint32_t tid;
+    std::atomic<uint64_t> head{0};     // spans written so far; only the owning thread writes
+    std::atomic<bool> in_use{true};    // false once the owning thread exited
+    std::string name;                  // guarded by Tracer::mu_
+};
+
+Tracer::Tracer(MetricsRegistry& reg)
+    : id_(next_tracer_id.fetch_add(1)),
+      sampled_(reg.counter("crossbring_trace_sampled_total", "Events sampled for tracing")),
+      spans_(reg.counter("crossbring_trace_spans_total", "Trace spans recorded")) {}
+
+void Tracer::configure(const Options& opts) {
+    enabled_ = opts.enabled && opts.sample_rate > 0;
+    if (opts.sample_rate >= 1.0) threshold_ = UINT64_MAX;
+    else threshold_ = static_cast<uint64_t>(opts.sample_rate * 18446744073709551616.0);
+    buffer_spans_ = 64;
+    while (buffer_spans_ < opts.buffer_spans) buffer_spans_ <<= 1;
+}
+
+bool Tracer::coin() {
+    if (threshold_ == UINT64_MAX) return true;
+    thread_local uint64_t state = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                                  static_cast<uint64_t>(now_ns());
+    return splitmix64(state) < threshold_;
+}
+
+uint32_t Tracer::intern(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end()) return it->second;
+    const auto id = static_cast<uint32_t>(names_.size());
+    names_.push_back(nlohmann::json(name).dump());
+    name_ids_.emplace(name, id);
+    return id;
+}
+
+// The calling thread's ring, created on first use. Rings of exited threads are
+// handed to new threads, so churning elastic workers do not grow the set.
+Tracer::Buffer& Tracer::local_buffer() {
+    struct Local {
+        uint64_t tracer = 0;
+        std::shared_ptr<Buffer> buf;
+        ~Local() {
+            if (buf) buf->in_use.store(false);
+        }
+    };
+    thread_local Local local;
+    if (local.tracer == id_) return *local.buf;
+    if (local.buf) local.buf->in_use.store(false);
+
+    std::lock_guard<std::mutex> lock(mu_);
+    std::shared_ptr<Buffer> b;
+    for (auto& x : buffers_) {
+        bool idle = false;
+        if (x->in_use.compare_exchange_strong(idle, true)) {
+            b = x;
+            break;
+        }
+    }
+    if (!b) {
+        b = std::make_shared<Buffer>(buffer_spans_, static_cast<uint32_t>(buffers_.size() + 1));
+        b->name = "thread " + std::to_string(b->tid);
+        buffers_.push_back(b);
+    }
+    local.tracer = id_;
+    local.buf = std::move(b);
+    return *local.buf;
+}
+
+void Tracer::record(uint64_t trace, uint32_t name, int64_t start_ns, int64_t end_ns, SpanKind kind) {
+    Buffer& b = local_buffer();
+    const uint64_t i = b.head.load(std::memory_order_relaxed);
+    auto& s = b.slots[i & b.mask];
+    s.seq.store(2 * i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.trace.store(trace, std::memory_order_relaxed);
+    s.start.store(start_ns, std::memory_order_relaxed);
+    s.end.store(end_ns, std::memory_order_relaxed);
+    s.meta.store(uint64_t{name} << 8 | static_cast<uint8_t>(kind), std::memory_order_relaxed);
+    s.seq.store(2 * i + 2, std::memory_order_release);
+    b.head.store(i + 1, std::memory_order_release);
+    spans_.inc();
+}
+
+void Tracer::set_thread_name(const std::string& name) {
+    Buffer& b = local_buffer();
+    std::lock_guard<std::mutex> lock(mu_);
+    b.name = name;
+}
+
+std::string Tracer::chrome_json(int64_t since_ns) const {
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::vector<std::string> thread_names;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        buffers = buffers_;
+        for (auto& b : buffers_) thread_names.push_back(nlohmann::json(b->name).dump());
+        names = names_;
+    }
+
+    std::string out = R"({"displayTimeUnit":"ns","traceEvents":[)";
+    out += R"({"ph":"M","name":"process_name","pid":1,"args":{"name":"crossbring"}})";
+    for (size_t k = 0; k < buffers.size(); ++k) {
+        const Buffer& b = *buffers[k];
+        const std::string tid = std::to_string(b.tid);
+        out += R"(,{"ph":"M","name":"thread_name","pid":1,"tid":)" + tid + R"(,"args":{"name":)" + thread_names[k] + "}}";
+
+        const uint64_t head = b.head.load(std::memory_order_acquire);
+        const uint64_t cap = b.mask + 1;
+        for (uint64_t i = head > cap ? head - cap : 0; i < head; ++i) {
+            auto& s = b.slots[i & b.mask];
+            const uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue; // overwritten since we read head
+            const uint64_t trace = s.trace.load(std::memory_order_relaxed);
+            const int64_t start = s.start.load(std::memory_order_relaxed);
+            const int64_t end = s.end.load(std::memory_order_relaxed);
+            const uint64_t meta = s.meta.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq) continue;
+            if (end < since_ns) continue;
+            const size_t name = static_cast<size_t>(meta >> 8);
+            if (name >= names.size()) continue;
+
+            const std::string common = R"(,"name":)" + names[name] + R"(,"pid":1,"tid":)" + tid + R"(,"ts":)";
+            const std::string args = R"(,"args":{"trace_id":)" + std::to_string(trace) + "}}";
+            if (static_cast<SpanKind>(meta & 0xff) == SpanKind::Async) {
+                const std::string id = R"(,"cat":"queue","id":")" + std::to_string(trace) + '"';
+                out += R"(,{"ph":"b")" + id + common;
+                append_us(out, start);
+                out += args;
+                out += R"(,{"ph":"e")" + id + common;
+                append_us(out, end);
+                out += args;
+            } else {
+                out += R"(,{"ph":"X","cat":"pipeline")" + common;
+                append_us(out, start);
+                out += R"(,"dur":)";
+                append_us(out, end - start);
+                out += args;
+            }
+        }
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace crossbring
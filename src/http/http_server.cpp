@@ -2,27 +2,50 @@
 
 #include "crossbring/http/http_server.h"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <sstream>
 
 #include <httplib.h>
 #include <nlohmann/json.hpp>
 
+#include "crossbring/core/clock.h"
 #include "crossbring/sinks/recent_buffer_sink.h"
 #include "crossbring/http/event_hub.h"
+#include "crossbring/http/ingest.h"
+#include "crossbring/processors/sketch_stage.h"
+#include "crossbring/storage/event_index.h"
+#include "crossbring/storage/state_store.h"
+#include "crossbring/storage/time_series_store.h"
+#ifdef USE_SQLITE
+#include "crossbring/storage/sqlite_store.h"
+#endif
 
 namespace crossbring {
 
 static std::string metrics_text(Engine& engine) {
     std::ostringstream os;
-    os << "# HELP crossbring_processed_total Total processed events\n";
-    os << "# TYPE crossbring_processed_total counter\n";
-    os << "crossbring_processed_total " << engine.processed_count() << "\n";
-    os << "# HELP crossbring_dropped_total Total dropped events\n";
-    os << "# TYPE crossbring_dropped_total counter\n";
-    os << "crossbring_dropped_total " << engine.dropped_count() << "\n";
+    engine.metrics().write(os);
     return os.str();
 }
 
+// Reads from/to (Unix ns) or last_ms, plus limit. Every endpoint takes and
+// returns Unix ns. Returns false on malformed input.
+static bool parse_time_range(const httplib::Request& req, int64_t& from, int64_t& to, size_t& limit) {
+    from = 0;
+    to = std::numeric_limits<int64_t>::max();
+    try {
+        if (req.has_param("from")) from = std::stoll(req.get_param_value("from"));
+        if (req.has_param("to")) to = std::stoll(req.get_param_value("to"));
+        if (req.has_param("last_ms")) from = unix_now_ns() - std::stoll(req.get_param_value("last_ms")) * 1000000;
+        if (req.has_param("limit")) limit = std::stoul(req.get_param_value("limit"));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
 HttpServer::HttpServer(Engine& engine, std::shared_ptr<RecentBuffer> recent, const std::string& host, int port, std::shared_ptr<EventHub> hub)
     : engine_(engine), recent_(std::move(recent)), hub_(std::move(hub)), host_(host), port_(port) {}
 
@@ -40,6 +63,11 @@ void HttpServer::stop() {
 
 void HttpServer::run() {
     httplib::Server svr;
+    const size_t threads = std::max<size_t>(1, server_opts_.threads);
+    svr.new_task_queue = [threads]{ return new httplib::ThreadPool(threads); };
+    svr.set_keep_alive_max_count(server_opts_.keep_alive_max);
+    svr.set_keep_alive_timeout(server_opts_.keep_alive_timeout_s);
+    svr.set_payload_max_length(server_opts_.max_body_bytes);
 
     svr.Get("/metrics", [this](const httplib::Request&, httplib::Response& res){
         auto txt = metrics_text(engine_);
@@ -55,6 +83,218 @@ void HttpServer::run() {
         res.set_content(arr.dump(), "application/json");
     });
 
+    // Numeric history: /series lists series; /series?key=&from=&to= (Unix ns)
+    // or &last_ms= returns [[ts_ns, value], ...] decoded from the compressed chunks.
+    if (tsdb_) {
+        svr.Get("/series", [this](const httplib::Request& req, httplib::Response& res){
+            if (!req.has_param("key")) {
+                nlohmann::json names = tsdb_->series_names();
+                res.set_content(names.dump(), "application/json");
+                return;
+            }
+            int64_t from, to;
+            size_t limit = 10000;
+            if (!parse_time_range(req, from, to, limit)) {
+                res.status = 400;
+                res.set_content("bad query parameter", "text/plain");
+                return;
+            }
+            nlohmann::json points = nlohmann::json::array();
+            tsdb_->scan(req.get_param_value("key"), from, to, [&](int64_t ts, double v){
+                points.push_back({ts, v});
+                return points.size() < limit;
+            });
+            nlohmann::json out = {{"key", req.get_param_value("key")}, {"points", std::move(points)}};
+            res.set_content(out.dump(), "application/json");
+        });
+    }
+
+    // Per-key history: /query?source=&key=&from=&to=&limit= streams a JSON array in
+    // chunks straight from the index; key may be omitted to merge all keys of a source.
+    if (index_) {
+        svr.Get("/query", [this](const httplib::Request& req, httplib::Response& res){
+            if (!req.has_param("source")) {
+                res.status = 400;
+                res.set_content("source is required", "text/plain");
+                return;
+            }
+            int64_t from, to;
+            size_t limit = 1000;
+            if (!parse_time_range(req, from, to, limit)) {
+                res.status = 400;
+                res.set_content("bad query parameter", "text/plain");
+                return;
+            }
+            auto index = index_;
+            auto source = req.get_param_value("source");
+            auto key = req.has_param("key") ? req.get_param_value("key") : std::string{};
+            res.set_chunked_content_provider("application/json",
+                [index, source, key, from, to, limit](size_t, httplib::DataSink& sink) {
+                    bool first = true;
+                    bool ok = sink.write("[", 1);
+                    std::string chunk;
+                    if (ok) {
+                        index->query(source, key, from, to, limit, [&](const std::vector<EventIndex::DocRef>& docs) {
+                            chunk.clear();
+                            for (auto& d : docs) {
+                                if (!first) chunk += ',';
+                                first = false;
+                                chunk += *d;
+                            }
+                            ok = sink.write(chunk.data(), chunk.size());
+                            return ok;
+                        });
+                    }
+                    if (ok) ok = sink.write("]", 1);
+                    if (ok) sink.done();
+                    return ok;
+                });
+        });
+    }
+
+#ifdef USE_SQLITE
+    // Stored history: /history?source=&key=&from=&to=&last_ms=&limit= with from/to
+    // in Unix ns. Only partitions overlapping the range are opened; rows stream as
+    // a JSON array of {"ts_ns","source","key","payload"} in time order.
+    if (history_) {
+        svr.Get("/history", [this](const httplib::Request& req, httplib::Response& res){
+            SqliteStore::Query q;
+            if (!parse_time_range(req, q.from_ns, q.to_ns, q.limit)) {
+                res.status = 400;
+                res.set_content("bad query parameter", "text/plain");
+                return;
+            }
+            q.source = req.get_param_value("source");
+            q.key = req.get_param_value("key");
+            auto history = history_;
+            res.set_chunked_content_provider("application/json",
+                [history, q](size_t, httplib::DataSink& sink) {
+                    bool ok = sink.write("[", 1);
+                    std::string chunk;
+                    size_t rows = 0;
+                    auto flush = [&] {
+                        ok = sink.write(chunk.data(), chunk.size());
+                        chunk.clear();
+                        return ok;
+                    };
+                    if (ok) {
+                        history->query(q, [&](const SqliteStore::Row& r) {
+                            if (rows++) chunk += ',';
+                            chunk += "{\"ts_ns\":";
+                            chunk += std::to_string(r.ts_ns);
+                            chunk += ",\"source\":";
+                            chunk += nlohmann::json(std::string(r.source)).dump();
+                            chunk += ",\"key\":";
+                            chunk += nlohmann::json(std::string(r.key)).dump();
+                            chunk += ",\"payload\":";
+                            chunk.append(r.payload.empty() ? std::string_view("null") : r.payload);
+                            chunk += '}';
+                            return chunk.size() < (64 << 10) || flush();
+                        });
+                    }
+                    if (ok && !chunk.empty()) flush();
+                    if (ok) ok = sink.write("]", 1);
+                    if (ok) sink.done();
+                    return ok;
+                });
+        });
+    }
+#endif
+
+    // Latest value per source and key: /state (all), /state?since=N (changed after
+    // version N), /state/<source>/<key>. Items carry their version; the response
+    // carries the next cursor.
+    if (state_) {
+        auto with_version = [](uint64_t v, const std::string& doc) {
+            return "{\"version\":" + std::to_string(v) + "," + doc.substr(1);
+        };
+        svr.Get("/state", [this, with_version](const httplib::Request& req, httplib::Response& res){
+            uint64_t since = 0;
+            try {
+                if (req.has_param("since")) since = std::stoull(req.get_param_value("since"));
+            } catch (const std::exception&) {
+                res.status = 400;
+                res.set_content("bad since", "text/plain");
+                return;
+            }
+            std::string items;
+            uint64_t next = state_->changed_since(since, [&](const std::string&, uint64_t v, const StateStore::DocRef& doc) {
+                if (!items.empty()) items += ',';
+                items += with_version(v, *doc);
+            });
+            res.set_content("{\"version\":" + std::to_string(next) + ",\"items\":[" + items + "]}", "application/json");
+        });
+        svr.Get(R"(/state/(.+))", [this, with_version](const httplib::Request& req, httplib::Response& res){
+            uint64_t v = 0;
+            auto doc = state_->get(req.matches[1], &v);
+            if (!doc) {
+                res.status = 404;
+                res.set_content("unknown source/key", "text/plain");
+                return;
+            }
+            res.set_content(with_version(v, *doc), "application/json");
+        });
+    }
+
+    // Per-source sketches merged over worker shards: /stats, /stats/<source>.
+    if (sketches_) {
+        svr.Get("/stats", [this](const httplib::Request&, httplib::Response& res){
+            res.set_content(sketches_->stats().dump(), "application/json");
+        });
+        svr.Get(R"(/stats/(.+))", [this](const httplib::Request& req, httplib::Response& res){
+            auto out = sketches_->stats(req.matches[1]);
+            if (out.is_null()) {
+                res.status = 404;
+                res.set_content("unknown source", "text/plain");
+                return;
+            }
+            res.set_content(out.dump(), "application/json");
+        });
+    }
+
+    // Bulk ingestion: POST /ingest[?source=name] with NDJSON (application/x-ndjson)
+    // or a JSON array, optionally gzip-encoded. The body is read in chunks and
+    // submitted in batches without blocking; 202 when everything was queued,
+    // 429/503 with Retry-After when the engine refused part of it. The response
+    // reports how many records from the start of the body were accepted.
+    if (ingest_) {
+        svr.Post("/ingest", [this](const httplib::Request& req, httplib::Response& res,
+                                   const httplib::ContentReader& reader){
+            if (req.is_multipart_form_data()) {
+                res.status = 415;
+                res.set_content("send NDJSON or a JSON array, not a form", "text/plain");
+                return;
+            }
+            const std::string client = req.has_header("X-Client-Id") ? req.get_header_value("X-Client-Id") : req.remote_addr;
+            auto body = ingest_->begin(IngestHandler::format_for(req.get_header_value("Content-Type")),
+                                       req.has_param("source") ? req.get_param_value("source") : std::string(), client);
+            const bool complete = reader([&](const char* data, size_t n){ return body.feed(data, n); });
+            auto result = body.finish();
+            // Stopped before the end: the unread rest of the body rules out keep-alive.
+            if (!complete) res.set_header("Connection", "close");
+            if (result.status == 429 || result.status == 503) res.set_header("Retry-After", "1");
+            res.status = result.status;
+            res.set_content(result.json(), "application/json");
+        });
+    }
+
+    // Sampled pipeline spans as Chrome trace-event JSON (open in Perfetto):
+    // /trace, or /trace?last_ms=N for spans that ended in the last N ms.
+    if (engine_.tracer().enabled()) {
+        svr.Get("/trace", [this](const httplib::Request& req, httplib::Response& res){
+            int64_t from, to;
+            size_t limit = 0;
+            if (!parse_time_range(req, from, to, limit)) {
+                res.status = 400;
+                res.set_content("bad query parameter", "text/plain");
+                return;
+            }
+            res.set_header("Content-Disposition", "attachment; filename=\"crossbring-trace.json\"");
+            // Spans are timed on the steady clock.
+            res.set_content(engine_.tracer().chrome_json(unix_to_steady_ns(from)), "application/json");
+        });
+    }
+
     svr.Get("/", [](const httplib::Request&, httplib::Response& res){
         static const char* html = R"HTML(
 <!doctype html>
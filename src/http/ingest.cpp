@@ -0,0 +1,207 @@
+#include "crossbring/http/ingest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+namespace crossbring {
+
+namespace {
+
+// Parsers keep scratch state, so each HTTP thread has its own.
+RecordParser& parser() {
+    thread_local std::unique_ptr<RecordParser> p = make_record_parser("scan");
+    return *p;
+}
+
+bool blank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+} // namespace
+
+std::string IngestHandler::Result::json() const {
+    std::string out = "{\"accepted\":" + std::to_string(accepted) + ",\"rejected\":" + std::to_string(rejected);
+    if (!error.empty()) out += ",\"error\":" + nlohmann::json(error).dump();
+    out += '}';
+    return out;
+}
+
+IngestHandler::IngestHandler(Engine& engine, Options opts)
+    : engine_(engine), opts_(std::move(opts)),
+      accepted_(engine.metrics().counter_vec("crossbring_ingest_accepted_total",
+                                             "Events accepted through POST /ingest per client", "client")),
+      rejected_(engine.metrics().counter_vec("crossbring_ingest_rejected_total",
+                                             "Malformed or engine-refused events on POST /ingest per client", "client")),
+      malformed_(engine.metrics().counter("crossbring_ingest_malformed_total", "POST /ingest bodies with a malformed record")) {
+    if (opts_.batch_size == 0) opts_.batch_size = 1;
+}
+
+IngestHandler::Format IngestHandler::format_for(const std::string& content_type) {
+    std::string ct = content_type;
+    std::transform(ct.begin(), ct.end(), ct.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    const bool lines = ct.find("ndjson") != std::string::npos || ct.find("jsonl") != std::string::npos ||
+                       ct.find("json-lines") != std::string::npos;
+    return lines ? Format::Ndjson : Format::Json;
+}
+
+std::string IngestHandler::client_label(const std::string& client) {
+    std::lock_guard<std::mutex> lock(clients_mu_);
+    if (clients_.count(client)) return client;
+    if (clients_.size() >= opts_.max_clients) return "other";
+    clients_.insert(client);
+    return client;
+}
+
+IngestHandler::Request IngestHandler::begin(Format format, const std::string& source, const std::string& client) {
+    return Request(*this, format, source.empty() ? opts_.source : source, client_label(client));
+}
+
+IngestHandler::Request::Request(IngestHandler& h, Format format, std::string source, const std::string& client)
+    : h_(h), format_(format), source_(std::move(source)), accepted_(h.accepted_.with(client)),
+      rejected_(h.rejected_.with(client)) {
+    batch_.reserve(h_.opts_.batch_size);
+    if (!h_.engine_.running()) fail(503, "engine is stopping");
+    else if (h_.engine_.memory().over_limit()) fail(503, "memory budget exhausted");
+}
+
+bool IngestHandler::Request::feed(const char* data, size_t n) {
+    if (stopped_) return false;
+    if (format_ == Format::Json) {
+        pending_.append(data, n);
+        return true;
+    }
+    // Whole lines are parsed now; a partial last line waits for the next chunk.
+    const char* end = data + n;
+    const char* nl = end;
+    while (nl != data && nl[-1] != '\n') --nl;
+    if (nl == data) {
+        pending_.append(data, n);
+        return true;
+    }
+    if (pending_.empty()) {
+        add_lines(data, nl);
+    } else {
+        pending_.append(data, nl);
+        add_lines(pending_.data(), pending_.data() + pending_.size());
+    }
+    pending_.assign(nl, end);
+    return !stopped_;
+}
+
+IngestHandler::Result IngestHandler::Request::finish() {
+    if (!stopped_ && format_ == Format::Ndjson && !pending_.empty()) {
+        add_lines(pending_.data(), pending_.data() + pending_.size());
+    } else if (!stopped_ && format_ == Format::Json) {
+        if (std::all_of(pending_.begin(), pending_.end(), blank)) {
+            fail(400, "empty body");
+        } else {
+            try {
+                add_doc(pending_, 0);
+            } catch (const std::exception& e) {
+                flush();
+                if (!stopped_) reject(e.what());
+            }
+        }
+    }
+    flush();
+    if (result_.status == 400) h_.malformed_.inc();
+    return result_;
+}
+
+// Parses a run of NDJSON lines as one array, so the record scanner validates
+// them and finds their ids in a single pass. If the run is malformed it is
+// parsed again line by line to find the bad one.
+void IngestHandler::Request::add_lines(const char* begin, const char* end) {
+    std::vector<std::string_view> lines;
+    for (const char* p = begin; p < end;) {
+        const char* e = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!e) e = end;
+        const char* b = p;
+        const char* t = e;
+        while (b < t && blank(*b)) ++b;
+        while (t > b && blank(t[-1])) --t;
+        if (b < t) lines.emplace_back(b, static_cast<size_t>(t - b));
+        p = e + 1;
+    }
+    if (lines.empty()) return;
+
+    doc_.assign(1, '[');
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i) doc_ += ',';
+        doc_.append(lines[i]);
+    }
+    doc_ += ']';
+    const size_t mark = batch_.size();
+    const size_t seen = records_;
+    try {
+        add_doc(doc_, lines.size());
+    } catch (const std::exception&) {
+        batch_.resize(mark);
+        records_ = seen;
+        for (auto line : lines) {
+            doc_.assign(1, '[').append(line) += ']';
+            try {
+                add_doc(doc_, 1);
+            } catch (const std::exception& e) {
+                flush(); // the good lines before it still go in, keeping `accepted` a prefix
+                if (!stopped_) reject("record " + std::to_string(records_) + ": " + e.what());
+                return;
+            }
+        }
+    }
+    if (batch_.size() >= h_.opts_.batch_size) flush();
+}
+
+// Appends the records of `doc` to the batch. `expected` > 0 means doc wraps
+// that many NDJSON lines, each of which must be exactly one record; batches
+// are then flushed by the caller, which may still roll them back. A JSON body
+// (expected == 0) is flushed as it goes.
+void IngestHandler::Request::add_doc(std::string_view doc, size_t expected) {
+    const auto now = std::chrono::steady_clock::now();
+    const size_t n = parser().for_each(doc, [&](const JsonRecord& rec) {
+        if (stopped_) return;
+        Event ev;
+        ev.tp = now;
+        ev.source = source_;
+        ev.key = rec.key.empty() ? std::to_string(records_) : std::string(rec.key);
+        ev.raw.assign(rec.text.data(), rec.text.size());
+        batch_.push_back(std::move(ev));
+        ++records_;
+        if (expected == 0 && batch_.size() >= h_.opts_.batch_size) flush();
+    });
+    if (expected && n != expected) throw std::runtime_error("a line holds more than one record");
+}
+
+void IngestHandler::Request::flush() {
+    if (batch_.empty() || stopped_) return;
+    const size_t n = batch_.size();
+    const size_t ok = h_.engine_.try_submit_batch(batch_);
+    result_.accepted += ok;
+    accepted_.inc(ok);
+    if (ok == n) return;
+    result_.rejected += n - ok;
+    rejected_.inc(n - ok);
+    if (!h_.engine_.running()) fail(503, "engine is stopping");
+    else if (h_.engine_.memory().over_limit()) fail(503, "memory budget exhausted");
+    else fail(429, "engine queue is full");
+}
+
+// A malformed record (bad JSON or invalid UTF-8) never reaches the engine; it
+// counts as rejected and ends the request.
+void IngestHandler::Request::reject(std::string error) {
+    result_.rejected += 1;
+    rejected_.inc();
+    fail(400, std::move(error));
+}
+
+void IngestHandler::Request::fail(int status, std::string error) {
+    stopped_ = true;
+    batch_.clear();
+    result_.status = status;
+    result_.error = std::move(error);
+}
+
+} // namespace crossbring
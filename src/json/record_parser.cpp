@@ -0,0 +1,418 @@
+#include "crossbring/json/record_parser.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CROSSBRING_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace crossbring {
+
+namespace {
+
+// Finds the next byte inside a JSON string that needs attention: a quote,
+// a backslash, a control character or a non-ASCII byte (UTF-8 is checked
+// separately). Long free-text fields (AF descriptions) dominate the payloads,
+// so this is where the time goes.
+using SpecialFn = const char* (*)(const char* p, const char* end);
+
+const char* special_scalar(const char* p, const char* end) {
+    for (; p < end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) return p;
+    }
+    return end;
+}
+
+#ifdef CROSSBRING_X86_SIMD
+__attribute__((target("sse2")))
+const char* special_sse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                                 _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+        int mask = _mm_movemask_epi8(m) | _mm_movemask_epi8(v); // high bit: non-ASCII
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    return special_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* special_avx2(const char* p, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+                                    _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m) | _mm256_movemask_epi8(v));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return special_sse2(p, end);
+}
+#endif
+
+struct Dispatch {
+    SpecialFn fn = special_scalar;
+    const char* isa = "scalar";
+    Dispatch() {
+#ifdef CROSSBRING_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { fn = special_avx2; isa = "avx2"; }
+        else if (__builtin_cpu_supports("sse2")) { fn = special_sse2; isa = "sse2"; }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch d;
+    return d;
+}
+
+constexpr int kMaxDepth = 256;
+
+class Scanner {
+public:
+    Scanner(std::string_view s, std::string_view capture)
+        : begin_(s.data()), p_(s.data()), end_(s.data() + s.size()), special_(dispatch().fn), capture_(capture) {}
+
+    size_t records(const std::function<void(const JsonRecord&)>& fn) {
+        ws();
+        size_t n = 0;
+        bool found = false;
+        if (peek() == '[') {
+            n = array_records(fn);
+            found = true;
+        } else {
+            expect('{');
+            ws();
+            while (peek() != '}') {
+                std::string_view k = string();
+                ws(); expect(':'); ws();
+                if (k == "ads" && peek() == '[') { n += array_records(fn); found = true; }
+                else value(1);
+                ws();
+                if (peek() != ',') break;
+                ++p_; ws();
+                if (peek() != '"') fail("unexpected character");
+            }
+            expect('}');
+        }
+        ws();
+        if (p_ != end_) fail("trailing characters");
+        if (!found) fail("JSON not array or ads[]");
+        return n;
+    }
+
+    size_t array_records(const std::function<void(const JsonRecord&)>& fn) {
+        expect('[');
+        ws();
+        size_t n = 0;
+        if (peek() == ']') { ++p_; return 0; }
+        while (true) {
+            JsonRecord rec;
+            const char* start = p_;
+            if (peek() == '{') record_object(rec);
+            else value(1);
+            rec.text = std::string_view(start, static_cast<size_t>(p_ - start));
+            fn(rec);
+            ++n;
+            ws();
+            if (peek() == ',') { ++p_; ws(); continue; }
+            expect(']');
+            return n;
+        }
+    }
+
+private:
+    void record_object(JsonRecord& rec) {
+        expect('{');
+        ws();
+        if (peek() == '}') { ++p_; return; }
+        bool have_id = false;
+        while (true) {
+            std::string_view k = string();
+            ws(); expect(':'); ws();
+            bool is_id = k == "id";
+            const bool want_key = is_id || (k == "job_id" && !have_id);
+            const bool want_field = !capture_.empty() && k == capture_;
+            if ((want_key || want_field) && (peek() == '"' || peek() == '-' || is_digit(peek()))) {
+                std::string_view v;
+                const bool quoted = peek() == '"';
+                if (quoted) v = string();
+                else { const char* s = p_; number(); v = std::string_view(s, static_cast<size_t>(p_ - s)); }
+                if (want_key) {
+                    rec.key = quoted ? unescape(v, key_buf_) : v;
+                    have_id = have_id || is_id;
+                }
+                if (want_field) rec.field = quoted ? unescape(v, field_buf_) : v;
+            } else {
+                value(2);
+            }
+            ws();
+            if (peek() == ',') { ++p_; ws(); continue; }
+            expect('}');
+            return;
+        }
+    }
+
+    void value(int depth) {
+        if (depth > kMaxDepth) fail("nesting too deep");
+        switch (peek()) {
+        case '{': {
+            ++p_; ws();
+            if (peek() == '}') { ++p_; return; }
+            while (true) {
+                string(); ws(); expect(':'); ws();
+                value(depth + 1); ws();
+                if (peek() == ',') { ++p_; ws(); continue; }
+                expect('}');
+                return;
+            }
+        }
+        case '[': {
+            ++p_; ws();
+            if (peek() == ']') { ++p_; return; }
+            while (true) {
+                value(depth + 1); ws();
+                if (peek() == ',') { ++p_; ws(); continue; }
+                expect(']');
+                return;
+            }
+        }
+        case '"': string(); return;
+        case 't': literal("true"); return;
+        case 'f': literal("false"); return;
+        case 'n': literal("null"); return;
+        default:
+            if (peek() == '-' || is_digit(peek())) { number(); return; }
+            fail("unexpected character");
+        }
+    }
+
+    // Returns the raw contents between the quotes (escapes left as-is). Rejects
+    // what nlohmann::json::parse would: invalid UTF-8 and unpaired surrogates.
+    std::string_view string() {
+        expect('"');
+        const char* start = p_;
+        while (true) {
+            p_ = special_(p_, end_);
+            if (p_ == end_) fail("unterminated string");
+            const unsigned char c = static_cast<unsigned char>(*p_);
+            if (c == '"') break;
+            if (c >= 0x80) { utf8(); continue; }
+            if (c != '\\') fail("control character in string");
+            if (++p_ == end_) fail("unterminated escape");
+            switch (*p_) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': ++p_; break;
+            case 'u': {
+                ++p_;
+                const unsigned u = hex4();
+                if (u >= 0xDC00 && u <= 0xDFFF) fail("unpaired surrogate");
+                if (u >= 0xD800 && u <= 0xDBFF) {
+                    if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') fail("unpaired surrogate");
+                    p_ += 2;
+                    const unsigned lo = hex4();
+                    if (lo < 0xDC00 || lo > 0xDFFF) fail("unpaired surrogate");
+                }
+                break;
+            }
+            default: fail("bad escape");
+            }
+        }
+        std::string_view out(start, static_cast<size_t>(p_ - start));
+        ++p_;
+        return out;
+    }
+
+    // Validates one UTF-8 sequence starting at p_ (a byte >= 0x80) and steps
+    // over it: no overlong forms, surrogates or code points above U+10FFFF.
+    void utf8() {
+        const unsigned char c = static_cast<unsigned char>(*p_);
+        size_t n;
+        unsigned char lo = 0x80, hi = 0xBF; // allowed range of the second byte
+        if (c >= 0xC2 && c <= 0xDF) n = 1;
+        else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            if (c == 0xE0) lo = 0xA0;
+            else if (c == 0xED) hi = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            if (c == 0xF0) lo = 0x90;
+            else if (c == 0xF4) hi = 0x8F;
+        } else {
+            fail("invalid UTF-8");
+        }
+        if (static_cast<size_t>(end_ - p_) <= n) fail("invalid UTF-8");
+        for (size_t i = 1; i <= n; ++i) {
+            const unsigned char b = static_cast<unsigned char>(p_[i]);
+            if (b < (i == 1 ? lo : 0x80) || b > (i == 1 ? hi : 0xBF)) fail("invalid UTF-8");
+        }
+        p_ += n + 1;
+    }
+
+    unsigned hex4() {
+        unsigned v = 0;
+        for (int i = 0; i < 4; ++i, ++p_) {
+            if (p_ == end_ || !is_hex(*p_)) fail("bad \\u escape");
+            const char c = *p_;
+            v = v * 16 + static_cast<unsigned>(is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return v;
+    }
+
+    // Decodes the escapes of a validated string body into buf; the view is
+    // only copied when there is something to decode.
+    static std::string_view unescape(std::string_view raw, std::string& buf) {
+        if (raw.find('\\') == std::string_view::npos) return raw;
+        buf.clear();
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\') { buf += raw[i]; continue; }
+            switch (raw[++i]) {
+            case 'b': buf += '\b'; break;
+            case 'f': buf += '\f'; break;
+            case 'n': buf += '\n'; break;
+            case 'r': buf += '\r'; break;
+            case 't': buf += '\t'; break;
+            case 'u': {
+                auto hex = [&](size_t at) { return static_cast<unsigned>(std::stoul(std::string(raw.substr(at, 4)), nullptr, 16)); };
+                unsigned cp = hex(i + 1);
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) { // validated: a low surrogate follows
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (hex(i + 3) - 0xDC00);
+                    i += 6;
+                }
+                if (cp < 0x80) {
+                    buf += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    buf += static_cast<char>(0xC0 | (cp >> 6));
+                    buf += static_cast<char>(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    buf += static_cast<char>(0xE0 | (cp >> 12));
+                    buf += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    buf += static_cast<char>(0x80 | (cp & 0x3F));
+                } else {
+                    buf += static_cast<char>(0xF0 | (cp >> 18));
+                    buf += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    buf += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    buf += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default: buf += raw[i]; // '"', '\\' and '/'
+            }
+        }
+        return buf;
+    }
+
+    void number() {
+        if (peek() == '-') ++p_;
+        if (peek() == '0') ++p_;
+        else if (is_digit(peek())) { while (is_digit(peek())) ++p_; }
+        else fail("bad number");
+        if (peek() == '.') {
+            ++p_;
+            if (!is_digit(peek())) fail("bad number");
+            while (is_digit(peek())) ++p_;
+        }
+        if (peek() == 'e' || peek() == 'E') {
+            ++p_;
+            if (peek() == '+' || peek() == '-') ++p_;
+            if (!is_digit(peek())) fail("bad number");
+            while (is_digit(peek())) ++p_;
+        }
+    }
+
+    void literal(const char* lit) {
+        size_t n = std::strlen(lit);
+        if (static_cast<size_t>(end_ - p_) < n || std::memcmp(p_, lit, n) != 0) fail("bad literal");
+        p_ += n;
+    }
+
+    void ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+    char peek() const { return p_ < end_ ? *p_ : '\0'; }
+    void expect(char c) {
+        if (peek() != c) fail("unexpected character");
+        ++p_;
+    }
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    static bool is_hex(char c) { return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("JSON scan: ") + what + " at offset " + std::to_string(p_ - begin_));
+    }
+
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+    SpecialFn special_;
+    std::string_view capture_;
+    std::string key_buf_;   // unescaped key/field of the current record
+    std::string field_buf_;
+};
+
+class ScanRecordParser : public RecordParser {
+public:
+    size_t for_each(std::string_view doc, const std::function<void(const JsonRecord&)>& fn) override {
+        Scanner s(doc, capture_);
+        return s.records(fn);
+    }
+    std::string name() const override { return std::string("scan/") + json_scan_isa(); }
+};
+
+// Reference path: full DOM parse, then re-serialize each element.
+class DomRecordParser : public RecordParser {
+public:
+    size_t for_each(std::string_view doc, const std::function<void(const JsonRecord&)>& fn) override {
+        auto j = nlohmann::json::parse(doc.begin(), doc.end());
+        const nlohmann::json* arr = nullptr;
+        if (j.is_object() && j.contains("ads") && j["ads"].is_array()) arr = &j["ads"];
+        else if (j.is_array()) arr = &j;
+        else throw std::runtime_error("JSON not array or ads[]");
+
+        size_t n = 0;
+        for (auto& item : *arr) {
+            std::string key;
+            std::string field;
+            if (item.is_object()) {
+                auto it = item.find("id");
+                if (it == item.end()) it = item.find("job_id");
+                if (it != item.end()) key = it->is_string() ? it->get<std::string>() : it->dump();
+                if (!capture_.empty()) {
+                    auto f = item.find(capture_);
+                    if (f != item.end() && (f->is_string() || f->is_number())) field = f->is_string() ? f->get<std::string>() : f->dump();
+                }
+            }
+            std::string text = item.dump();
+            JsonRecord rec{key, text, field};
+            fn(rec);
+            ++n;
+        }
+        return n;
+    }
+    std::string name() const override { return "nlohmann"; }
+};
+
+} // namespace
+
+std::unique_ptr<RecordParser> make_record_parser(const std::string& kind) {
+    if (kind == "nlohmann") return std::make_unique<DomRecordParser>();
+    if (kind == "auto" || kind == "scan") return std::make_unique<ScanRecordParser>();
+    throw std::runtime_error("Unknown JSON parser: " + kind);
+}
+
+const char* json_scan_isa() { return dispatch().isa; }
+
+} // namespace crossbring
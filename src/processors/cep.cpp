@@ -0,0 +1,185 @@
+#include "crossbring/processors/cep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+
+#include "crossbring/core/clock.h"
+
+namespace crossbring {
+
+namespace {
+
+int64_t to_ns(std::chrono::steady_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+} // namespace
+
+CepStage::CepStage(Engine& engine, std::vector<CepPattern> patterns, Options opts)
+    : engine_(engine), opts_(opts),
+      active_(engine.metrics().gauge("crossbring_cep_partials", "Partial pattern matches held")),
+      expired_(engine.metrics().counter("crossbring_cep_expired_total", "Partial matches dropped by their time window")),
+      overflow_(engine.metrics().counter("crossbring_cep_overflow_total", "Partial matches not started because a shard was full")) {
+    if (opts_.shards == 0) opts_.shards = 1;
+    if (opts_.tick_ms == 0) opts_.tick_ms = 1;
+    if (opts_.wheel_slots == 0) opts_.wheel_slots = 1;
+    tick_ns_ = static_cast<int64_t>(opts_.tick_ms) * 1000000;
+
+    patterns_.reserve(patterns.size());
+    for (auto& spec : patterns) {
+        if (spec.steps.empty()) throw std::invalid_argument("cep pattern '" + spec.name + "' has no steps");
+        std::unique_ptr<Expression> scope;
+        if (!spec.scope.empty()) scope = std::make_unique<Expression>(Expression::compile(spec.scope));
+        Expression partition = Expression::compile(spec.partition);
+        std::vector<Expression> steps;
+        for (auto& st : spec.steps) {
+            if (st.times == 0) st.times = 1;
+            steps.push_back(Expression::compile(st.when));
+        }
+        Counter* matches = &engine.metrics().counter("crossbring_cep_matches_total", "Completed pattern matches",
+                                                      {{"pattern", spec.name}});
+        alert_sources_.insert(spec.alert_source);
+        patterns_.push_back(Compiled{std::move(spec), std::move(scope), std::move(partition), std::move(steps), matches});
+    }
+
+    shards_.reset(new Shard[opts_.shards]);
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        shards_[i].by_pattern.resize(patterns_.size());
+        shards_[i].wheel.resize(opts_.wheel_slots);
+    }
+}
+
+void CepStage::process(const Event& ev) {
+    // Our own alerts come back through the pipeline; never feed them into patterns.
+    if (alert_sources_.count(ev.source)) return;
+
+    thread_local std::string key;
+    thread_local std::vector<Event> alerts;
+    const int64_t now = to_ns(ev.tp);
+
+    for (uint32_t pi = 0; pi < patterns_.size(); ++pi) {
+        const Compiled& p = patterns_[pi];
+        if (p.scope && !p.scope->test(ev)) continue;
+        // A null partition keeps the event out of this pattern.
+        if (!p.partition.eval(ev).to_key(key)) continue;
+
+        Shard& s = shards_[(std::hash<std::string>{}(key) ^ (pi * 0x9e3779b97f4a7c15ull)) % opts_.shards];
+        std::lock_guard<std::mutex> lock(s.mu);
+        advance(s, now);
+
+        auto& map = s.by_pattern[pi];
+        auto it = map.find(key);
+        if (it != map.end() && now - it->second.first_ns > p.spec.within_ms * 1000000) {
+            erase_partial(s, pi, it);
+            expired_.inc();
+            it = map.end();
+        }
+
+        const uint32_t step = it == map.end() ? 0 : it->second.step;
+        if (!p.steps[step].test(ev)) {
+            // A miss breaks a run of repeats; before the first step completes that
+            // means starting over.
+            if (it != map.end() && it->second.count > 0) {
+                it->second.count = 0;
+                if (it->second.step == 0) erase_partial(s, pi, it);
+            }
+            continue;
+        }
+
+        if (it == map.end()) {
+            if (s.partials >= opts_.max_partials_per_shard) {
+                overflow_.inc();
+                continue;
+            }
+            const int64_t deadline = now + p.spec.within_ms * 1000000;
+            const int64_t tick = std::max(deadline / tick_ns_, s.cursor + 1);
+            const size_t slot = static_cast<size_t>(tick) % s.wheel.size();
+            Partial st;
+            st.first_ns = now;
+            st.slot = static_cast<uint32_t>(slot);
+            st.pos = static_cast<uint32_t>(s.wheel[slot].size());
+            it = map.emplace(key, st).first;
+            s.wheel[slot].push_back(Timer{pi, deadline, &*it});
+            ++s.partials;
+            active_.add();
+        }
+
+        Partial& st = it->second;
+        if (++st.count < p.spec.steps[st.step].times) continue;
+        st.count = 0;
+        if (++st.step < p.steps.size()) continue;
+
+        alerts.push_back(make_alert(p, key, st, ev));
+        p.matches->inc();
+        erase_partial(s, pi, it);
+    }
+
+    // Outside the shard locks; try_submit so a full queue cannot block a worker on itself.
+    for (auto& a : alerts) engine_.try_submit(std::move(a));
+    alerts.clear();
+}
+
+// Called with the shard lock held. Runs every tick between the last call and
+// `now`; a gap longer than the wheel just visits each slot once.
+void CepStage::advance(Shard& s, int64_t now_ns) {
+    const int64_t tick = now_ns / tick_ns_;
+    if (s.cursor < 0) {
+        s.cursor = tick;
+        return;
+    }
+    if (tick <= s.cursor) return;
+    const int64_t slots = static_cast<int64_t>(s.wheel.size());
+    const int64_t steps = std::min(tick - s.cursor, slots);
+    for (int64_t t = tick - steps + 1; t <= tick; ++t) expire_slot(s, static_cast<size_t>(t % slots), now_ns);
+    s.cursor = tick;
+}
+
+void CepStage::expire_slot(Shard& s, size_t slot, int64_t now_ns) {
+    auto& timers = s.wheel[slot];
+    for (size_t i = 0; i < timers.size();) {
+        const Timer& t = timers[i];
+        if (t.deadline_ns > now_ns) { // belongs to a later lap of the wheel
+            ++i;
+            continue;
+        }
+        // Erasing moves the slot's last timer into position i; look at it next.
+        auto& map = s.by_pattern[t.pattern];
+        erase_partial(s, t.pattern, map.find(t.owner->first));
+        expired_.inc();
+    }
+}
+
+// Removes the partial and its timer; the slot's last timer takes the freed place.
+void CepStage::erase_partial(Shard& s, uint32_t pattern, PartialMap::iterator it) {
+    auto& timers = s.wheel[it->second.slot];
+    const uint32_t pos = it->second.pos;
+    if (pos + 1 != timers.size()) {
+        timers[pos] = timers.back();
+        timers[pos].owner->second.pos = pos;
+    }
+    timers.pop_back();
+    s.by_pattern[pattern].erase(it);
+    --s.partials;
+    active_.sub();
+}
+
+Event CepStage::make_alert(const Compiled& p, const std::string& key, const Partial& st, const Event& last) const {
+    Event a;
+    a.tp = last.tp;
+    a.source = p.spec.alert_source;
+    a.key = key;
+    a.payload = {
+        {"type", "alert"},
+        {"pattern", p.spec.name},
+        {"partition", key},
+        {"first_ts_ns", steady_to_unix_ns(st.first_ns)},
+        {"last_ts_ns", to_unix_ns(last.tp)},
+        {"duration_ms", static_cast<double>(to_ns(last.tp) - st.first_ns) / 1e6},
+        {"trigger", {{"source", last.source}, {"key", last.key}}},
+    };
+    return a;
+}
+
+} // namespace crossbring
@@ -0,0 +1,204 @@
+#include "crossbring/processors/enrich_stage.h"
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace crossbring {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> split_target(const std::string& path) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t dot = path.find('.', start);
+        if (dot == std::string::npos) dot = path.size();
+        if (dot > start) out.push_back(path.substr(start, dot - start));
+        start = dot + 1;
+    }
+    return out;
+}
+
+nlohmann::json to_json(const LookupTable::Value& v) {
+    using T = LookupTable::Value::Type;
+    switch (v.type) {
+    case T::Bool: return v.b;
+    case T::Number:
+        // Codes and counts read back as integers, as they were written.
+        if (std::trunc(v.num) == v.num && std::fabs(v.num) < 9.0e15) return static_cast<int64_t>(v.num);
+        return v.num;
+    case T::String: return std::string(v.str);
+    case T::Json: return nlohmann::json::parse(v.str, nullptr, false);
+    default: return nullptr;
+    }
+}
+
+std::atomic<uint64_t> next_stage_id{1};
+
+} // namespace
+
+EnrichStage::EnrichStage(Engine& engine, Options opts)
+    : opts_(std::move(opts)),
+      precompiled_(opts_.table.extension() == ".lut"),
+      on_(Expression::compile(opts_.on)),
+      target_(split_target(opts_.target.empty() ? opts_.name : opts_.target)),
+      id_(next_stage_id.fetch_add(1, std::memory_order_relaxed)),
+      hits_(engine.metrics().counter("crossbring_enrich_hits_total", "Events joined to a reference row", {{"table", opts_.name}})),
+      misses_(engine.metrics().counter("crossbring_enrich_misses_total", "Events whose key is not in the reference table", {{"table", opts_.name}})),
+      conflicts_(engine.metrics().counter("crossbring_enrich_conflicts_total", "Hits not written because the target path holds a non-object", {{"table", opts_.name}})),
+      reloads_(engine.metrics().counter("crossbring_enrich_reloads_total", "Reference tables rebuilt and swapped in", {{"table", opts_.name}})),
+      reload_errors_(engine.metrics().counter("crossbring_enrich_reload_errors_total", "Failed reference table rebuilds", {{"table", opts_.name}})),
+      rows_(engine.metrics().gauge("crossbring_enrich_rows", "Rows in the current reference table", {{"table", opts_.name}})) {
+    if (target_.empty()) throw std::invalid_argument("enrich: empty target field");
+    if (opts_.compiled.empty()) {
+        opts_.compiled = opts_.table;
+        opts_.compiled += ".lut";
+    }
+    last_fingerprint_ = pending_fingerprint_ = fingerprint();
+    if (!fs::exists(opts_.table)) {
+        spdlog::warn("Enrich {}: {} not found; waiting for it", opts_.name, opts_.table.string());
+        return;
+    }
+    reload();
+}
+
+EnrichStage::~EnrichStage() { stop(); }
+
+void EnrichStage::start() {
+    if (opts_.poll_ms <= 0 || running_.exchange(true)) return;
+    th_ = std::thread([this]{ run(); });
+}
+
+void EnrichStage::stop() {
+    if (!running_.exchange(false)) return;
+    { std::lock_guard<std::mutex> lock(wake_mu_); }
+    wake_cv_.notify_all();
+    if (th_.joinable()) th_.join();
+}
+
+std::string EnrichStage::fingerprint() const {
+    std::error_code ec;
+    auto sz = fs::file_size(opts_.table, ec);
+    auto wt = fs::last_write_time(opts_.table, ec).time_since_epoch().count();
+    return std::to_string(sz) + ":" + std::to_string(wt);
+}
+
+std::shared_ptr<const EnrichStage::Snapshot> EnrichStage::load() const {
+    if (!precompiled_) LookupTable::compile(opts_.table, opts_.compiled, opts_.key_column);
+    auto snap = std::make_shared<Snapshot>();
+    snap->table = LookupTable::open(precompiled_ ? opts_.table : opts_.compiled);
+    const LookupTable& t = *snap->table;
+    if (opts_.columns.empty()) {
+        for (size_t c = 0; c < t.columns(); ++c) {
+            snap->columns.push_back(c);
+            snap->names.emplace_back(t.column(c));
+        }
+    } else {
+        for (auto& name : opts_.columns) {
+            size_t c = t.column_index(name);
+            if (c == LookupTable::npos) throw std::runtime_error("column '" + name + "' not in " + opts_.table.string());
+            snap->columns.push_back(c);
+            snap->names.push_back(name);
+        }
+    }
+    return snap;
+}
+
+void EnrichStage::reload() {
+    std::lock_guard<std::mutex> build(reload_mu_);
+    auto snap = load();
+    const size_t rows = snap->table->rows();
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        snap_ = std::move(snap);
+    }
+    version_.fetch_add(1, std::memory_order_release);
+    rows_.set(static_cast<int64_t>(rows));
+    reloads_.inc();
+    spdlog::info("Enrich {}: {} row(s) from {}", opts_.name, rows, opts_.table.string());
+}
+
+void EnrichStage::run() {
+    while (running_.load()) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mu_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(opts_.poll_ms), [this]{ return !running_.load(); });
+        }
+        if (!running_.load()) break;
+        // Rebuild only once the file has stopped changing for a poll interval, so a
+        // writer caught mid-copy does not publish half a table.
+        std::string fp = fingerprint();
+        if (fp != last_fingerprint_ && fp == pending_fingerprint_) {
+            last_fingerprint_ = fp;
+            try {
+                reload();
+            } catch (const std::exception& e) {
+                reload_errors_.inc();
+                spdlog::warn("Enrich {}: reload failed, keeping the previous table: {}", opts_.name, e.what());
+            }
+        }
+        pending_fingerprint_ = fp;
+    }
+}
+
+const EnrichStage::Snapshot* EnrichStage::current() {
+    // Each thread holds a reference to the snapshot it last used and only takes
+    // the lock when the published version moves on, so readers share nothing on
+    // the hot path.
+    struct Cached {
+        uint64_t stage;
+        uint64_t version;
+        std::shared_ptr<const Snapshot> snap;
+    };
+    thread_local std::vector<Cached> cache;
+    const uint64_t v = version_.load(std::memory_order_acquire);
+    Cached* c = nullptr;
+    for (auto& e : cache) {
+        if (e.stage == id_) { c = &e; break; }
+    }
+    if (!c) c = &cache.emplace_back(Cached{id_, 0, nullptr});
+    if (c->version != v) {
+        std::lock_guard<std::mutex> lock(mu_);
+        c->snap = snap_;
+        c->version = v;
+    }
+    return c->snap.get();
+}
+
+void EnrichStage::process(Event& ev) {
+    thread_local std::string key;
+    if (!on_.eval(ev).to_key(key)) {
+        misses_.inc();
+        return;
+    }
+    const Snapshot* snap = current();
+    const size_t row = snap ? snap->table->find(key) : LookupTable::npos;
+    if (row == LookupTable::npos) {
+        misses_.inc();
+        return;
+    }
+    nlohmann::json* j = &ev.json();
+    for (auto& seg : target_) {
+        if (j->is_null()) *j = nlohmann::json::object();
+        if (!j->is_object()) break;
+        j = &(*j)[seg];
+    }
+    if (j->is_null()) *j = nlohmann::json::object();
+    if (!j->is_object()) {
+        conflicts_.inc();
+        return;
+    }
+    hits_.inc();
+    // Empty cells are left out rather than written as null.
+    for (size_t i = 0; i < snap->columns.size(); ++i) {
+        auto v = snap->table->value(row, snap->columns[i]);
+        if (v.type != LookupTable::Value::Type::Null) (*j)[snap->names[i]] = to_json(v);
+    }
+}
+
+} // namespace crossbring
@@ -0,0 +1,443 @@
+#include "crossbring/processors/expression.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "crossbring/core/metrics.h"
+
+namespace crossbring {
+
+bool ExprValue::truthy() const {
+    switch (type) {
+    case Type::Bool: return b;
+    case Type::Number: return num != 0.0;
+    case Type::String: return !str.empty();
+    default: return false;
+    }
+}
+
+bool ExprValue::to_key(std::string& out) const {
+    switch (type) {
+    case Type::String: out.assign(str.data(), str.size()); return true;
+    case Type::Number: {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "%.15g", num);
+        out.assign(buf, static_cast<size_t>(n));
+        return true;
+    }
+    case Type::Bool: out = b ? "true" : "false"; return true;
+    default: return false;
+    }
+}
+
+namespace {
+
+using Fn = Expression::Fn;
+using Path = std::vector<std::string>;
+
+Path split_path(std::string_view p) {
+    if (p.substr(0, 8) == "payload.") p.remove_prefix(8);
+    else if (p == "payload") return {};
+    Path out;
+    while (!p.empty()) {
+        size_t dot = p.find('.');
+        out.emplace_back(p.substr(0, dot));
+        p = dot == std::string_view::npos ? std::string_view{} : p.substr(dot + 1);
+    }
+    return out;
+}
+
+// Walks `path` from the payload root; nullptr when a segment is missing.
+const nlohmann::json* resolve(const Event& ev, const Path& path) {
+    const nlohmann::json* j = &ev.json();
+    for (const auto& seg : path) {
+        if (!j->is_object()) return nullptr;
+        auto it = j->find(seg);
+        if (it == j->end()) return nullptr;
+        j = &*it;
+    }
+    return j;
+}
+
+ExprValue from_json(const nlohmann::json* j) {
+    if (!j) return {};
+    switch (j->type()) {
+    case nlohmann::json::value_t::boolean: return ExprValue::boolean(j->get<bool>());
+    case nlohmann::json::value_t::number_integer:
+    case nlohmann::json::value_t::number_unsigned:
+    case nlohmann::json::value_t::number_float: return ExprValue::number(j->get<double>());
+    case nlohmann::json::value_t::string: return ExprValue::string(j->get_ref<const std::string&>());
+    default: return {};
+    }
+}
+
+bool equal(const ExprValue& a, const ExprValue& b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+    case ExprValue::Type::Bool: return a.b == b.b;
+    case ExprValue::Type::Number: return a.num == b.num;
+    case ExprValue::Type::String: return a.str == b.str;
+    default: return true;
+    }
+}
+
+// Three-way compare of two numbers or two strings; false when not comparable.
+bool compare(const ExprValue& a, const ExprValue& b, int& out) {
+    if (a.type == ExprValue::Type::Number && b.type == ExprValue::Type::Number) {
+        if (std::isnan(a.num) || std::isnan(b.num)) return false;
+        out = a.num < b.num ? -1 : a.num > b.num ? 1 : 0;
+        return true;
+    }
+    if (a.type == ExprValue::Type::String && b.type == ExprValue::Type::String) {
+        out = a.str.compare(b.str);
+        return true;
+    }
+    return false;
+}
+
+struct Node {
+    Fn fn;
+    bool constant = false;
+};
+
+// Evaluates nodes built only from literals once at compile time. String results
+// are left alone since they would point into the discarded children.
+Node fold(Node n) {
+    if (!n.constant) return n;
+    Event dummy;
+    ExprValue v = n.fn(dummy);
+    if (v.type == ExprValue::Type::String) return n;
+    return Node{[v](const Event&) { return v; }, true};
+}
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : s_(text) {}
+
+    Fn parse() {
+        Node n = parse_or();
+        skip_ws();
+        if (pos_ != s_.size()) fail("unexpected input");
+        return n.fn;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::invalid_argument("expression '" + s_ + "': " + what + " at offset " + std::to_string(pos_));
+    }
+
+    void skip_ws() {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_;
+    }
+
+    bool eat(std::string_view op) {
+        skip_ws();
+        if (s_.compare(pos_, op.size(), op) != 0) return false;
+        pos_ += op.size();
+        return true;
+    }
+
+    void expect(char c) {
+        skip_ws();
+        if (pos_ >= s_.size() || s_[pos_] != c) fail(std::string("expected '") + c + "'");
+        ++pos_;
+    }
+
+    Node parse_or() {
+        Node l = parse_and();
+        while (eat("||")) {
+            Node r = parse_and();
+            l = fold({[a = l.fn, b = r.fn](const Event& ev) {
+                return ExprValue::boolean(a(ev).truthy() || b(ev).truthy());
+            }, l.constant && r.constant});
+        }
+        return l;
+    }
+
+    Node parse_and() {
+        Node l = parse_eq();
+        while (eat("&&")) {
+            Node r = parse_eq();
+            l = fold({[a = l.fn, b = r.fn](const Event& ev) {
+                return ExprValue::boolean(a(ev).truthy() && b(ev).truthy());
+            }, l.constant && r.constant});
+        }
+        return l;
+    }
+
+    Node parse_eq() {
+        Node l = parse_cmp();
+        while (true) {
+            bool ne;
+            if (eat("==")) ne = false;
+            else if (eat("!=")) ne = true;
+            else return l;
+            Node r = parse_cmp();
+            l = fold({[a = l.fn, b = r.fn, ne](const Event& ev) {
+                return ExprValue::boolean(equal(a(ev), b(ev)) != ne);
+            }, l.constant && r.constant});
+        }
+    }
+
+    Node parse_cmp() {
+        Node l = parse_add();
+        while (true) {
+            int op; // 0 <, 1 <=, 2 >, 3 >=
+            if (eat("<=")) op = 1;
+            else if (eat(">=")) op = 3;
+            else if (eat("<")) op = 0;
+            else if (eat(">")) op = 2;
+            else return l;
+            Node r = parse_add();
+            l = fold({[a = l.fn, b = r.fn, op](const Event& ev) {
+                int c = 0;
+                if (!compare(a(ev), b(ev), c)) return ExprValue::boolean(false);
+                switch (op) {
+                case 0: return ExprValue::boolean(c < 0);
+                case 1: return ExprValue::boolean(c <= 0);
+                case 2: return ExprValue::boolean(c > 0);
+                default: return ExprValue::boolean(c >= 0);
+                }
+            }, l.constant && r.constant});
+        }
+    }
+
+    static Node arith(Node l, Node r, char op) {
+        return fold({[a = l.fn, b = r.fn, op](const Event& ev) {
+            ExprValue x = a(ev), y = b(ev);
+            if (x.type != ExprValue::Type::Number || y.type != ExprValue::Type::Number) return ExprValue{};
+            switch (op) {
+            case '+': return ExprValue::number(x.num + y.num);
+            case '-': return ExprValue::number(x.num - y.num);
+            case '*': return ExprValue::number(x.num * y.num);
+            case '/': return y.num == 0.0 ? ExprValue{} : ExprValue::number(x.num / y.num);
+            default: return y.num == 0.0 ? ExprValue{} : ExprValue::number(std::fmod(x.num, y.num));
+            }
+        }, l.constant && r.constant});
+    }
+
+    Node parse_add() {
+        Node l = parse_mul();
+        while (true) {
+            if (eat("+")) l = arith(l, parse_mul(), '+');
+            else if (eat("-")) l = arith(l, parse_mul(), '-');
+            else return l;
+        }
+    }
+
+    Node parse_mul() {
+        Node l = parse_unary();
+        while (true) {
+            if (eat("*")) l = arith(l, parse_unary(), '*');
+            else if (eat("/")) l = arith(l, parse_unary(), '/');
+            else if (eat("%")) l = arith(l, parse_unary(), '%');
+            else return l;
+        }
+    }
+
+    Node parse_unary() {
+        skip_ws();
+        if (pos_ < s_.size() && s_[pos_] == '!' && (pos_ + 1 == s_.size() || s_[pos_ + 1] != '=')) {
+            ++pos_;
+            Node n = parse_unary();
+            return fold({[a = n.fn](const Event& ev) { return ExprValue::boolean(!a(ev).truthy()); }, n.constant});
+        }
+        if (eat("-")) {
+            Node n = parse_unary();
+            return fold({[a = n.fn](const Event& ev) {
+                ExprValue v = a(ev);
+                return v.type == ExprValue::Type::Number ? ExprValue::number(-v.num) : ExprValue{};
+            }, n.constant});
+        }
+        return parse_primary();
+    }
+
+    Node parse_primary() {
+        skip_ws();
+        if (pos_ >= s_.size()) fail("unexpected end");
+        char c = s_[pos_];
+        if (c == '(') {
+            ++pos_;
+            Node n = parse_or();
+            expect(')');
+            return n;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = s_.c_str() + pos_;
+            char* end = nullptr;
+            double v = std::strtod(begin, &end);
+            if (end == begin) fail("bad number");
+            pos_ += static_cast<size_t>(end - begin);
+            return {[v](const Event&) { return ExprValue::number(v); }, true};
+        }
+        if (c == '\'' || c == '"') return parse_string(c);
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') return parse_ident();
+        fail(std::string("unexpected '") + c + "'");
+    }
+
+    Node parse_string(char quote) {
+        ++pos_;
+        auto lit = std::make_shared<std::string>();
+        while (pos_ < s_.size() && s_[pos_] != quote) {
+            if (s_[pos_] == '\\' && pos_ + 1 < s_.size()) ++pos_;
+            lit->push_back(s_[pos_++]);
+        }
+        if (pos_ >= s_.size()) fail("unterminated string");
+        ++pos_;
+        // Held by shared_ptr so the view stays valid when the closure is moved.
+        std::shared_ptr<const std::string> held = std::move(lit);
+        return {[held](const Event&) { return ExprValue::string(*held); }, true};
+    }
+
+    std::string ident() {
+        size_t start = pos_;
+        while (pos_ < s_.size()) {
+            char c = s_[pos_];
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') break;
+            ++pos_;
+        }
+        return s_.substr(start, pos_ - start);
+    }
+
+    static Node field(const std::string& name) {
+        if (name == "source") return {[](const Event& ev) { return ExprValue::string(ev.source); }};
+        if (name == "key") return {[](const Event& ev) { return ExprValue::string(ev.key); }};
+        Path path = split_path(name);
+        if (path.size() == 1) {
+            return {[seg = path[0]](const Event& ev) {
+                const auto& j = ev.json();
+                if (!j.is_object()) return ExprValue{};
+                auto it = j.find(seg);
+                return it == j.end() ? ExprValue{} : from_json(&*it);
+            }};
+        }
+        return {[path](const Event& ev) { return from_json(resolve(ev, path)); }};
+    }
+
+    Node parse_ident() {
+        std::string name = ident();
+        if (name == "true") return {[](const Event&) { return ExprValue::boolean(true); }, true};
+        if (name == "false") return {[](const Event&) { return ExprValue::boolean(false); }, true};
+        if (name == "null") return {[](const Event&) { return ExprValue{}; }, true};
+        skip_ws();
+        if (pos_ >= s_.size() || s_[pos_] != '(') return field(name);
+        ++pos_;
+
+        if (name == "exists") {
+            skip_ws();
+            std::string target = ident();
+            if (target.empty()) fail("exists() takes a field name");
+            expect(')');
+            if (target == "source" || target == "key") return {[](const Event&) { return ExprValue::boolean(true); }, true};
+            return {[path = split_path(target)](const Event& ev) { return ExprValue::boolean(resolve(ev, path) != nullptr); }};
+        }
+
+        std::vector<Node> args;
+        skip_ws();
+        if (pos_ < s_.size() && s_[pos_] != ')') {
+            do { args.push_back(parse_or()); } while (eat(","));
+        }
+        expect(')');
+        bool constant = true;
+        for (auto& a : args) constant = constant && a.constant;
+
+        auto arity = [&](size_t n) {
+            if (args.size() != n) fail(name + "() takes " + std::to_string(n) + " argument(s)");
+        };
+        if (name == "abs") {
+            arity(1);
+            return fold({[a = args[0].fn](const Event& ev) {
+                ExprValue v = a(ev);
+                return v.type == ExprValue::Type::Number ? ExprValue::number(std::fabs(v.num)) : ExprValue{};
+            }, constant});
+        }
+        if (name == "min" || name == "max") {
+            arity(2);
+            const bool is_min = name == "min";
+            return fold({[a = args[0].fn, b = args[1].fn, is_min](const Event& ev) {
+                ExprValue x = a(ev), y = b(ev);
+                if (x.type != ExprValue::Type::Number || y.type != ExprValue::Type::Number) return ExprValue{};
+                return ExprValue::number(is_min ? std::fmin(x.num, y.num) : std::fmax(x.num, y.num));
+            }, constant});
+        }
+        if (name == "len") {
+            arity(1);
+            return fold({[a = args[0].fn](const Event& ev) {
+                ExprValue v = a(ev);
+                return v.type == ExprValue::Type::String ? ExprValue::number(static_cast<double>(v.str.size())) : ExprValue{};
+            }, constant});
+        }
+        if (name == "contains" || name == "starts_with") {
+            arity(2);
+            const bool prefix = name == "starts_with";
+            return fold({[a = args[0].fn, b = args[1].fn, prefix](const Event& ev) {
+                ExprValue s = a(ev), t = b(ev);
+                if (s.type != ExprValue::Type::String || t.type != ExprValue::Type::String) return ExprValue::boolean(false);
+                return ExprValue::boolean(prefix ? s.str.substr(0, t.str.size()) == t.str
+                                                 : s.str.find(t.str) != std::string_view::npos);
+            }, constant});
+        }
+        fail("unknown function " + name + "()");
+    }
+
+    const std::string& s_;
+    size_t pos_ = 0;
+};
+
+nlohmann::json to_json(const ExprValue& v) {
+    switch (v.type) {
+    case ExprValue::Type::Bool: return v.b;
+    case ExprValue::Type::Number:
+        // Keep whole numbers integral so `len(x)` or `count + 1` do not turn into 5.0.
+        if (std::fabs(v.num) < 9e15 && std::floor(v.num) == v.num) return static_cast<int64_t>(v.num);
+        return v.num;
+    case ExprValue::Type::String: return std::string(v.str);
+    default: return nullptr;
+    }
+}
+
+} // namespace
+
+Expression Expression::compile(const std::string& text) {
+    Parser p(text);
+    Fn root = p.parse();
+    return Expression(text, std::move(root));
+}
+
+ExpressionTransform::ExpressionTransform(const std::string& filter,
+                                         const std::vector<std::pair<std::string, std::string>>& set,
+                                         const std::string& when, Counter* conflicts)
+    : conflicts_(conflicts) {
+    if (!filter.empty()) filter_ = std::make_unique<Expression>(Expression::compile(filter));
+    if (!when.empty()) when_ = std::make_unique<Expression>(Expression::compile(when));
+    for (const auto& kv : set) {
+        Path path = split_path(kv.first);
+        if (path.empty()) throw std::invalid_argument("set: empty target field");
+        set_.emplace_back(std::move(path), Expression::compile(kv.second));
+    }
+}
+
+bool ExpressionTransform::operator()(Event& ev) const {
+    if (filter_ && !filter_->test(ev)) return false;
+    if (when_ && !when_->test(ev)) return true;
+    for (const auto& [path, expr] : set_) {
+        nlohmann::json value = to_json(expr.eval(ev)); // copied out before the payload changes
+        nlohmann::json* j = &ev.json();
+        for (size_t i = 0; j && i + 1 < path.size(); ++i) {
+            if (j->is_null()) *j = nlohmann::json::object();
+            j = j->is_object() ? &(*j)[path[i]] : nullptr;
+        }
+        if (j && j->is_null()) *j = nlohmann::json::object();
+        if (!j || !j->is_object()) {
+            if (conflicts_) conflicts_->inc();
+            continue;
+        }
+        (*j)[path.back()] = std::move(value);
+    }
+    return true;
+}
+
+} // namespace crossbring
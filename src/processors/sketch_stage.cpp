@@ -0,0 +1,132 @@
+#include "crossbring/processors/sketch_stage.h"
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+
+namespace crossbring {
+
+namespace {
+
+std::string quantile_label(double q) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "p%g", q * 100.0);
+    return buf;
+}
+
+std::unique_ptr<Expression> compile_optional(const std::string& text) {
+    if (text.empty()) return nullptr;
+    return std::make_unique<Expression>(Expression::compile(text));
+}
+
+} // namespace
+
+size_t SketchStage::Summary::memory_bytes() const {
+    return sizeof(Summary) + hh.memory_bytes() + hll.memory_bytes() + q.memory_bytes();
+}
+
+void SketchStage::Summary::merge(const Summary& o) {
+    events += o.events;
+    hh.merge(o.hh);
+    hll.merge(o.hll);
+    q.merge(o.q);
+}
+
+SketchStage::SketchStage(Engine& engine, Options opts)
+    : opts_(std::move(opts)),
+      overflow_(engine.metrics().counter("crossbring_sketch_overflow_total", "Events not sketched because max_sources was reached")) {
+    if (opts_.shards == 0) opts_.shards = 1;
+    hh_expr_ = compile_optional(opts_.heavy_hitters);
+    distinct_expr_ = compile_optional(opts_.distinct);
+    quantile_expr_ = compile_optional(opts_.quantile);
+    shards_.reset(new Shard[opts_.shards]);
+}
+
+void SketchStage::process(const Event& ev) {
+    // Evaluate before locking; string values are views into the event.
+    thread_local std::string hh_key, distinct_key;
+    const bool has_hh = hh_expr_ && hh_expr_->eval(ev).to_key(hh_key);
+    const bool has_distinct = distinct_expr_ && distinct_expr_->eval(ev).to_key(distinct_key);
+    double value = 0.0;
+    bool has_value = false;
+    if (quantile_expr_) {
+        ExprValue v = quantile_expr_->eval(ev);
+        has_value = v.type == ExprValue::Type::Number && std::isfinite(v.num);
+        value = v.num;
+    }
+    const uint64_t distinct_hash = has_distinct ? sketch_hash(distinct_key) : 0;
+
+    // Threads map to shards like metric cells, so each worker mostly has one to itself.
+    Shard& s = shards_[detail::metric_shard() % opts_.shards];
+    std::lock_guard<std::mutex> lock(s.mu);
+    auto it = s.sources.find(ev.source);
+    if (it == s.sources.end()) {
+        if (s.sources.size() >= opts_.max_sources) {
+            overflow_.inc();
+            return;
+        }
+        it = s.sources.emplace(ev.source, Summary(opts_)).first;
+    }
+    Summary& sum = it->second;
+    ++sum.events;
+    if (has_hh) sum.hh.add(hh_key);
+    if (has_distinct) sum.hll.add_hash(distinct_hash);
+    if (has_value) sum.q.add(value);
+}
+
+nlohmann::json SketchStage::to_json(const Summary& s, size_t held_bytes) const {
+    nlohmann::json top = nlohmann::json::array();
+    for (auto& [key, count] : s.hh.top()) top.push_back({{"key", key}, {"count", count}});
+    nlohmann::json quantiles = nlohmann::json::object();
+    if (s.q.count() > 0) {
+        for (double q : opts_.quantiles) quantiles[quantile_label(q)] = s.q.quantile(q);
+        quantiles["min"] = s.q.min();
+        quantiles["max"] = s.q.max();
+    }
+    return {
+        {"events", s.events},
+        {"top", std::move(top)},
+        {"distinct", std::llround(s.hll.estimate())},
+        {"values", s.q.count()},
+        {"quantiles", std::move(quantiles)},
+        {"memory_bytes", held_bytes},
+    };
+}
+
+nlohmann::json SketchStage::stats() const {
+    std::map<std::string, std::pair<Summary, size_t>> merged; // merged summary, bytes held over all shards
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mu);
+        for (auto& [source, sum] : shards_[i].sources) {
+            auto it = merged.find(source);
+            if (it == merged.end()) {
+                merged.emplace(source, std::make_pair(sum, sum.memory_bytes()));
+            } else {
+                it->second.first.merge(sum);
+                it->second.second += sum.memory_bytes();
+            }
+        }
+    }
+    nlohmann::json sources = nlohmann::json::object();
+    for (auto& [source, m] : merged) sources[source] = to_json(m.first, m.second);
+    return {{"shards", opts_.shards}, {"sources", std::move(sources)}};
+}
+
+nlohmann::json SketchStage::stats(const std::string& source) const {
+    std::unique_ptr<Summary> merged;
+    size_t bytes = 0;
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mu);
+        auto it = shards_[i].sources.find(source);
+        if (it == shards_[i].sources.end()) continue;
+        if (!merged) merged = std::make_unique<Summary>(it->second);
+        else merged->merge(it->second);
+        bytes += it->second.memory_bytes();
+    }
+    if (!merged) return nullptr;
+    nlohmann::json out = to_json(*merged, bytes);
+    out["source"] = source;
+    return out;
+}
+
+} // namespace crossbring
@@ -0,0 +1,581 @@
+#include "crossbring/sinks/archive_sink.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "crossbring/core/clock.h"
+#include "crossbring/sinks/envelope.h"
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace crossbring {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kBlockMagic[4] = {'C', 'B', 'A', '1'};
+constexpr size_t kAlign = 4096;
+
+// On-disk block header, followed by `stored_len` bytes of (compressed) records.
+struct BlockHeader {
+    char magic[4];
+    uint8_t codec;
+    uint8_t format;
+    uint16_t reserved;
+    uint32_t stored_len;
+    uint32_t raw_len;
+    uint32_t count;
+    uint32_t crc; // CRC-32 of the stored bytes
+    int64_t min_ts;
+    int64_t max_ts;
+};
+
+// Sidecar index entry; one per block, appended as blocks complete.
+struct IndexEntry {
+    int64_t min_ts;
+    int64_t max_ts;
+    uint64_t offset;
+    uint32_t stored_len;
+    uint32_t raw_len;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+uint32_t checksum(const char* p, size_t n) {
+#ifdef USE_ZLIB
+    return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(p), static_cast<uInt>(n)));
+#else
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xffffffffu;
+    for (size_t i = 0; i < n; ++i) c = table[(c ^ static_cast<unsigned char>(p[i])) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffu;
+#endif
+}
+
+// Write-only file with positional writes, so several threads can fill one
+// segment at disjoint offsets without sharing a file position.
+class OutFile {
+public:
+    bool open(const fs::path& p) {
+#ifdef _WIN32
+        h_ = CreateFileW(p.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        return h_ != INVALID_HANDLE_VALUE;
+#else
+        fd_ = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        return fd_ >= 0;
+#endif
+    }
+    bool write_at(const void* data, size_t n, uint64_t off) {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0) {
+#ifdef _WIN32
+            OVERLAPPED ov{};
+            ov.Offset = static_cast<DWORD>(off);
+            ov.OffsetHigh = static_cast<DWORD>(off >> 32);
+            DWORD done = 0;
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(n, 1u << 30));
+            if (!WriteFile(h_, p, chunk, &done, &ov) || done == 0) return false;
+#else
+            ssize_t done = ::pwrite(fd_, p, n, static_cast<off_t>(off));
+            if (done < 0 && errno == EINTR) continue;
+            if (done <= 0) return false;
+#endif
+            p += done;
+            n -= static_cast<size_t>(done);
+            off += static_cast<uint64_t>(done);
+        }
+        return true;
+    }
+    void close() {
+#ifdef _WIN32
+        if (h_ != INVALID_HANDLE_VALUE) CloseHandle(h_);
+        h_ = INVALID_HANDLE_VALUE;
+#else
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+    }
+    ~OutFile() { close(); }
+
+private:
+#ifdef _WIN32
+    HANDLE h_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+void put_u16(std::string& s, uint16_t v) { s.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void put_u32(std::string& s, uint32_t v) { s.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void put_i64(std::string& s, int64_t v) { s.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+} // namespace
+
+struct ArchiveSink::Block {
+    char* data = nullptr;
+    size_t cap = 0;
+    size_t len = 0;
+    uint32_t count = 0;
+    int64_t min_ts = 0, max_ts = 0;
+    std::chrono::steady_clock::time_point opened;
+};
+
+void ArchiveSink::BlockDeleter::operator()(Block* b) const {
+    ::operator delete(b->data, std::align_val_t{kAlign});
+    delete b;
+}
+
+// An open segment and its index. Writers hold a reference while their block is
+// in flight; the last one out closes the files and drops the `.open` suffix.
+struct ArchiveSink::Segment {
+    fs::path path, index_path; // final names
+    OutFile data, index;
+    uint64_t size = 0;         // bytes reserved, guarded by seg_mu_
+    uint64_t index_size = 0;   // guarded by index_mu
+    std::mutex index_mu;
+    std::chrono::steady_clock::time_point opened = std::chrono::steady_clock::now();
+
+    static fs::path open_name(const fs::path& p) { fs::path o = p; o += ".open"; return o; }
+
+    void add_index(const IndexEntry& e) {
+        std::lock_guard<std::mutex> lock(index_mu);
+        index.write_at(&e, sizeof(e), index_size);
+        index_size += sizeof(e);
+    }
+
+    ~Segment() {
+        data.close();
+        index.close();
+        if (path.empty()) return; // never opened
+        std::error_code ec;
+        fs::rename(open_name(path), path, ec);
+        if (!ec) fs::rename(open_name(index_path), index_path, ec);
+        if (ec) spdlog::warn("Archive: cannot close segment {}: {}", path.string(), ec.message());
+        else spdlog::info("Archive: closed {} ({} bytes)", path.string(), size);
+    }
+};
+
+ArchiveSink::Codec ArchiveSink::parse_codec(const std::string& s) {
+    if (s == "none") return Codec::None;
+    if (s == "deflate") return Codec::Deflate;
+    throw std::invalid_argument("unknown archive codec '" + s + "' (deflate, none)");
+}
+
+ArchiveSink::Format ArchiveSink::parse_format(const std::string& s) {
+    if (s == "ndjson") return Format::Ndjson;
+    if (s == "binary") return Format::Binary;
+    throw std::invalid_argument("unknown archive format '" + s + "' (ndjson, binary)");
+}
+
+ArchiveSink::ArchiveSink(Options opts) : opts_(std::move(opts)) {
+#ifndef USE_ZLIB
+    if (opts_.codec == Codec::Deflate) throw std::invalid_argument("deflate codec needs zlib (build with ENABLE_ZLIB)");
+#endif
+    if (opts_.shards == 0) opts_.shards = 1;
+    if (opts_.io_threads == 0) opts_.io_threads = 1;
+    opts_.block_bytes = std::max(kAlign, (opts_.block_bytes + kAlign - 1) / kAlign * kAlign);
+    std::error_code ec;
+    fs::create_directories(opts_.dir, ec);
+    if (ec) throw std::runtime_error("cannot create archive dir " + opts_.dir.string() + ": " + ec.message());
+    shards_.reset(new Shard[opts_.shards]);
+    for (size_t i = 0; i < opts_.io_threads; ++i) io_threads_.emplace_back([this]{ io_loop(); });
+    timer_ = std::thread([this]{ timer_loop(); });
+}
+
+ArchiveSink::~ArchiveSink() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mu_);
+        running_ = false;
+    }
+    timer_cv_.notify_all();
+    if (timer_.joinable()) timer_.join();
+    seal_stale(true);
+    {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        stopping_ = true;
+    }
+    q_cv_.notify_all();
+    room_cv_.notify_all();
+    for (auto& t : io_threads_) t.join();
+    std::lock_guard<std::mutex> lock(seg_mu_);
+    seg_.reset();
+}
+
+void ArchiveSink::bind_metrics(MetricsRegistry& reg) {
+    Labels labels{{"sink", name()}};
+    records_ = &reg.counter("crossbring_archive_records_total", "Events encoded into archive blocks", labels);
+    raw_bytes_ = &reg.counter("crossbring_archive_raw_bytes_total", "Archive bytes before compression", labels);
+    stored_bytes_ = &reg.counter("crossbring_archive_stored_bytes_total", "Archive bytes written to segments", labels);
+    blocks_ = &reg.counter("crossbring_archive_blocks_total", "Archive blocks written", labels);
+    segments_ = &reg.counter("crossbring_archive_segments_total", "Archive segments opened", labels);
+    errors_ = &reg.counter("crossbring_archive_write_errors_total", "Archive blocks lost to I/O errors", labels);
+    inflight_ = &reg.gauge("crossbring_archive_inflight_bytes", "Sealed archive bytes waiting for the disk", labels);
+}
+
+void ArchiveSink::bind_memory(MemoryBudget& budget) { account_ = budget.account("archive"); }
+
+ArchiveSink::BlockPtr ArchiveSink::new_block(size_t min_bytes) {
+    if (min_bytes <= opts_.block_bytes) {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        if (!free_.empty()) {
+            BlockPtr b = std::move(free_.back());
+            free_.pop_back();
+            b->opened = std::chrono::steady_clock::now();
+            return b;
+        }
+    }
+    size_t cap = std::max(opts_.block_bytes, (min_bytes + kAlign - 1) / kAlign * kAlign);
+    BlockPtr b(new Block());
+    b->data = static_cast<char*>(::operator new(cap, std::align_val_t{kAlign}));
+    b->cap = cap;
+    b->opened = std::chrono::steady_clock::now();
+    return b;
+}
+
+void ArchiveSink::consume(const Event& ev) {
+    thread_local std::string rec;
+    const int64_t ts = to_unix_ns(ev.tp);
+    rec.clear();
+    if (opts_.format == Format::Ndjson) {
+        append_envelope_json(rec, ev);
+        rec += '\n';
+    } else {
+        // [u32 len][i64 ts_ns][u16 source][u16 key][u32 payload] source key payload;
+        // the two lengths are patched in once the payload text is known.
+        const uint16_t sl = static_cast<uint16_t>(std::min<size_t>(ev.source.size(), 0xffff));
+        const uint16_t kl = static_cast<uint16_t>(std::min<size_t>(ev.key.size(), 0xffff));
+        put_u32(rec, 0);
+        put_i64(rec, ts);
+        put_u16(rec, sl);
+        put_u16(rec, kl);
+        put_u32(rec, 0);
+        rec.append(ev.source, 0, sl);
+        rec.append(ev.key, 0, kl);
+        const size_t before = rec.size();
+        ev.append_payload_text(rec);
+        const uint32_t pl = static_cast<uint32_t>(rec.size() - before);
+        const uint32_t len = static_cast<uint32_t>(rec.size() - 4);
+        std::memcpy(&rec[0], &len, 4);
+        std::memcpy(&rec[16], &pl, 4);
+    }
+
+    Shard& s = shards_[detail::metric_shard() % opts_.shards];
+    BlockPtr full;
+    {
+        std::lock_guard<std::mutex> lock(s.mu);
+        if (!s.open || s.open->len + rec.size() > s.open->cap) {
+            full = std::move(s.open);
+            s.open = new_block(rec.size());
+        }
+        Block& b = *s.open;
+        std::memcpy(b.data + b.len, rec.data(), rec.size());
+        b.len += rec.size();
+        b.min_ts = b.count == 0 ? ts : std::min(b.min_ts, ts);
+        b.max_ts = b.count == 0 ? ts : std::max(b.max_ts, ts);
+        ++b.count;
+    }
+    if (records_) records_->inc();
+    if (full) seal(std::move(full));
+}
+
+void ArchiveSink::seal(BlockPtr b) {
+    if (!b || b->len == 0) return;
+    const size_t bytes = b->len;
+    {
+        std::unique_lock<std::mutex> lock(q_mu_);
+        room_cv_.wait(lock, [&]{ return stopping_ || inflight_bytes_ < opts_.max_inflight_bytes; });
+        inflight_bytes_ += bytes;
+        ++inflight_blocks_;
+        queue_.push_back(std::move(b));
+        if (inflight_) inflight_->set(static_cast<int64_t>(inflight_bytes_));
+    }
+    if (account_) account_->charge(bytes);
+    q_cv_.notify_one();
+}
+
+void ArchiveSink::seal_stale(bool all) {
+    const auto cutoff = std::chrono::steady_clock::now() - std::chrono::milliseconds(opts_.flush_ms);
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        BlockPtr b;
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mu);
+            auto& open = shards_[i].open;
+            if (open && open->len > 0 && (all || open->opened <= cutoff)) b = std::move(open);
+        }
+        seal(std::move(b));
+    }
+}
+
+void ArchiveSink::flush() {
+    seal_stale(true);
+    std::unique_lock<std::mutex> lock(q_mu_);
+    idle_cv_.wait(lock, [this]{ return inflight_blocks_ == 0; });
+}
+
+void ArchiveSink::timer_loop() {
+    const auto tick = std::chrono::milliseconds(std::max(10, opts_.flush_ms / 2));
+    std::unique_lock<std::mutex> lock(timer_mu_);
+    while (running_) {
+        timer_cv_.wait_for(lock, tick, [this]{ return !running_.load(); });
+        if (!running_) break;
+        lock.unlock();
+        seal_stale(false);
+        {
+            // Close a segment that aged out while idle, so it does not stay `.open`.
+            std::lock_guard<std::mutex> seg_lock(seg_mu_);
+            if (seg_ && std::chrono::steady_clock::now() - seg_->opened >= std::chrono::seconds(opts_.roll_seconds))
+                seg_.reset();
+        }
+        lock.lock();
+    }
+}
+
+void ArchiveSink::io_loop() {
+    std::string scratch; // compression output, reused
+    for (;;) {
+        BlockPtr b;
+        {
+            std::unique_lock<std::mutex> lock(q_mu_);
+            q_cv_.wait(lock, [this]{ return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            b = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        write_block(*b, scratch);
+        const size_t bytes = b->len;
+        if (account_) account_->release(bytes);
+        {
+            std::lock_guard<std::mutex> lock(q_mu_);
+            if (b->cap == opts_.block_bytes && free_.size() < opts_.shards + opts_.io_threads) {
+                b->len = 0;
+                b->count = 0;
+                free_.push_back(std::move(b));
+            }
+            inflight_bytes_ -= bytes;
+            --inflight_blocks_;
+            if (inflight_) inflight_->set(static_cast<int64_t>(inflight_bytes_));
+            if (inflight_blocks_ == 0) idle_cv_.notify_all();
+        }
+        room_cv_.notify_all();
+    }
+}
+
+std::shared_ptr<ArchiveSink::Segment> ArchiveSink::segment_for(uint64_t stored, uint64_t& offset) {
+    std::lock_guard<std::mutex> lock(seg_mu_);
+    const auto now = std::chrono::steady_clock::now();
+    if (seg_ && (seg_->size >= opts_.roll_bytes || now - seg_->opened >= std::chrono::seconds(opts_.roll_seconds)))
+        seg_.reset();
+    if (!seg_) {
+        const auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        char name[96];
+        std::snprintf(name, sizeof(name), "-%013lld-%06llu.cba", static_cast<long long>(wall_ms),
+                      static_cast<unsigned long long>(next_seq_++));
+        auto seg = std::make_shared<Segment>();
+        seg->path = opts_.dir / (opts_.prefix + name);
+        seg->index_path = seg->path;
+        seg->index_path += ".idx";
+        if (!seg->data.open(Segment::open_name(seg->path)) || !seg->index.open(Segment::open_name(seg->index_path))) {
+            spdlog::warn("Archive: cannot create segment {}", seg->path.string());
+            seg->path.clear(); // nothing to rename
+            return nullptr;
+        }
+        seg_ = std::move(seg);
+        if (segments_) segments_->inc();
+    }
+    offset = seg_->size;
+    seg_->size += stored;
+    return seg_;
+}
+
+void ArchiveSink::write_block(Block& b, std::string& scratch) {
+    BlockHeader h{};
+    std::memcpy(h.magic, kBlockMagic, sizeof(kBlockMagic));
+    h.codec = static_cast<uint8_t>(opts_.codec);
+    h.format = static_cast<uint8_t>(opts_.format);
+    h.raw_len = static_cast<uint32_t>(b.len);
+    h.count = b.count;
+    h.min_ts = b.min_ts;
+    h.max_ts = b.max_ts;
+
+    // Compressed blocks go out as one write from `scratch`; uncompressed ones as
+    // header plus the aligned block buffer itself, with no copy.
+    const char* body = b.data;
+    size_t stored = b.len;
+#ifdef USE_ZLIB
+    if (opts_.codec == Codec::Deflate) {
+        uLongf bound = compressBound(static_cast<uLong>(b.len));
+        scratch.resize(sizeof(h) + bound);
+        int rc = compress2(reinterpret_cast<Bytef*>(&scratch[sizeof(h)]), &bound,
+                           reinterpret_cast<const Bytef*>(b.data), static_cast<uLong>(b.len), opts_.level);
+        if (rc != Z_OK) {
+            if (errors_) errors_->inc();
+            spdlog::warn("Archive: deflate failed ({}), block of {} record(s) lost", rc, b.count);
+            return;
+        }
+        body = &scratch[sizeof(h)];
+        stored = bound;
+    }
+#endif
+    h.stored_len = static_cast<uint32_t>(stored);
+    h.crc = checksum(body, stored);
+
+    uint64_t off = 0;
+    auto seg = segment_for(sizeof(h) + stored, off);
+    bool ok = seg != nullptr;
+    if (ok && body != b.data) {
+        std::memcpy(&scratch[0], &h, sizeof(h));
+        ok = seg->data.write_at(scratch.data(), sizeof(h) + stored, off);
+    } else if (ok) {
+        ok = seg->data.write_at(&h, sizeof(h), off) && seg->data.write_at(body, stored, off + sizeof(h));
+    }
+    if (!ok) {
+        if (errors_) errors_->inc();
+        spdlog::warn("Archive: write failed, block of {} record(s) lost", b.count);
+        return;
+    }
+    seg->add_index(IndexEntry{h.min_ts, h.max_ts, off, h.stored_len, h.raw_len, h.count, 0});
+    if (blocks_) blocks_->inc();
+    if (raw_bytes_) raw_bytes_->inc(b.len);
+    if (stored_bytes_) stored_bytes_->inc(sizeof(h) + stored);
+}
+
+// ---- ArchiveReader ----
+
+std::vector<fs::path> ArchiveReader::segments(const fs::path& dir, const std::string& prefix) {
+    std::vector<fs::path> out;
+    std::error_code ec;
+    for (auto& e : fs::directory_iterator(dir, ec)) {
+        const auto name = e.path().filename().string();
+        if (e.path().extension() != ".cba" || name.compare(0, prefix.size(), prefix) != 0) continue;
+        out.push_back(e.path());
+    }
+    // Names carry a zero-padded creation time and sequence, so name order is write order.
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+size_t ArchiveReader::for_each(int64_t from_ns, int64_t to_ns, const std::function<void(const Record&)>& fn) const {
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot read " + path_.string());
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+
+    std::vector<IndexEntry> blocks;
+    fs::path idx = path_;
+    idx += ".idx";
+    std::ifstream is(idx, std::ios::binary);
+    IndexEntry e{};
+    while (is && is.read(reinterpret_cast<char*>(&e), sizeof(e))) blocks.push_back(e);
+    if (blocks.empty()) {
+        // No index (crashed writer): walk the block headers instead.
+        BlockHeader h{};
+        for (uint64_t off = 0; off + sizeof(h) <= file_size; off += sizeof(h) + h.stored_len) {
+            in.seekg(static_cast<std::streamoff>(off));
+            if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, kBlockMagic, 4) != 0) break;
+            blocks.push_back(IndexEntry{h.min_ts, h.max_ts, off, h.stored_len, h.raw_len, h.count, 0});
+        }
+    }
+    std::sort(blocks.begin(), blocks.end(), [](auto& a, auto& b){ return a.offset < b.offset; });
+
+    size_t visited = 0;
+    std::string stored, raw;
+    for (const auto& blk : blocks) {
+        if (blk.max_ts < from_ns || blk.min_ts >= to_ns) continue;
+        BlockHeader h{};
+        if (blk.offset + sizeof(h) + blk.stored_len > file_size) throw std::runtime_error(path_.string() + ": truncated block");
+        in.seekg(static_cast<std::streamoff>(blk.offset));
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (std::memcmp(h.magic, kBlockMagic, 4) != 0 || h.stored_len != blk.stored_len)
+            throw std::runtime_error(path_.string() + ": bad block header");
+        stored.resize(h.stored_len);
+        in.read(&stored[0], static_cast<std::streamsize>(stored.size()));
+        if (!in || checksum(stored.data(), stored.size()) != h.crc) throw std::runtime_error(path_.string() + ": block checksum mismatch");
+
+        const std::string* body = &stored;
+        if (h.codec == static_cast<uint8_t>(ArchiveSink::Codec::Deflate)) {
+#ifdef USE_ZLIB
+            raw.resize(h.raw_len);
+            uLongf len = h.raw_len;
+            if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &len, reinterpret_cast<const Bytef*>(stored.data()),
+                           static_cast<uLong>(stored.size())) != Z_OK || len != h.raw_len)
+                throw std::runtime_error(path_.string() + ": cannot inflate block");
+            body = &raw;
+#else
+            throw std::runtime_error(path_.string() + ": deflate block needs zlib");
+#endif
+        }
+
+        const char* p = body->data();
+        const char* end = p + body->size();
+        if (h.format == static_cast<uint8_t>(ArchiveSink::Format::Binary)) {
+            while (end - p >= 4) {
+                uint32_t len;
+                std::memcpy(&len, p, 4);
+                if (len < 16 || static_cast<size_t>(end - p - 4) < len) throw std::runtime_error(path_.string() + ": bad record");
+                Record r{};
+                uint16_t sl, kl;
+                uint32_t pl;
+                std::memcpy(&r.ts_ns, p + 4, 8);
+                std::memcpy(&sl, p + 12, 2);
+                std::memcpy(&kl, p + 14, 2);
+                std::memcpy(&pl, p + 16, 4);
+                const char* s = p + 20;
+                if (16u + sl + kl + pl != len) throw std::runtime_error(path_.string() + ": bad record");
+                r.source = {s, sl};
+                r.key = {s + sl, kl};
+                r.payload = {s + sl + kl, pl};
+                if (r.ts_ns >= from_ns && r.ts_ns < to_ns) { fn(r); ++visited; }
+                p += 4 + len;
+            }
+        } else {
+            while (p < end) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+                if (!nl) nl = end;
+                auto j = nlohmann::json::parse(p, nl);
+                const int64_t ts = j.value("ts_ns", int64_t{0});
+                if (ts >= from_ns && ts < to_ns) {
+                    const std::string source = j.value("source", std::string());
+                    const std::string key = j.value("key", std::string());
+                    const std::string payload = j["payload"].dump();
+                    fn(Record{ts, source, key, payload});
+                    ++visited;
+                }
+                p = nl + 1;
+            }
+        }
+    }
+    return visited;
+}
+
+} // namespace crossbring
@@ -0,0 +1,153 @@
+#include "crossbring/sinks/batching_sink.h"
+
+#include <algorithm>
+
+namespace crossbring {
+
+BatchingSink::BatchingSink(std::shared_ptr<Sink> inner, Options opts) : inner_(std::move(inner)), opts_(opts) {
+    if (opts_.batch_size == 0) opts_.batch_size = 1;
+    if (opts_.shards == 0) opts_.shards = 1;
+    shards_.reset(new Shard[opts_.shards]);
+    th_ = std::thread([this]{ loop(); });
+}
+
+BatchingSink::~BatchingSink() {
+    {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        running_ = false;
+    }
+    q_cv_.notify_all();
+    room_cv_.notify_all();
+    if (th_.joinable()) th_.join();
+    // Whatever is still buffered goes out on this thread.
+    seal_stale(true);
+    for (auto& b : queue_) deliver(b);
+    queue_.clear();
+}
+
+void BatchingSink::bind_metrics(MetricsRegistry& reg) {
+    Labels labels{{"sink", inner_->name()}};
+    pending_ = &reg.gauge("crossbring_batch_pending_events", "Events buffered for the next batch", labels);
+    inflight_ = &reg.gauge("crossbring_batch_inflight", "Batches being written to the inner sink", labels);
+    batch_events_ = &reg.histogram("crossbring_batch_size_events", "Events per batch handed to the inner sink", labels,
+                                   {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 4096});
+    flush_seconds_ = &reg.histogram("crossbring_batch_flush_seconds", "Time the inner sink took to write one batch",
+                                    labels);
+    latency_seconds_ = &reg.histogram("crossbring_batch_latency_seconds",
+                                      "Oldest event's wait from buffering until its batch was written", labels);
+    inner_->bind_metrics(reg);
+}
+
+void BatchingSink::bind_memory(MemoryBudget& budget) {
+    account_ = budget.account("batch:" + inner_->name());
+    inner_->bind_memory(budget);
+}
+
+void BatchingSink::consume_shared(const EventPtr& ev) {
+    const size_t bytes = (account_ || opts_.max_bytes || opts_.max_batch_bytes) ? approx_bytes(*ev) : 0;
+    if (opts_.max_bytes && held_bytes_.load(std::memory_order_relaxed) >= opts_.max_bytes) {
+        std::unique_lock<std::mutex> lock(q_mu_);
+        pressure_ = true;
+        q_cv_.notify_all();
+        room_cv_.wait(lock, [this]{ return held_bytes_.load() < opts_.max_bytes || !running_; });
+    }
+    if (bytes) {
+        held_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        if (account_) account_->charge(bytes);
+    }
+
+    std::vector<Batch> sealed;
+    Shard& s = shards_[detail::metric_shard() % opts_.shards];
+    {
+        std::lock_guard<std::mutex> lock(s.mu);
+        if (s.open.events.empty()) s.open.first = std::chrono::steady_clock::now();
+        s.open.events.push_back(ev);
+        s.open.bytes += bytes;
+        if (s.open.events.size() >= opts_.batch_size || (opts_.max_batch_bytes && s.open.bytes >= opts_.max_batch_bytes))
+            seal_locked(s, sealed);
+    }
+    if (!sealed.empty()) enqueue(sealed);
+}
+
+// Swaps the shard's batch for an empty (recycled) buffer. Caller holds s.mu.
+void BatchingSink::seal_locked(Shard& s, std::vector<Batch>& out) {
+    std::vector<EventPtr> fresh;
+    {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        if (!spare_.empty()) {
+            fresh = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+    if (fresh.capacity() == 0) fresh.reserve(opts_.batch_size);
+    out.push_back(std::move(s.open));
+    s.open = Batch{};
+    s.open.events = std::move(fresh);
+}
+
+void BatchingSink::seal_stale(bool all) {
+    const auto cutoff = std::chrono::steady_clock::now() - std::chrono::milliseconds(opts_.flush_ms);
+    std::vector<Batch> sealed;
+    size_t pending = 0;
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        Shard& s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mu);
+        if (!s.open.events.empty() && (all || s.open.first <= cutoff)) seal_locked(s, sealed);
+        pending += s.open.events.size();
+    }
+    if (pending_) pending_->set(static_cast<int64_t>(pending));
+    if (!sealed.empty()) enqueue(sealed);
+}
+
+void BatchingSink::enqueue(std::vector<Batch>& sealed) {
+    {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        for (auto& b : sealed) queue_.push_back(std::move(b));
+    }
+    q_cv_.notify_one();
+}
+
+void BatchingSink::deliver(Batch& b) {
+    const auto start = std::chrono::steady_clock::now();
+    if (inflight_) inflight_->add();
+    inner_->consume_batch(b.events);
+    if (inflight_) inflight_->sub();
+    const auto done = std::chrono::steady_clock::now();
+    if (batch_events_) batch_events_->observe(static_cast<double>(b.events.size()));
+    if (flush_seconds_) flush_seconds_->observe(std::chrono::duration<double>(done - start).count());
+    if (latency_seconds_) latency_seconds_->observe(std::chrono::duration<double>(done - b.first).count());
+    b.events.clear(); // events are released here, off the worker threads
+    if (b.bytes) {
+        held_bytes_.fetch_sub(b.bytes, std::memory_order_relaxed);
+        if (account_) account_->release(b.bytes);
+    }
+}
+
+void BatchingSink::loop() {
+    const auto tick = std::chrono::milliseconds(std::max(1, opts_.flush_ms / 2));
+    auto next_sweep = std::chrono::steady_clock::now() + tick;
+    std::unique_lock<std::mutex> lock(q_mu_);
+    while (running_) {
+        q_cv_.wait_until(lock, next_sweep, [this]{ return !running_ || !queue_.empty() || pressure_; });
+        if (!running_) break;
+        if (pressure_ || std::chrono::steady_clock::now() >= next_sweep) {
+            const bool all = pressure_;
+            pressure_ = false;
+            lock.unlock();
+            seal_stale(all);
+            lock.lock();
+            next_sweep = std::chrono::steady_clock::now() + tick;
+        }
+        while (!queue_.empty()) {
+            Batch b = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            deliver(b);
+            lock.lock();
+            if (spare_.size() < opts_.shards) spare_.push_back(std::move(b.events));
+            room_cv_.notify_all();
+        }
+    }
+}
+
+} // namespace crossbring
@@ -0,0 +1,433 @@
+#include "crossbring/sinks/columnar_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#include "crossbring/core/clock.h"
+#include "crossbring/storage/sketches.h"
+
+namespace crossbring {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum Kind : uint8_t { kNull = 0, kInt = 1, kReal = 2, kBool = 4, kText = 8 };
+
+// One flattened payload value. Strings live in the field's `texts`.
+struct Val {
+    uint8_t kind = kNull;
+    union {
+        int64_t i;
+        double d;
+        uint32_t s;
+    };
+    Val() : i(0) {}
+};
+
+std::string number_text(double d) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", d);
+    return buf;
+}
+
+bool parse_int(const std::string& s, int64_t& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long long v = std::strtoll(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+    out = v;
+    return true;
+}
+
+bool parse_real(const std::string& s, double& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return *end == '\0';
+}
+
+} // namespace
+
+struct ColumnarSink::Batch {
+    struct Field {
+        std::string name;
+        std::vector<Val> vals;
+        std::vector<std::string> texts;
+        uint8_t kinds = 0;
+    };
+
+    std::string source;
+    std::vector<int64_t> ts;
+    std::vector<uint32_t> key_codes;
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, uint32_t> key_index;
+    std::vector<Field> fields;
+    std::unordered_map<std::string, size_t> field_index;
+    size_t bytes = 0; // charged to the memory account
+    std::chrono::steady_clock::time_point opened = std::chrono::steady_clock::now();
+};
+
+ColumnarSink::ColumnarSink(Options opts) : opts_(std::move(opts)) {
+    if (opts_.shards == 0) opts_.shards = 1;
+    if (opts_.batch_rows == 0) opts_.batch_rows = 1;
+    if (opts_.max_pending == 0) opts_.max_pending = 1;
+    std::error_code ec;
+    fs::create_directories(opts_.dir, ec);
+    if (ec) throw std::runtime_error("cannot create columnar dir " + opts_.dir.string() + ": " + ec.message());
+    shards_.reset(new Shard[opts_.shards]);
+    writer_ = std::thread([this]{ writer_loop(); });
+    timer_ = std::thread([this]{ timer_loop(); });
+}
+
+ColumnarSink::~ColumnarSink() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mu_);
+        running_ = false;
+    }
+    timer_cv_.notify_all();
+    if (timer_.joinable()) timer_.join();
+    seal_stale(true);
+    {
+        std::lock_guard<std::mutex> lock(q_mu_);
+        stopping_ = true;
+    }
+    q_cv_.notify_all();
+    room_cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+}
+
+void ColumnarSink::bind_metrics(MetricsRegistry& reg) {
+    Labels labels{{"sink", name()}};
+    rows_ = &reg.counter("crossbring_columnar_rows_total", "Events buffered into column batches", labels);
+    segments_ = &reg.counter("crossbring_columnar_segments_total", "Columnar segments written", labels);
+    bytes_ = &reg.counter("crossbring_columnar_bytes_total", "Columnar segment bytes written", labels);
+    dropped_fields_ = &reg.counter("crossbring_columnar_dropped_fields_total",
+                                   "Payload values dropped because a batch hit max_fields", labels);
+    errors_ = &reg.counter("crossbring_columnar_write_errors_total", "Columnar batches lost to I/O errors", labels);
+}
+
+void ColumnarSink::bind_memory(MemoryBudget& budget) { account_ = budget.account("columnar"); }
+
+const std::map<std::string, ColumnType>* ColumnarSink::schema_for(const std::string& source) const {
+    auto it = opts_.schemas.find(source);
+    if (it == opts_.schemas.end()) it = opts_.schemas.find("*");
+    return it == opts_.schemas.end() ? nullptr : &it->second;
+}
+
+void ColumnarSink::consume(const Event& ev) {
+    Shard& s = shards_[sketch_hash(ev.source) % opts_.shards];
+    BatchPtr full;
+    {
+        std::lock_guard<std::mutex> lock(s.mu);
+        BatchPtr& b = s.open[ev.source];
+        if (!b) {
+            b.reset(new Batch());
+            b->source = ev.source;
+        }
+        append(*b, ev);
+        if (b->ts.size() >= opts_.batch_rows) full = std::move(b);
+    }
+    if (rows_) rows_->inc();
+    if (full) seal(std::move(full));
+}
+
+void ColumnarSink::append(Batch& b, const Event& ev) {
+    const size_t row = b.ts.size();
+    const size_t before = b.bytes;
+    b.ts.push_back(to_unix_ns(ev.tp));
+    auto k = b.key_index.find(ev.key);
+    if (k == b.key_index.end()) {
+        k = b.key_index.emplace(ev.key, static_cast<uint32_t>(b.keys.size())).first;
+        b.keys.push_back(ev.key);
+        b.bytes += ev.key.size() * 2;
+    }
+    b.key_codes.push_back(k->second);
+    b.bytes += sizeof(int64_t) + sizeof(uint32_t);
+
+    size_t dropped = 0;
+    std::string path;
+    auto field = [&](const std::string& name) -> Batch::Field* {
+        auto it = b.field_index.find(name);
+        if (it != b.field_index.end()) return &b.fields[it->second];
+        if (b.fields.size() >= opts_.max_fields) {
+            ++dropped;
+            return nullptr;
+        }
+        b.field_index.emplace(name, b.fields.size());
+        b.fields.emplace_back();
+        Batch::Field& f = b.fields.back();
+        f.name = name;
+        f.vals.resize(row); // earlier rows did not have it
+        b.bytes += row * sizeof(Val);
+        return &f;
+    };
+    auto put = [&](const nlohmann::json& j) {
+        // ts_ns and key are taken; payload fields of the same name move aside.
+        Batch::Field* f = path == "ts_ns" || path == "key" ? field("payload." + path) : field(path);
+        if (!f || f->vals.size() > row) return; // dropped, or a duplicate path
+        Val v;
+        switch (j.type()) {
+        case nlohmann::json::value_t::number_integer:
+            v.kind = kInt;
+            v.i = j.get<int64_t>();
+            break;
+        case nlohmann::json::value_t::number_unsigned: {
+            const uint64_t u = j.get<uint64_t>();
+            if (u <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                v.kind = kInt;
+                v.i = static_cast<int64_t>(u);
+            } else {
+                v.kind = kReal;
+                v.d = static_cast<double>(u);
+            }
+            break;
+        }
+        case nlohmann::json::value_t::number_float:
+            v.kind = kReal;
+            v.d = j.get<double>();
+            break;
+        case nlohmann::json::value_t::boolean:
+            v.kind = kBool;
+            v.i = j.get<bool>() ? 1 : 0;
+            break;
+        case nlohmann::json::value_t::null:
+            break;
+        default:
+            v.kind = kText;
+            v.s = static_cast<uint32_t>(f->texts.size());
+            f->texts.push_back(j.is_string() ? j.get_ref<const std::string&>() : j.dump());
+            b.bytes += f->texts.back().size() + sizeof(std::string);
+            break;
+        }
+        f->kinds |= v.kind;
+        f->vals.push_back(v);
+        b.bytes += sizeof(Val);
+    };
+    auto flatten = [&](const nlohmann::json& obj, int depth, auto& self) -> void {
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            const size_t len = path.size();
+            if (len) path += '.';
+            path += it.key();
+            if (it->is_object() && depth + 1 < opts_.max_depth && !it->empty()) self(*it, depth + 1, self);
+            else put(*it);
+            path.resize(len);
+        }
+    };
+    const nlohmann::json& payload = ev.json();
+    if (payload.is_object()) {
+        flatten(payload, 0, flatten);
+    } else if (!payload.is_null()) {
+        path = "value";
+        put(payload);
+    }
+    for (auto& f : b.fields) {
+        if (f.vals.size() > row) continue;
+        f.vals.emplace_back(); // absent in this event
+        b.bytes += sizeof(Val);
+    }
+    if (dropped && dropped_fields_) dropped_fields_->inc(dropped);
+    if (account_) account_->charge(b.bytes - before);
+}
+
+void ColumnarSink::seal(BatchPtr b) {
+    if (!b || b->ts.empty()) return;
+    {
+        std::unique_lock<std::mutex> lock(q_mu_);
+        room_cv_.wait(lock, [&]{ return stopping_ || queue_.size() < opts_.max_pending; });
+        ++inflight_;
+        queue_.push_back(std::move(b));
+    }
+    q_cv_.notify_one();
+}
+
+void ColumnarSink::seal_stale(bool all) {
+    const auto cutoff = std::chrono::steady_clock::now() - std::chrono::milliseconds(opts_.flush_ms);
+    for (size_t i = 0; i < opts_.shards; ++i) {
+        std::vector<BatchPtr> sealed;
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mu);
+            auto& open = shards_[i].open;
+            for (auto it = open.begin(); it != open.end();) {
+                if (all || it->second->opened <= cutoff) {
+                    sealed.push_back(std::move(it->second));
+                    it = open.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& b : sealed) seal(std::move(b));
+    }
+}
+
+void ColumnarSink::flush() {
+    seal_stale(true);
+    std::unique_lock<std::mutex> lock(q_mu_);
+    idle_cv_.wait(lock, [this]{ return inflight_ == 0; });
+}
+
+void ColumnarSink::timer_loop() {
+    const auto tick = std::chrono::milliseconds(std::max(10, opts_.flush_ms / 2));
+    std::unique_lock<std::mutex> lock(timer_mu_);
+    while (running_) {
+        timer_cv_.wait_for(lock, tick, [this]{ return !running_.load(); });
+        if (!running_) break;
+        lock.unlock();
+        seal_stale(false);
+        lock.lock();
+    }
+}
+
+void ColumnarSink::writer_loop() {
+    for (;;) {
+        BatchPtr b;
+        {
+            std::unique_lock<std::mutex> lock(q_mu_);
+            q_cv_.wait(lock, [this]{ return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            b = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        room_cv_.notify_all();
+        write_batch(*b);
+        if (account_) account_->release(b->bytes);
+        b.reset();
+        std::lock_guard<std::mutex> lock(q_mu_);
+        if (--inflight_ == 0) idle_cv_.notify_all();
+    }
+}
+
+void ColumnarSink::write_batch(Batch& b) {
+    const size_t rows = b.ts.size();
+    std::vector<ColumnBuffer> cols;
+    cols.reserve(b.fields.size() + 2);
+
+    cols.emplace_back();
+    cols.back().name = "ts_ns";
+    cols.back().type = ColumnType::Int64;
+    cols.back().i64 = std::move(b.ts);
+
+    cols.emplace_back();
+    cols.back().name = "key";
+    cols.back().type = ColumnType::Dict;
+    cols.back().codes = std::move(b.key_codes);
+    cols.back().strings = std::move(b.keys);
+
+    const auto* schema = schema_for(b.source);
+    for (auto& f : b.fields) {
+        if (f.kinds == kNull) continue; // nothing to store
+        ColumnType type;
+        if (schema && schema->count(f.name)) type = schema->at(f.name);
+        else if (f.kinds == kInt) type = ColumnType::Int64;
+        else if ((f.kinds & ~(kInt | kReal)) == 0) type = ColumnType::Float64;
+        else if (f.kinds == kBool) type = ColumnType::Bool;
+        else if (f.kinds == kText) {
+            std::unordered_set<std::string_view> distinct(f.texts.begin(), f.texts.end());
+            type = distinct.size() * 2 <= f.texts.size() ? ColumnType::Dict : ColumnType::String;
+        } else {
+            type = ColumnType::String;
+        }
+
+        ColumnBuffer c;
+        c.name = f.name;
+        c.type = type;
+        c.valid.assign(rows, 1);
+        std::unordered_map<std::string_view, uint32_t> dict;
+        std::deque<std::string> dict_strs; // stable storage for the views in `dict`
+        std::string scratch;
+        for (size_t r = 0; r < rows; ++r) {
+            const Val& v = f.vals[r];
+            bool ok = v.kind != kNull;
+            const std::string* text = v.kind == kText ? &f.texts[v.s] : nullptr;
+            switch (type) {
+            case ColumnType::Int64: {
+                int64_t x = 0;
+                if (v.kind == kInt || v.kind == kBool) x = v.i;
+                else if (v.kind == kReal) {
+                    ok = std::trunc(v.d) == v.d && std::fabs(v.d) < 9.2e18; // integral and in range
+                    if (ok) x = static_cast<int64_t>(v.d);
+                } else if (text) ok = parse_int(*text, x);
+                c.i64.push_back(ok ? x : 0);
+                break;
+            }
+            case ColumnType::Float64: {
+                double x = 0;
+                if (v.kind == kInt || v.kind == kBool) x = static_cast<double>(v.i);
+                else if (v.kind == kReal) x = v.d;
+                else if (text) ok = parse_real(*text, x);
+                c.f64.push_back(ok ? x : 0.0);
+                break;
+            }
+            case ColumnType::Bool: {
+                bool x = false;
+                if (v.kind == kInt || v.kind == kBool) x = v.i != 0;
+                else if (v.kind == kReal) x = v.d != 0.0;
+                else if (text) {
+                    x = *text == "true";
+                    ok = x || *text == "false";
+                }
+                c.b.push_back(ok && x ? 1 : 0);
+                break;
+            }
+            case ColumnType::String:
+            case ColumnType::Dict: {
+                std::string_view s;
+                if (text) s = *text;
+                else if (v.kind == kInt) s = scratch = std::to_string(v.i);
+                else if (v.kind == kReal) s = scratch = number_text(v.d);
+                else if (v.kind == kBool) s = v.i ? "true" : "false";
+                if (type == ColumnType::String) {
+                    c.strings.emplace_back(ok ? s : std::string_view{});
+                } else if (ok) {
+                    auto it = dict.find(s);
+                    if (it == dict.end()) {
+                        dict_strs.emplace_back(s); // scratch is reused
+                        it = dict.emplace(dict_strs.back(), static_cast<uint32_t>(dict_strs.size() - 1)).first;
+                    }
+                    c.codes.push_back(it->second);
+                } else {
+                    c.codes.push_back(0);
+                }
+                break;
+            }
+            }
+            if (!ok) c.valid[r] = 0;
+        }
+        if (type == ColumnType::Dict) {
+            c.strings.assign(std::make_move_iterator(dict_strs.begin()), std::make_move_iterator(dict_strs.end()));
+            if (c.strings.empty()) c.strings.emplace_back(); // code 0 for nulls
+        }
+        if (std::all_of(c.valid.begin(), c.valid.end(), [](uint8_t x) { return x != 0; })) c.valid.clear();
+        cols.push_back(std::move(c));
+    }
+
+    const fs::path dir = opts_.dir / segment_dir_name(b.source);
+    const long long wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    char name[48];
+    std::snprintf(name, sizeof(name), "%013lld-%06llu.cbc", wall_ms, static_cast<unsigned long long>(next_seq_++));
+    try {
+        fs::create_directories(dir);
+        write_columnar_segment(dir / name, b.source, cols, rows);
+        if (segments_) segments_->inc();
+        if (bytes_) bytes_->inc(fs::file_size(dir / name));
+        spdlog::debug("Columnar: wrote {} ({} rows, {} columns)", (dir / name).string(), rows, cols.size());
+    } catch (const std::exception& e) {
+        if (errors_) errors_->inc();
+        spdlog::error("Columnar: cannot write batch for '{}': {}", b.source, e.what());
+    }
+}
+
+} // namespace crossbring
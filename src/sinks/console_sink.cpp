@@ -8,14 +8,15 @@ class ConsoleSink : public Sink {
 public:
     void consume(const Event& ev) override {
         try {
-            auto title = ev.payload.contains("title") ? ev.payload["title"].get<std::string>() : std::string{};
-            auto value = ev.payload.contains("value") ? ev.payload["value"].dump() : std::string{};
+            const auto& payload = ev.json();
+            auto title = payload.contains("title") ? payload["title"].get<std::string>() : std::string{};
+            auto value = payload.contains("value") ? payload["value"].dump() : std::string{};
             if (!title.empty()) {
                 spdlog::info("[{}] key={} title={}", ev.source, ev.key, title);
             } else if (!value.empty()) {
                 spdlog::debug("[{}] key={} value={}", ev.source, ev.key, value);
             } else {
-                spdlog::debug("[{}] key={} payload-size={}B", ev.source, ev.key, ev.payload.dump().size());
+                spdlog::debug("[{}] key={} payload-size={}B", ev.source, ev.key, payload.dump().size());
             }
         } catch (...) {}
     }
@@ -1,6 +1,26 @@
 #include "crossbring/sinks/recent_buffer_sink.h"
 
+#include <vector>
+
 namespace crossbring {
-// Header-only; no extra implementation required
+
+void RecentBuffer::checkpoint(SnapshotWriter& out) const {
+    std::vector<std::shared_ptr<const nlohmann::json>> items;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        items.reserve(buf_.size());
+        for (auto& e : buf_) items.push_back(e.item);
+    }
+    out.u64(items.size());
+    for (auto& item : items) out.str(item->dump());
+}
+
+void RecentBuffer::restore(SnapshotReader& in) {
+    const uint64_t n = in.u64();
+    for (uint64_t i = 0; i < n; ++i) {
+        auto text = in.str();
+        push(nlohmann::json::parse(text.begin(), text.end()));
+    }
 }
 
+} // namespace crossbring
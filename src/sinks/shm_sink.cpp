@@ -0,0 +1,48 @@
+#include "crossbring/sinks/shm_sink.h"
+
+#ifdef __linux__
+
+#include "crossbring/sinks/envelope.h"
+
+namespace crossbring {
+
+ShmRingSink::ShmRingSink(Options opts)
+    : ring_(std::make_shared<ShmRingWriter>(opts.name, ShmRingWriter::Options{opts.capacity, opts.max_readers})) {}
+
+void ShmRingSink::consume(const Event& ev) {
+    thread_local std::string buf;
+    buf.clear();
+    append_envelope_json(buf, ev);
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        ok = ring_->write(buf);
+    }
+    if (ok) {
+        if (records_) records_->inc();
+        if (bytes_) bytes_->inc(buf.size());
+    } else if (dropped_) {
+        dropped_->inc();
+    }
+}
+
+void ShmRingSink::bind_metrics(MetricsRegistry& reg) {
+    Labels labels{{"ring", ring_->name()}};
+    records_ = &reg.counter("crossbring_shm_records_total", "Events published to the shared-memory ring", labels);
+    bytes_ = &reg.counter("crossbring_shm_bytes_total", "Envelope bytes published to the shared-memory ring", labels);
+    dropped_ = &reg.counter("crossbring_shm_dropped_total",
+                            "Events dropped because the slowest ring reader left no room", labels);
+    std::weak_ptr<ShmRingWriter> weak = ring_;
+    reg.gauge_fn("crossbring_shm_readers", "Readers attached to the shared-memory ring", labels, [weak] {
+        auto r = weak.lock();
+        return r ? static_cast<double>(r->readers()) : 0.0;
+    });
+    reg.gauge_fn("crossbring_shm_max_lag_bytes", "Bytes the slowest ring reader has yet to read", labels, [weak] {
+        auto r = weak.lock();
+        return r ? static_cast<double>(r->max_lag()) : 0.0;
+    });
+}
+
+} // namespace crossbring
+
+#endif // __linux__
@@ -23,7 +23,7 @@ public:
         if (ctx_) zmq_ctx_term(ctx_);
     }
     void consume(const Event& ev) override {
-        std::string data = ev.payload.dump();
+        std::string data = ev.payload_text();
         int rc = zmq_send(sock_, data.data(), data.size(), ZMQ_DONTWAIT);
         if (rc < 0) {
             spdlog::debug("ZMQ send failed: {}", zmq_strerror(zmq_errno()));
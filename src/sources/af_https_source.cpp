@@ -1,5 +1,12 @@
 #ifdef USE_CPR
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
 #include <cpr/cpr.h>
 #include <spdlog/spdlog.h>
 
@@ -7,33 +14,194 @@
 
 namespace crossbring {
 
-AfHttpsSource::AfHttpsSource(Engine& engine, std::string source_name, std::string query_payload, int interval_ms)
-    : engine_(engine), source_(std::move(source_name)), payload_(std::move(query_payload)), interval_ms_(interval_ms) {}
-
-void AfHttpsSource::start() { if (running_.exchange(true)) return; th_ = std::thread([this]{ run(); }); }
-void AfHttpsSource::stop() { if (!running_.exchange(false)) return; if (th_.joinable()) th_.join(); }
-
-void AfHttpsSource::run() {
-    const std::string url = "https://platsbanken-api.arbetsformedlingen.se/jobs/v1/search";
-    while (running_) {
-        try {
-            auto r = cpr::Post(cpr::Url{url}, cpr::Header{{"Content-Type","application/json"}}, cpr::Body{payload_});
-            if (r.status_code == 200) {
-                auto j = nlohmann::json::parse(r.text);
-                if (j.contains("ads") && j["ads"].is_array()) {
-                    for (auto& item : j["ads"]) {
-                        Event ev; ev.tp = std::chrono::steady_clock::now(); ev.source = source_; ev.key = item.value("id", ""); ev.payload = item; engine_.submit(std::move(ev));
-                    }
-                    spdlog::info("AF HTTPS emitted {} ad(s)", j["ads"].size());
+AfHttpsSource::AfHttpsSource(Engine& engine, SourceRuntime& runtime, std::string source_name, Options opts)
+    : engine_(engine), runtime_(runtime), source_(std::move(source_name)), opts_(std::move(opts)),
+      requests_(engine.metrics().counter("crossbring_af_requests_total", "AF search requests", {{"source", source_}})),
+      errors_(engine.metrics().counter("crossbring_af_errors_total", "Failed AF search requests", {{"source", source_}})),
+      ads_(engine.metrics().counter("crossbring_af_ads_total", "AF ads emitted as events", {{"source", source_}})),
+      skipped_(engine.metrics().counter("crossbring_af_skipped_total", "AF ads skipped as already emitted", {{"source", source_}})),
+      truncated_(engine.metrics().counter("crossbring_af_truncated_total",
+                                          "Polls that stopped at max_pages with more results left", {{"source", source_}})),
+      request_seconds_(engine.metrics().histogram("crossbring_af_request_seconds", "AF search request latency",
+                                                  {{"source", source_}})) {
+    payload_ = nlohmann::json::parse(opts_.payload);
+    if (!payload_.is_object()) throw std::runtime_error("AF HTTPS payload must be a JSON object");
+    if (opts_.page_size <= 0) opts_.page_size = payload_.value("maxRecords", 25);
+    opts_.max_pages = std::max(opts_.max_pages, 1);
+    for (int i = 0; i < opts_.max_pages; ++i) {
+        auto s = std::make_unique<cpr::Session>();
+        s->SetUrl(cpr::Url{opts_.url});
+        s->SetHeader(cpr::Header{{"Content-Type", "application/json"}});
+        s->SetAcceptEncoding(cpr::AcceptEncoding{"gzip", "deflate"});
+        s->SetTimeout(cpr::Timeout{opts_.timeout_ms});
+        sessions_.push_back(std::move(s));
+        parsers_.push_back(make_record_parser(opts_.parser));
+        parsers_.back()->capture(opts_.cursor_field);
+    }
+}
+
+AfHttpsSource::~AfHttpsSource() { stop(); }
+
+void AfHttpsSource::start() {
+    if (timer_) return;
+    timer_ = runtime_.every(std::chrono::milliseconds(opts_.interval_ms), [this]{ poll(); }, true,
+                            std::chrono::steady_clock::now());
+}
+
+void AfHttpsSource::stop() {
+    if (!timer_) return;
+    runtime_.cancel(timer_);
+    timer_ = 0;
+}
+
+// Fetches result page `index` with the session and parser of page slot `slot`
+// and emits its new records. Runs concurrently with the other pages of the poll.
+AfHttpsSource::Page AfHttpsSource::fetch(size_t slot, size_t index, const std::string& cursor) {
+    Page page;
+    nlohmann::json body = payload_;
+    body["startIndex"] = index * static_cast<size_t>(opts_.page_size);
+    body["maxRecords"] = opts_.page_size;
+    if (!cursor.empty()) body["fromDate"] = cursor;
+
+    auto& session = *sessions_[slot];
+    session.SetBody(cpr::Body{body.dump()});
+    requests_.inc();
+    auto r = session.Post();
+    request_seconds_.observe(r.elapsed);
+    if (r.status_code != 200) {
+        errors_.inc();
+        if (r.status_code == 0) spdlog::warn("AF HTTPS page {} error: {}", index, r.error.message);
+        else spdlog::warn("AF HTTPS page {} status {}", index, r.status_code);
+        return page;
+    }
+    try {
+        const auto now = std::chrono::steady_clock::now();
+        page.records = parsers_[slot]->for_each(r.text, [&](const JsonRecord& rec) {
+            if (!rec.field.empty()) {
+                // fromDate is inclusive: the ads at the cursor itself were emitted last time.
+                if (!cursor.empty() && (rec.field < cursor || (rec.field == cursor && at_cursor_.count(std::string(rec.key))))) {
+                    skipped_.inc();
+                    return;
                 }
-            } else {
-                spdlog::warn("AF HTTPS status {}", r.status_code);
+                if (rec.field > page.newest) {
+                    page.newest = std::string(rec.field);
+                    page.at_newest.clear();
+                }
+                if (rec.field == page.newest) page.at_newest.emplace_back(rec.key);
+            }
+            Event ev;
+            ev.tp = now;
+            ev.source = source_;
+            ev.key = std::string(rec.key);
+            ev.raw = std::string(rec.text);
+            engine_.submit(std::move(ev));
+            ++page.emitted;
+        });
+        page.ok = true;
+    } catch (const std::exception& e) {
+        errors_.inc();
+        spdlog::warn("AF HTTPS page {} unparsable: {}", index, e.what());
+    }
+    ads_.inc(page.emitted);
+    return page;
+}
+
+void AfHttpsSource::poll() {
+    const size_t max_pages = sessions_.size();
+    const size_t first = next_page_;
+    const auto full = [this](const Page& p) { return p.ok && p.records >= static_cast<size_t>(opts_.page_size); };
+    std::vector<Page> pages;
+    pages.push_back(fetch(0, first, cursor_));
+    // Only a full first page means there is more; then fetch the rest together.
+    // This thread and up to max_pages - 2 tasks on the runtime's blocking pool
+    // claim pages from one counter. The poll waits only for pages that were
+    // claimed, so it finishes even when no pool thread is free; a task that
+    // starts after the poll finds nothing left and never touches the source.
+    if (full(pages[0]) && max_pages > 1) {
+        struct Rest {
+            std::atomic<size_t> next{1};
+            std::mutex mu;
+            std::condition_variable cv;
+            size_t done = 1;
+            std::vector<Page> pages;
+        };
+        auto rest = std::make_shared<Rest>();
+        rest->pages.resize(max_pages);
+        const std::string cursor = cursor_;
+        auto work = [this, rest, max_pages, first, cursor] {
+            for (size_t i; (i = rest->next.fetch_add(1)) < max_pages;) {
+                Page p = fetch(i, first + i, cursor);
+                std::lock_guard<std::mutex> lock(rest->mu);
+                rest->pages[i] = std::move(p);
+                ++rest->done;
+                rest->cv.notify_all();
             }
-        } catch (const std::exception& e) {
-            spdlog::warn("AF HTTPS error: {}", e.what());
+        };
+        for (size_t i = 2; i < max_pages; ++i) runtime_.after(std::chrono::nanoseconds(0), work, true);
+        work();
+        std::unique_lock<std::mutex> lock(rest->mu);
+        rest->cv.wait(lock, [&]{ return rest->done == max_pages; });
+        for (size_t i = 1; i < max_pages; ++i) pages.push_back(std::move(rest->pages[i]));
+    }
+
+    size_t emitted = 0;
+    for (auto& p : pages) emitted += p.emitted;
+    if (emitted) spdlog::info("AF HTTPS emitted {} ad(s) from {} page(s)", emitted, pages.size());
+    for (auto& p : pages) {
+        if (!p.ok) return; // keep the cursor; the next poll refetches what this one missed
+    }
+    for (auto& p : pages) {
+        if (p.newest.empty() || p.newest < sweep_newest_) continue;
+        if (p.newest > sweep_newest_) {
+            sweep_newest_ = p.newest;
+            sweep_at_newest_.clear();
+        }
+        sweep_at_newest_.insert(sweep_at_newest_.end(), p.at_newest.begin(), p.at_newest.end());
+    }
+
+    // A full last page means results are left. Keep the cursor and go on with
+    // the following pages next poll: moving it now would skip the rest.
+    if (full(pages.back())) {
+        next_page_ = first + pages.size();
+        truncated_.inc();
+        spdlog::warn("AF HTTPS: more than {} pages of results; continuing from page {} next poll", max_pages,
+                     next_page_ + 1);
+        return;
+    }
+    next_page_ = 0;
+
+    // The sweep is complete: advance the cursor to the newest ad it saw,
+    // remembering which ads sit on it.
+    std::lock_guard<std::mutex> lock(cursor_mu_);
+    const size_t before = at_cursor_.size();
+    const std::string old = cursor_;
+    if (!sweep_newest_.empty() && sweep_newest_ >= cursor_) {
+        if (sweep_newest_ > cursor_) {
+            cursor_ = sweep_newest_;
+            at_cursor_.clear();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms_));
+        at_cursor_.insert(sweep_at_newest_.begin(), sweep_at_newest_.end());
     }
+    sweep_newest_.clear();
+    sweep_at_newest_.clear();
+    if (cursor_ != old || at_cursor_.size() != before) cursor_moves_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AfHttpsSource::checkpoint(SnapshotWriter& out) const {
+    std::lock_guard<std::mutex> lock(cursor_mu_);
+    out.str(opts_.cursor_field);
+    out.str(cursor_);
+    out.u64(at_cursor_.size());
+    for (auto& k : at_cursor_) out.str(k);
+}
+
+void AfHttpsSource::restore(SnapshotReader& in) {
+    if (in.str() != opts_.cursor_field) return; // the cursor means something else now
+    std::lock_guard<std::mutex> lock(cursor_mu_);
+    cursor_ = std::string(in.str());
+    at_cursor_.clear();
+    const uint64_t n = in.u64();
+    for (uint64_t i = 0; i < n; ++i) at_cursor_.emplace(in.str());
 }
 
 } // namespace crossbring
@@ -1,30 +1,29 @@
 #include "crossbring/sources/file_json_source.h"
 
 #include <fstream>
-#include <nlohmann/json.hpp>
+#include <iterator>
 #include <spdlog/spdlog.h>
 
 namespace crossbring {
 
 void FileJsonSource::start() {
-    if (running_.exchange(true)) return;
-    th_ = std::thread([this]{ run(); });
+    if (timer_) return;
+    spdlog::info("FileJsonSource watching {}", file_.string());
+    timer_ = runtime_.every(std::chrono::milliseconds(interval_ms_), [this]{ poll(); }, true,
+                            std::chrono::steady_clock::now());
 }
 
 void FileJsonSource::stop() {
-    if (!running_.exchange(false)) return;
-    if (th_.joinable()) th_.join();
+    if (!timer_) return;
+    runtime_.cancel(timer_);
+    timer_ = 0;
 }
 
-void FileJsonSource::run() {
-    spdlog::info("FileJsonSource watching {}", file_.string());
-    while (running_.load()) {
-        try {
-            load_once();
-        } catch (const std::exception& e) {
-            spdlog::warn("FileJsonSource error: {}", e.what());
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms_));
+void FileJsonSource::poll() {
+    try {
+        load_once();
+    } catch (const std::exception& e) {
+        spdlog::warn("FileJsonSource error: {}", e.what());
     }
 }
 
@@ -38,43 +37,46 @@ static std::string file_fingerprint(const std::filesystem::path& p) {
 bool FileJsonSource::load_once() {
     if (!std::filesystem::exists(file_)) return false;
     std::string fp = file_fingerprint(file_);
-    if (fp == last_fingerprint_) return false; // unchanged
-    last_fingerprint_ = fp;
+    {
+        std::lock_guard<std::mutex> lock(fp_mu_);
+        if (fp == last_fingerprint_) return false; // unchanged
+        last_fingerprint_ = fp;
+    }
+    loads_.fetch_add(1, std::memory_order_relaxed);
 
-    std::ifstream in(file_);
+    std::ifstream in(file_, std::ios::binary);
     if (!in) return false;
-    nlohmann::json j;
-    in >> j;
-
-    // If content has top-level 'ads' like AF response
-    nlohmann::json arr;
-    if (j.is_object() && j.contains("ads") && j["ads"].is_array()) {
-        arr = j["ads"];
-    } else if (j.is_array()) {
-        arr = j;
-    } else {
-        spdlog::warn("FileJsonSource: JSON not array or ads[]");
-        return false;
-    }
+    std::string doc((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
 
+    // Accepts a top-level array or an AF response with 'ads'; the DOM is built
+    // later by whichever processor or sink asks for it.
     size_t emitted = 0;
-    for (auto& item : arr) {
-        std::string key;
-        if (item.contains("id")) key = item["id"].get<std::string>();
-        else if (item.contains("job_id")) key = item["job_id"].get<std::string>();
-        else key = std::to_string(emitted);
-
+    parser_->for_each(doc, [&](const JsonRecord& rec) {
         Event ev;
         ev.tp = std::chrono::steady_clock::now();
         ev.source = source_name_;
-        ev.key = key;
-        ev.payload = item;
+        ev.key = rec.key.empty() ? std::to_string(emitted) : std::string(rec.key);
+        ev.raw = std::string(rec.text);
         engine_.submit(std::move(ev));
         ++emitted;
-    }
+    });
     spdlog::info("FileJsonSource: emitted {} event(s) from {}", emitted, file_.string());
     return emitted > 0;
 }
 
+void FileJsonSource::checkpoint(SnapshotWriter& out) const {
+    std::lock_guard<std::mutex> lock(fp_mu_);
+    out.str(file_.string());
+    out.str(last_fingerprint_);
+}
+
+void FileJsonSource::restore(SnapshotReader& in) {
+    const auto path = in.str();
+    const auto fp = in.str();
+    if (path != file_.string()) return; // configured for another file since
+    std::lock_guard<std::mutex> lock(fp_mu_);
+    last_fingerprint_ = std::string(fp);
+}
+
 } // namespace crossbring
 
@@ -0,0 +1,403 @@
+#ifdef USE_EPOLL
+
+#include "crossbring/sources/line_protocol_source.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "crossbring/core/affinity.h"
+
+namespace crossbring {
+
+namespace {
+
+constexpr size_t kUdpBatch = 32;
+constexpr size_t kUdpMaxDatagram = 16 * 1024;
+constexpr size_t kReadChunk = 16 * 1024;
+// Reads per connection per wakeup. The loop is level-triggered, so a busy
+// connection is picked up again on the next epoll_wait, after the others.
+constexpr size_t kReadsPerWakeup = 16;
+
+// Returns a pointer to the first '\n' in [p, end), or end. The SSE2 path tests
+// 16 bytes per compare; glibc's memchr covers the tail and non-x86 targets.
+inline const char* find_newline(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    auto* hit = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    return hit ? hit : end;
+}
+
+// Splits at the first occurrence of `sep` that is outside double quotes.
+inline size_t find_unquoted(std::string_view s, char sep, size_t from = 0) {
+    bool quoted = false;
+    for (size_t i = from; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '\\' && i + 1 < s.size()) { ++i; continue; }
+        if (c == '"') quoted = !quoted;
+        else if (c == sep && !quoted) return i;
+    }
+    return std::string_view::npos;
+}
+
+bool parse_field_value(std::string_view v, nlohmann::json& out) {
+    if (v.empty()) return false;
+    if (v.front() == '"') {
+        if (v.size() < 2 || v.back() != '"') return false;
+        std::string s;
+        s.reserve(v.size() - 2);
+        for (size_t i = 1; i + 1 < v.size(); ++i) {
+            if (v[i] == '\\' && i + 2 < v.size()) ++i;
+            s.push_back(v[i]);
+        }
+        out = std::move(s);
+        return true;
+    }
+    if (v == "t" || v == "T" || v == "true" || v == "True" || v == "TRUE") { out = true; return true; }
+    if (v == "f" || v == "F" || v == "false" || v == "False" || v == "FALSE") { out = false; return true; }
+    const char* b = v.data();
+    const char* e = v.data() + v.size();
+    if (v.back() == 'i' || v.back() == 'u') {
+        int64_t iv = 0;
+        auto r = std::from_chars(b, e - 1, iv);
+        if (r.ec != std::errc() || r.ptr != e - 1) return false;
+        out = iv;
+        return true;
+    }
+    double dv = 0.0;
+    auto r = std::from_chars(b, e, dv);
+    if (r.ec != std::errc() || r.ptr != e) return false;
+    out = dv;
+    return true;
+}
+
+int bind_socket(const std::string& host, int port, int type) {
+    int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (type == SOCK_STREAM && listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+LineProtocolSource::LineProtocolSource(Engine& engine, Options opts)
+    : engine_(engine), opts_(std::move(opts)),
+      connections_(engine.metrics().gauge("crossbring_line_connections", "Open line-protocol TCP connections")),
+      accepted_total_(engine.metrics().counter("crossbring_line_accepted_total", "Accepted line-protocol TCP connections")),
+      bytes_total_(engine.metrics().counter("crossbring_line_bytes_total", "Bytes received over TCP and UDP")),
+      lines_total_(engine.metrics().counter("crossbring_line_lines_total", "Parsed line-protocol lines")),
+      parse_errors_total_(engine.metrics().counter("crossbring_line_parse_errors_total",
+                                                   "Rejected lines (malformed, oversized or truncated)")),
+      datagrams_total_(engine.metrics().counter("crossbring_line_datagrams_total", "Received UDP datagrams")) {
+    if (opts_.batch_size == 0) opts_.batch_size = 1;
+    batch_.reserve(opts_.batch_size);
+}
+
+LineProtocolSource::~LineProtocolSource() { stop(); }
+
+void LineProtocolSource::start() {
+    if (running_.exchange(true)) return;
+    if (!open_listeners()) {
+        close_all();
+        running_ = false;
+        throw std::runtime_error("LineProtocolSource: failed to bind " + opts_.host);
+    }
+    th_ = std::thread([this]{ run(); });
+}
+
+void LineProtocolSource::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) (void)!write(wake_fd_, &one, sizeof(one));
+    if (th_.joinable()) th_.join();
+    close_all();
+}
+
+bool LineProtocolSource::open_listeners() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd_ < 0 || wake_fd_ < 0) return false;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    if (opts_.tcp_port > 0) {
+        tcp_fd_ = bind_socket(opts_.host, opts_.tcp_port, SOCK_STREAM);
+        if (tcp_fd_ < 0) return false;
+        ev.data.fd = tcp_fd_;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, tcp_fd_, &ev);
+    }
+    if (opts_.udp_port > 0) {
+        udp_fd_ = bind_socket(opts_.host, opts_.udp_port, SOCK_DGRAM);
+        if (udp_fd_ < 0) return false;
+        ev.data.fd = udp_fd_;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, udp_fd_, &ev);
+    }
+    spdlog::info("LineProtocolSource listening on {} (tcp={}, udp={})", opts_.host, opts_.tcp_port, opts_.udp_port);
+    return true;
+}
+
+void LineProtocolSource::close_all() {
+    for (auto& kv : conns_) close(kv.first);
+    conns_.clear();
+    connections_.set(0);
+    for (int* fd : {&tcp_fd_, &udp_fd_, &wake_fd_, &epfd_}) {
+        if (*fd >= 0) close(*fd);
+        *fd = -1;
+    }
+}
+
+void LineProtocolSource::run() {
+    if (opts_.cpu >= 0 && !pin_current_thread(opts_.cpu)) spdlog::warn("LineProtocolSource: cannot pin to CPU {}", opts_.cpu);
+    std::vector<epoll_event> events(256);
+    while (running_.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), 500);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            spdlog::warn("LineProtocolSource epoll_wait: {}", std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) continue;
+            if (fd == tcp_fd_) { accept_ready(); continue; }
+            if (fd == udp_fd_) { read_udp(); continue; }
+            auto it = conns_.find(fd);
+            if (it == conns_.end()) continue;
+            // On HUP/ERR the reads drain what is left and close at EOF or error.
+            read_conn(*it->second);
+        }
+        flush_batch();
+    }
+    flush_batch();
+}
+
+void LineProtocolSource::accept_ready() {
+    while (true) {
+        int fd = accept4(tcp_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                spdlog::warn("LineProtocolSource accept: {}", std::strerror(errno));
+            return;
+        }
+        if (connections_.value() >= opts_.max_connections) {
+            close(fd);
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        auto c = std::make_unique<Conn>();
+        c->fd = fd;
+        conns_[fd] = std::move(c);
+        connections_.add();
+        accepted_total_.inc();
+    }
+}
+
+void LineProtocolSource::read_conn(Conn& c) {
+    for (size_t reads = 0; reads < kReadsPerWakeup;) {
+        if (c.buf.size() - c.len < kReadChunk) c.buf.resize(c.len + kReadChunk);
+        ssize_t r = read(c.fd, c.buf.data() + c.len, c.buf.size() - c.len);
+        if (r > 0) {
+            ++reads;
+            bytes_total_.inc(static_cast<uint64_t>(r));
+            c.len += static_cast<size_t>(r);
+            if (c.discarding) {
+                // Still inside an oversized line: skip up to its newline.
+                const char* nl = find_newline(c.buf.data(), c.buf.data() + c.len);
+                if (nl == c.buf.data() + c.len) {
+                    c.len = 0;
+                    continue;
+                }
+                const size_t skip = static_cast<size_t>(nl - c.buf.data()) + 1;
+                std::memmove(c.buf.data(), c.buf.data() + skip, c.len - skip);
+                c.len -= skip;
+                c.discarding = false;
+            }
+            size_t used = consume_lines(c.buf.data(), c.len, false);
+            if (used > 0) {
+                std::memmove(c.buf.data(), c.buf.data() + used, c.len - used);
+                c.len -= used;
+            }
+            if (c.len > opts_.max_line) {
+                // A line that never ends; drop the rest of it rather than grow without bound.
+                parse_errors_total_.inc();
+                c.len = 0;
+                c.discarding = true;
+            }
+            continue;
+        }
+        if (r == 0) {
+            if (!c.discarding) consume_lines(c.buf.data(), c.len, true);
+            close_conn(c.fd);
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) close_conn(c.fd);
+        return;
+    }
+}
+
+void LineProtocolSource::read_udp() {
+    static thread_local std::vector<char> storage(kUdpBatch * kUdpMaxDatagram);
+    mmsghdr msgs[kUdpBatch];
+    iovec iovs[kUdpBatch];
+    while (true) {
+        std::memset(msgs, 0, sizeof(msgs));
+        for (size_t i = 0; i < kUdpBatch; ++i) {
+            iovs[i].iov_base = storage.data() + i * kUdpMaxDatagram;
+            iovs[i].iov_len = kUdpMaxDatagram;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(udp_fd_, msgs, kUdpBatch, MSG_DONTWAIT, nullptr);
+        if (n <= 0) return;
+        for (int i = 0; i < n; ++i) {
+            datagrams_total_.inc();
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                parse_errors_total_.inc();
+                continue;
+            }
+            size_t len = msgs[i].msg_len;
+            bytes_total_.inc(len);
+            consume_lines(static_cast<const char*>(iovs[i].iov_base), len, true);
+        }
+        if (static_cast<size_t>(n) < kUdpBatch) return;
+    }
+}
+
+size_t LineProtocolSource::consume_lines(const char* data, size_t len, bool final) {
+    const char* p = data;
+    const char* end = data + len;
+    while (p < end) {
+        const char* nl = find_newline(p, end);
+        if (nl == end && !final) break;
+        emit(std::string_view(p, static_cast<size_t>(nl - p)));
+        p = nl == end ? end : nl + 1;
+    }
+    return static_cast<size_t>(p - data);
+}
+
+void LineProtocolSource::emit(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty() || line.front() == '#') return;
+    Event ev;
+    if (!parse_line(line, ev)) {
+        parse_errors_total_.inc();
+        return;
+    }
+    lines_total_.inc();
+    batch_.push_back(std::move(ev));
+    if (batch_.size() >= opts_.batch_size) flush_batch();
+}
+
+void LineProtocolSource::flush_batch() {
+    if (batch_.empty()) return;
+    engine_.submit_batch(batch_);
+}
+
+void LineProtocolSource::close_conn(int fd) {
+    if (conns_.erase(fd) == 0) return;
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.sub();
+}
+
+bool LineProtocolSource::parse_line(std::string_view line, Event& ev) {
+    size_t sp = find_unquoted(line, ' ');
+    if (sp == std::string_view::npos || sp == 0) return false;
+    std::string_view series = line.substr(0, sp);
+    std::string_view rest = line.substr(sp + 1);
+    size_t sp2 = find_unquoted(rest, ' ');
+    std::string_view fields = rest.substr(0, sp2);
+    std::string_view ts = sp2 == std::string_view::npos ? std::string_view{} : rest.substr(sp2 + 1);
+    if (fields.empty()) return false;
+
+    size_t comma = series.find(',');
+    std::string_view measurement = series.substr(0, comma);
+    if (measurement.empty()) return false;
+
+    nlohmann::json payload = {{"type", "line"}, {"name", measurement}};
+    if (comma != std::string_view::npos) {
+        nlohmann::json tags = nlohmann::json::object();
+        std::string_view t = series.substr(comma + 1);
+        while (!t.empty()) {
+            size_t c = t.find(',');
+            std::string_view kv = t.substr(0, c);
+            size_t eq = kv.find('=');
+            if (eq == std::string_view::npos || eq == 0) return false;
+            tags[std::string(kv.substr(0, eq))] = kv.substr(eq + 1);
+            t = c == std::string_view::npos ? std::string_view{} : t.substr(c + 1);
+        }
+        payload["tags"] = std::move(tags);
+    }
+
+    while (!fields.empty()) {
+        size_t c = find_unquoted(fields, ',');
+        std::string_view kv = fields.substr(0, c);
+        size_t eq = kv.find('=');
+        if (eq == std::string_view::npos || eq == 0) return false;
+        nlohmann::json v;
+        if (!parse_field_value(kv.substr(eq + 1), v)) return false;
+        payload[std::string(kv.substr(0, eq))] = std::move(v);
+        fields = c == std::string_view::npos ? std::string_view{} : fields.substr(c + 1);
+    }
+
+    while (!ts.empty() && ts.back() == ' ') ts.remove_suffix(1);
+    if (!ts.empty()) {
+        int64_t ns = 0;
+        auto r = std::from_chars(ts.data(), ts.data() + ts.size(), ns);
+        if (r.ec != std::errc() || r.ptr != ts.data() + ts.size()) return false;
+        payload["ts"] = ns;
+    }
+
+    ev.tp = std::chrono::steady_clock::now();
+    ev.source = std::string(measurement);
+    ev.key = std::string(series);
+    ev.payload = std::move(payload);
+    return true;
+}
+
+} // namespace crossbring
+
+#endif // USE_EPOLL
@@ -1,38 +1,33 @@
 #include "crossbring/sources/sensor_simulator.h"
 
 #include <chrono>
-#include <random>
-#include <thread>
 
 namespace crossbring {
 
 void SensorSimulator::start() {
-    if (running_.exchange(true)) return;
-    th_ = std::thread([this]{ run(); });
+    if (timer_) return;
+    timer_ = runtime_.every(std::chrono::milliseconds(period_ms_), [this]{ sample(); });
 }
 
 void SensorSimulator::stop() {
-    if (!running_.exchange(false)) return;
-    if (th_.joinable()) th_.join();
+    if (!timer_) return;
+    runtime_.cancel(timer_);
+    timer_ = 0;
 }
 
-void SensorSimulator::run() {
-    std::mt19937 rng{std::random_device{}()};
-    std::normal_distribution<double> dist(50.0, 10.0);
-    while (running_.load()) {
-        Event ev;
-        ev.tp = std::chrono::steady_clock::now();
-        ev.source = sensor_name_;
-        ev.key = "sensor-" + sensor_name_;
-        ev.payload = {
-            {"type", "sensor"},
-            {"name", sensor_name_},
-            {"value", dist(rng)}
-        };
-        engine_.submit(std::move(ev));
-        std::this_thread::sleep_for(std::chrono::milliseconds(period_ms_));
-    }
+void SensorSimulator::sample() {
+    Event ev;
+    ev.tp = std::chrono::steady_clock::now();
+    ev.source = sensor_name_;
+    ev.key = "sensor-" + sensor_name_;
+    ev.payload = {
+        {"type", "sensor"},
+        {"name", sensor_name_},
+        {"value", dist_(rng_)}
+    };
+    // Runs on the shared runtime thread, which must never wait on the queue; a
+    // reading that does not fit counts in crossbring_source_dropped_total.
+    engine_.try_submit(std::move(ev));
 }
 
 } // namespace crossbring
-
@@ -0,0 +1,356 @@
+#include "crossbring/storage/columnar_segment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace crossbring {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'B', 'C', 'O', 'L', 'S', 'G', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kAlign = 64;
+
+struct SegHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t rows;
+    int64_t min_ts, max_ts; // of the ts_ns column; max < min when there is none
+    uint64_t source_off;
+    uint32_t source_len;
+    uint32_t reserved;
+    uint64_t dir_off;       // ColumnMeta[columns]
+    uint64_t file_size;
+};
+
+struct ColumnMeta {
+    uint64_t name_off;
+    uint32_t name_len;
+    uint8_t type;
+    uint8_t has_stats;
+    uint16_t reserved;
+    uint64_t null_count;
+    uint64_t validity_off; // LSB-first bitmap, 0 when every row is valid
+    uint64_t values_off;   // int64/double/uint8/uint32 per row; 0 for String
+    uint64_t offsets_off;  // String: uint32[rows + 1]; Dict: uint32[dict_size + 1]
+    uint64_t bytes_off;
+    uint64_t bytes_len;
+    uint64_t dict_size;
+    double min, max;
+};
+
+class Out {
+public:
+    uint64_t append(const void* p, size_t n) {
+        pad();
+        const uint64_t off = buf_.size();
+        buf_.append(static_cast<const char*>(p), n);
+        return off;
+    }
+    void pad() { buf_.resize((buf_.size() + kAlign - 1) / kAlign * kAlign, '\0'); }
+    std::string& buf() { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+// Offsets plus concatenated bytes for a list of strings.
+void append_strings(Out& out, const std::vector<std::string>& strs, ColumnMeta& m) {
+    std::vector<uint32_t> offsets;
+    offsets.reserve(strs.size() + 1);
+    std::string bytes;
+    offsets.push_back(0);
+    for (auto& s : strs) {
+        if (bytes.size() + s.size() > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("columnar: string column over 4 GiB");
+        bytes += s;
+        offsets.push_back(static_cast<uint32_t>(bytes.size()));
+    }
+    m.offsets_off = out.append(offsets.data(), offsets.size() * sizeof(uint32_t));
+    m.bytes_off = out.append(bytes.data(), bytes.size());
+    m.bytes_len = bytes.size();
+}
+
+template <typename T>
+void stats(const std::vector<T>& v, const std::vector<uint8_t>& valid, ColumnMeta& m) {
+    double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (!valid.empty() && !valid[i]) continue;
+        const double d = static_cast<double>(v[i]);
+        if (std::isnan(d)) continue;
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    m.has_stats = lo <= hi;
+    m.min = m.has_stats ? lo : 0.0;
+    m.max = m.has_stats ? hi : 0.0;
+}
+
+// Reads just the header and source name, for pruning without mapping the file.
+bool peek(const fs::directory_entry& file, SegHeader& h, std::string& source) {
+    std::error_code ec;
+    const uint64_t size = file.file_size(ec);
+    std::ifstream is(file.path(), std::ios::binary);
+    if (ec || !is.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion || h.file_size != size ||
+        h.source_off > size || h.source_len > size - h.source_off)
+        return false;
+    source.resize(h.source_len);
+    return static_cast<bool>(is.seekg(static_cast<std::streamoff>(h.source_off)).read(&source[0], h.source_len));
+}
+
+const SegHeader& header(const void* h) { return *static_cast<const SegHeader*>(h); }
+const ColumnMeta& meta(const void* m) { return *static_cast<const ColumnMeta*>(m); }
+
+} // namespace
+
+const char* column_type_name(ColumnType t) {
+    switch (t) {
+    case ColumnType::Int64: return "int64";
+    case ColumnType::Float64: return "float64";
+    case ColumnType::Bool: return "bool";
+    case ColumnType::String: return "string";
+    case ColumnType::Dict: return "dict";
+    }
+    return "?";
+}
+
+std::string segment_dir_name(const std::string& source) {
+    std::string out;
+    for (char c : source) {
+        const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        out += ok ? c : '_';
+    }
+    return out.empty() ? "_" : out;
+}
+
+ColumnType parse_column_type(const std::string& s) {
+    for (auto t : {ColumnType::Int64, ColumnType::Float64, ColumnType::Bool, ColumnType::String, ColumnType::Dict})
+        if (s == column_type_name(t)) return t;
+    throw std::invalid_argument("unknown column type '" + s + "' (int64, float64, bool, string, dict)");
+}
+
+void write_columnar_segment(const fs::path& path, const std::string& source,
+                            const std::vector<ColumnBuffer>& columns, size_t rows) {
+    Out out;
+    SegHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.columns = static_cast<uint32_t>(columns.size());
+    h.rows = rows;
+    h.min_ts = std::numeric_limits<int64_t>::max();
+    h.max_ts = std::numeric_limits<int64_t>::min();
+    out.append(&h, sizeof(h)); // patched below
+    h.source_off = out.append(source.data(), source.size());
+    h.source_len = static_cast<uint32_t>(source.size());
+
+    std::vector<ColumnMeta> dir(columns.size());
+    for (size_t c = 0; c < columns.size(); ++c) {
+        const ColumnBuffer& col = columns[c];
+        ColumnMeta& m = dir[c];
+        m.type = static_cast<uint8_t>(col.type);
+        m.name_off = out.append(col.name.data(), col.name.size());
+        m.name_len = static_cast<uint32_t>(col.name.size());
+        if (!col.valid.empty()) {
+            std::vector<uint8_t> bits((rows + 7) / 8, 0);
+            for (size_t r = 0; r < rows; ++r) {
+                if (col.valid[r]) bits[r / 8] |= static_cast<uint8_t>(1u << (r % 8));
+                else ++m.null_count;
+            }
+            if (m.null_count > 0) m.validity_off = out.append(bits.data(), bits.size());
+        }
+        switch (col.type) {
+        case ColumnType::Int64:
+            m.values_off = out.append(col.i64.data(), rows * sizeof(int64_t));
+            stats(col.i64, col.valid, m);
+            if (col.name == "ts_ns" && m.has_stats) {
+                h.min_ts = static_cast<int64_t>(*std::min_element(col.i64.begin(), col.i64.end()));
+                h.max_ts = static_cast<int64_t>(*std::max_element(col.i64.begin(), col.i64.end()));
+            }
+            break;
+        case ColumnType::Float64:
+            m.values_off = out.append(col.f64.data(), rows * sizeof(double));
+            stats(col.f64, col.valid, m);
+            break;
+        case ColumnType::Bool:
+            m.values_off = out.append(col.b.data(), rows);
+            break;
+        case ColumnType::String:
+            append_strings(out, col.strings, m);
+            break;
+        case ColumnType::Dict:
+            m.values_off = out.append(col.codes.data(), rows * sizeof(uint32_t));
+            append_strings(out, col.strings, m);
+            m.dict_size = col.strings.size();
+            break;
+        }
+    }
+    h.dir_off = out.append(dir.data(), dir.size() * sizeof(ColumnMeta));
+    out.pad();
+    h.file_size = out.buf().size();
+    std::memcpy(&out.buf()[0], &h, sizeof(h));
+
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) throw std::runtime_error("cannot write " + tmp.string());
+        os.write(out.buf().data(), static_cast<std::streamsize>(out.buf().size()));
+        if (!os) throw std::runtime_error("short write to " + tmp.string());
+    }
+    fs::rename(tmp, path);
+}
+
+// ---- ColumnarSegment ----
+
+std::shared_ptr<const ColumnarSegment> ColumnarSegment::open(const fs::path& file) {
+    std::shared_ptr<ColumnarSegment> s(new ColumnarSegment());
+    s->file_ = MappedFile(file);
+    auto bad = [&](const char* what) { return std::runtime_error(file.string() + ": " + what); };
+    const size_t size = s->file_.size();
+    if (size < sizeof(SegHeader)) throw bad("truncated header");
+    const SegHeader& h = *reinterpret_cast<const SegHeader*>(s->file_.data());
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) throw bad("not a columnar segment");
+    if (h.version != kVersion) throw bad("unsupported version");
+    if (h.file_size != size || h.dir_off + h.columns * sizeof(ColumnMeta) > size ||
+        h.source_off + h.source_len > size)
+        throw bad("sections out of range");
+    s->header_ = &h;
+    s->dir_ = s->file_.data() + h.dir_off;
+
+    // Check every buffer once here so accessors can stay unchecked.
+    const auto* dir = static_cast<const ColumnMeta*>(s->dir_);
+    for (uint32_t c = 0; c < h.columns; ++c) {
+        const ColumnMeta& m = dir[c];
+        auto fits = [&](uint64_t off, uint64_t len) { return off <= size && len <= size - off; };
+        bool ok = m.type <= static_cast<uint8_t>(ColumnType::Dict) && fits(m.name_off, m.name_len) &&
+                  (m.validity_off == 0 || fits(m.validity_off, (h.rows + 7) / 8));
+        const auto t = static_cast<ColumnType>(m.type);
+        const uint64_t width = t == ColumnType::Int64 || t == ColumnType::Float64 ? 8
+                             : t == ColumnType::Dict ? 4 : t == ColumnType::Bool ? 1 : 0;
+        if (width) ok = ok && fits(m.values_off, h.rows * width);
+        if (t == ColumnType::String || t == ColumnType::Dict) {
+            const uint64_t n = (t == ColumnType::String ? h.rows : m.dict_size) + 1;
+            ok = ok && fits(m.offsets_off, n * sizeof(uint32_t)) && fits(m.bytes_off, m.bytes_len);
+            if (ok) {
+                const auto* offs = reinterpret_cast<const uint32_t*>(s->file_.data() + m.offsets_off);
+                for (uint64_t i = 0; i + 1 < n && ok; ++i) ok = offs[i] <= offs[i + 1];
+                ok = ok && offs[n - 1] <= m.bytes_len;
+            }
+        }
+        if (ok && t == ColumnType::Dict) {
+            const auto* codes = reinterpret_cast<const uint32_t*>(s->file_.data() + m.values_off);
+            for (uint64_t r = 0; r < h.rows && ok; ++r) ok = codes[r] < m.dict_size;
+        }
+        if (!ok) throw bad("column out of range");
+    }
+    return s;
+}
+
+std::vector<fs::path> ColumnarSegment::find(const fs::path& dir, const std::string& source,
+                                            int64_t from_ns, int64_t to_ns) {
+    std::vector<fs::path> dirs;
+    std::error_code ec;
+    if (!source.empty()) {
+        dirs.push_back(dir / segment_dir_name(source));
+    } else {
+        for (auto& e : fs::directory_iterator(dir, ec))
+            if (e.is_directory(ec)) dirs.push_back(e.path());
+    }
+
+    std::vector<fs::path> out;
+    SegHeader h;
+    std::string seg_source;
+    for (auto& d : dirs) {
+        for (auto& e : fs::directory_iterator(d, ec)) {
+            if (e.path().extension() != ".cbc") continue;
+            // Partial or foreign files fail here, or later in open().
+            if (!peek(e, h, seg_source)) continue;
+            // Sources that differ only in punctuation share a directory.
+            if (!source.empty() && seg_source != source) continue;
+            if (h.max_ts < from_ns || h.min_ts >= to_ns) continue;
+            out.push_back(e.path());
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::string_view ColumnarSegment::source() const {
+    const SegHeader& h = header(header_);
+    return {at(h.source_off), h.source_len};
+}
+size_t ColumnarSegment::rows() const { return header(header_).rows; }
+int64_t ColumnarSegment::min_ts() const { return header(header_).min_ts; }
+int64_t ColumnarSegment::max_ts() const { return header(header_).max_ts; }
+size_t ColumnarSegment::columns() const { return header(header_).columns; }
+
+ColumnarSegment::Column ColumnarSegment::column(size_t i) const {
+    Column c;
+    c.seg_ = this;
+    c.meta_ = static_cast<const ColumnMeta*>(dir_) + i;
+    return c;
+}
+
+std::optional<ColumnarSegment::Column> ColumnarSegment::find_column(std::string_view name) const {
+    for (size_t i = 0; i < columns(); ++i) {
+        Column c = column(i);
+        if (c.name() == name) return c;
+    }
+    return std::nullopt;
+}
+
+std::string_view ColumnarSegment::Column::name() const {
+    const ColumnMeta& m = meta(meta_);
+    return {seg_->at(m.name_off), m.name_len};
+}
+ColumnType ColumnarSegment::Column::type() const { return static_cast<ColumnType>(meta(meta_).type); }
+size_t ColumnarSegment::Column::null_count() const { return meta(meta_).null_count; }
+bool ColumnarSegment::Column::has_stats() const { return meta(meta_).has_stats != 0; }
+double ColumnarSegment::Column::min() const { return meta(meta_).min; }
+double ColumnarSegment::Column::max() const { return meta(meta_).max; }
+
+bool ColumnarSegment::Column::is_null(size_t row) const {
+    const ColumnMeta& m = meta(meta_);
+    if (m.validity_off == 0) return false;
+    return !(static_cast<uint8_t>(seg_->at(m.validity_off)[row / 8]) & (1u << (row % 8)));
+}
+
+const int64_t* ColumnarSegment::Column::i64() const {
+    return type() == ColumnType::Int64 ? reinterpret_cast<const int64_t*>(seg_->at(meta(meta_).values_off)) : nullptr;
+}
+const double* ColumnarSegment::Column::f64() const {
+    return type() == ColumnType::Float64 ? reinterpret_cast<const double*>(seg_->at(meta(meta_).values_off)) : nullptr;
+}
+const uint8_t* ColumnarSegment::Column::bools() const {
+    return type() == ColumnType::Bool ? reinterpret_cast<const uint8_t*>(seg_->at(meta(meta_).values_off)) : nullptr;
+}
+const uint32_t* ColumnarSegment::Column::codes() const {
+    return type() == ColumnType::Dict ? reinterpret_cast<const uint32_t*>(seg_->at(meta(meta_).values_off)) : nullptr;
+}
+
+size_t ColumnarSegment::Column::dict_size() const { return meta(meta_).dict_size; }
+
+std::string_view ColumnarSegment::Column::dict(size_t code) const {
+    const ColumnMeta& m = meta(meta_);
+    const auto* offs = reinterpret_cast<const uint32_t*>(seg_->at(m.offsets_off));
+    return {seg_->at(m.bytes_off) + offs[code], offs[code + 1] - offs[code]};
+}
+
+std::string_view ColumnarSegment::Column::str(size_t row) const {
+    if (is_null(row)) return {};
+    if (type() == ColumnType::Dict) return dict(codes()[row]);
+    if (type() != ColumnType::String) return {};
+    const ColumnMeta& m = meta(meta_);
+    const auto* offs = reinterpret_cast<const uint32_t*>(seg_->at(m.offsets_off));
+    return {seg_->at(m.bytes_off) + offs[row], offs[row + 1] - offs[row]};
+}
+
+} // namespace crossbring
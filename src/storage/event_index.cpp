@@ -0,0 +1,156 @@
+#include "crossbring/storage/event_index.h"
+
+#include <algorithm>
+
+namespace crossbring {
+
+namespace {
+
+struct TsLess {
+    template <typename E>
+    bool operator()(const E& e, int64_t ts) const { return e.ts < ts; }
+    template <typename E>
+    bool operator()(int64_t ts, const E& e) const { return ts < e.ts; }
+};
+
+} // namespace
+
+void EventIndex::add(const std::string& source, const std::string& key, int64_t ts_ns, DocRef doc) {
+    std::shared_ptr<Series> s = find(source, key);
+    if (!s) {
+        std::unique_lock<std::shared_mutex> lock(map_mu_);
+        auto& slot = by_source_[source][key];
+        if (!slot) slot = std::make_shared<Series>();
+        s = slot;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        auto& q = s->entries;
+        if (q.empty() || q.back().ts <= ts_ns) {
+            q.push_back({ts_ns, std::move(doc)});
+        } else {
+            // Workers can finish slightly out of order; keep the deque sorted.
+            q.insert(std::upper_bound(q.begin(), q.end(), ts_ns, TsLess{}), Entry{ts_ns, std::move(doc)});
+        }
+        if (q.size() > opts_.max_per_key) {
+            q.pop_front();
+            ++s->trimmed;
+        } else {
+            total_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    std::lock_guard<std::mutex> lock(fifo_mu_);
+    fifo_.push_back(std::move(s));
+    if (total_.load(std::memory_order_relaxed) > opts_.max_events) evict_global();
+    else if (fifo_.size() > 2 * opts_.max_events + 1024) compact_fifo();
+}
+
+// Called with fifo_mu_ held. Each FIFO entry stands for one inserted event; entries
+// whose event was already trimmed by the per-key cap are skipped.
+void EventIndex::evict_global() {
+    while (!fifo_.empty() && total_.load(std::memory_order_relaxed) > opts_.max_events) {
+        auto s = std::move(fifo_.front());
+        fifo_.pop_front();
+        std::lock_guard<std::mutex> lock(s->mu);
+        if (s->trimmed > 0) { --s->trimmed; continue; }
+        if (s->entries.empty()) continue;
+        s->entries.pop_front();
+        total_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+// Called with fifo_mu_ held. Hot keys capped by max_per_key leave FIFO entries for
+// events that are already gone; drop those so the FIFO stays proportional to the index.
+void EventIndex::compact_fifo() {
+    std::deque<std::shared_ptr<Series>> kept;
+    for (auto& s : fifo_) {
+        std::lock_guard<std::mutex> lock(s->mu);
+        if (s->trimmed > 0) { --s->trimmed; continue; }
+        kept.push_back(std::move(s));
+    }
+    fifo_.swap(kept);
+}
+
+std::shared_ptr<EventIndex::Series> EventIndex::find(const std::string& source, const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(map_mu_);
+    auto it = by_source_.find(source);
+    if (it == by_source_.end()) return nullptr;
+    auto jt = it->second.find(key);
+    return jt == it->second.end() ? nullptr : jt->second;
+}
+
+std::vector<std::shared_ptr<EventIndex::Series>> EventIndex::find_source(const std::string& source) const {
+    std::vector<std::shared_ptr<Series>> out;
+    std::shared_lock<std::shared_mutex> lock(map_mu_);
+    auto it = by_source_.find(source);
+    if (it == by_source_.end()) return out;
+    out.reserve(it->second.size());
+    for (auto& kv : it->second) out.push_back(kv.second);
+    return out;
+}
+
+size_t EventIndex::query_series(const Series& s, int64_t from_ns, int64_t to_ns, size_t limit,
+                                const BatchFn& fn, size_t batch) const {
+    // Resume each batch from the last timestamp seen, skipping entries already
+    // delivered at that timestamp, so the lock is only held while copying refs.
+    size_t delivered = 0;
+    int64_t cursor = from_ns;
+    size_t skip_at_cursor = 0;
+    std::vector<DocRef> out;
+    while (delivered < limit) {
+        out.clear();
+        const size_t want = std::min(batch, limit - delivered);
+        {
+            std::lock_guard<std::mutex> lock(s.mu);
+            auto it = std::lower_bound(s.entries.begin(), s.entries.end(), cursor, TsLess{});
+            for (size_t skipped = 0; it != s.entries.end() && it->ts == cursor && skipped < skip_at_cursor; ++it, ++skipped) {}
+            for (; it != s.entries.end() && it->ts <= to_ns && out.size() < want; ++it) {
+                skip_at_cursor = it->ts == cursor ? skip_at_cursor + 1 : 1;
+                cursor = it->ts;
+                out.push_back(it->doc);
+            }
+        }
+        if (out.empty()) break;
+        delivered += out.size();
+        if (!fn(out) || out.size() < want) break;
+    }
+    return delivered;
+}
+
+size_t EventIndex::query(const std::string& source, const std::string& key, int64_t from_ns, int64_t to_ns,
+                         size_t limit, const BatchFn& fn, size_t batch) const {
+    if (limit == 0 || batch == 0) return 0;
+    if (!key.empty()) {
+        auto s = find(source, key);
+        return s ? query_series(*s, from_ns, to_ns, limit, fn, batch) : 0;
+    }
+
+    // All keys of a source: take up to `limit` refs from each series, then merge by time.
+    std::vector<Entry> merged;
+    for (auto& s : find_source(source)) {
+        std::lock_guard<std::mutex> lock(s->mu);
+        auto lo = std::lower_bound(s->entries.begin(), s->entries.end(), from_ns, TsLess{});
+        for (size_t n = 0; lo != s->entries.end() && lo->ts <= to_ns && n < limit; ++lo, ++n) merged.push_back(*lo);
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const Entry& a, const Entry& b){ return a.ts < b.ts; });
+    if (merged.size() > limit) merged.resize(limit);
+
+    size_t delivered = 0;
+    std::vector<DocRef> out;
+    for (size_t i = 0; i < merged.size(); i += batch) {
+        out.clear();
+        for (size_t j = i; j < merged.size() && j < i + batch; ++j) out.push_back(std::move(merged[j].doc));
+        delivered += out.size();
+        if (!fn(out)) break;
+    }
+    return delivered;
+}
+
+size_t EventIndex::series_count() const {
+    std::shared_lock<std::shared_mutex> lock(map_mu_);
+    size_t n = 0;
+    for (auto& kv : by_source_) n += kv.second.size();
+    return n;
+}
+
+} // namespace crossbring
@@ -0,0 +1,364 @@
+#include "crossbring/storage/lookup_table.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "crossbring/storage/sketches.h"
+
+namespace crossbring {
+
+namespace fs = std::filesystem;
+
+constexpr char kMagic[8] = {'C', 'B', 'L', 'O', 'O', 'K', 'U', 'P'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+struct LookupTable::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t rows;
+    uint64_t slots; // power of two
+    uint64_t slots_off, cells_off, names_off, blob_off, blob_len;
+};
+
+// Keys hash with sketch_hash(); changing it invalidates compiled files (bump kVersion).
+struct LookupTable::Slot {
+    uint64_t hash;
+    uint64_t key_off;
+    uint32_t key_len;
+    uint32_t row; // kEmpty for a free slot
+};
+
+// `bits` holds the blob offset of String/Json text, the IEEE bits of a Number
+// or 0/1 for a Bool.
+struct LookupTable::Cell {
+    uint8_t type;
+    uint8_t pad[3];
+    uint32_t len;
+    uint64_t bits;
+};
+
+namespace {
+
+using SrcCell = std::pair<LookupTable::Value::Type, std::string>; // type, text (numbers as text)
+
+struct Builder {
+    std::vector<std::string> columns;
+    std::vector<std::string> keys;
+    std::vector<std::vector<SrcCell>> rows;
+    std::unordered_map<std::string, size_t> row_of;
+    std::unordered_map<std::string, size_t> column_of;
+
+    size_t column(const std::string& name) {
+        auto it = column_of.find(name);
+        if (it != column_of.end()) return it->second;
+        column_of.emplace(name, columns.size());
+        columns.push_back(name);
+        return columns.size() - 1;
+    }
+    // A repeated key keeps its last row, like a later line overriding an earlier one.
+    std::vector<SrcCell>& row(const std::string& key) {
+        auto it = row_of.find(key);
+        if (it != row_of.end()) return rows[it->second];
+        row_of.emplace(key, rows.size());
+        keys.push_back(key);
+        rows.emplace_back();
+        return rows.back();
+    }
+};
+
+std::string number_key(double v) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.15g", v); // same text as ExprValue::to_key
+    return std::string(buf, static_cast<size_t>(n));
+}
+
+// CSV cells are numbers when they parse completely, except codes with leading
+// zeros ("0112"), which stay strings so they keep their digits.
+SrcCell csv_cell(const std::string& s) {
+    using T = LookupTable::Value::Type;
+    if (s.empty()) return {T::Null, {}};
+    const bool leading_zero = s.size() > 1 && s[0] == '0' && s[1] != '.';
+    if (!leading_zero) {
+        char* end = nullptr;
+        double v = std::strtod(s.c_str(), &end);
+        if (end == s.c_str() + s.size() && std::isfinite(v) && !std::isspace(static_cast<unsigned char>(s[0])))
+            return {T::Number, s};
+    }
+    return {T::String, s};
+}
+
+std::vector<std::vector<std::string>> parse_csv(const std::string& doc) {
+    std::vector<std::vector<std::string>> records;
+    std::vector<std::string> rec;
+    std::string field;
+    bool quoted = false, any = false;
+    auto end_field = [&] { rec.push_back(std::move(field)); field.clear(); };
+    auto end_record = [&] {
+        end_field();
+        if (!(rec.size() == 1 && rec[0].empty())) records.push_back(std::move(rec));
+        rec.clear();
+    };
+    for (size_t i = 0; i < doc.size(); ++i) {
+        char c = doc[i];
+        any = true;
+        if (quoted) {
+            if (c != '"') field += c;
+            else if (i + 1 < doc.size() && doc[i + 1] == '"') field += doc[++i];
+            else quoted = false;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            end_field();
+        } else if (c == '\n') {
+            end_record();
+            any = false;
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    if (any) end_record();
+    return records;
+}
+
+void load_csv(const std::string& doc, const std::string& key_column, Builder& b) {
+    auto records = parse_csv(doc);
+    if (records.empty()) throw std::runtime_error("empty CSV");
+    const auto& header = records[0];
+    size_t key_idx = header.size();
+    std::vector<size_t> col_idx(header.size());
+    for (size_t i = 0; i < header.size(); ++i) {
+        if (header[i] == key_column) key_idx = i;
+        else col_idx[i] = b.column(header[i]);
+    }
+    if (key_idx == header.size()) throw std::runtime_error("key column '" + key_column + "' not in CSV header");
+    for (size_t r = 1; r < records.size(); ++r) {
+        const auto& rec = records[r];
+        if (key_idx >= rec.size() || rec[key_idx].empty()) continue;
+        auto& row = b.row(rec[key_idx]);
+        row.assign(b.columns.size(), SrcCell{});
+        for (size_t i = 0; i < rec.size() && i < header.size(); ++i)
+            if (i != key_idx) row[col_idx[i]] = csv_cell(rec[i]);
+    }
+}
+
+SrcCell json_cell(const nlohmann::json& v) {
+    using T = LookupTable::Value::Type;
+    if (v.is_null()) return {T::Null, {}};
+    if (v.is_boolean()) return {T::Bool, v.get<bool>() ? "1" : "0"};
+    if (v.is_number()) return {T::Number, number_key(v.get<double>())};
+    if (v.is_string()) return {T::String, v.get<std::string>()};
+    return {T::Json, v.dump()};
+}
+
+void load_json(const std::string& doc, const std::string& key_column, Builder& b) {
+    auto j = nlohmann::json::parse(doc);
+    auto add = [&](const std::string& key, const nlohmann::json& obj) {
+        auto& row = b.row(key);
+        row.clear();
+        if (!obj.is_object()) {
+            row.resize(b.column("value") + 1);
+            row[b.column("value")] = json_cell(obj);
+            return;
+        }
+        for (auto& [name, v] : obj.items()) {
+            if (name == key_column) continue;
+            size_t c = b.column(name);
+            if (row.size() <= c) row.resize(c + 1);
+            row[c] = json_cell(v);
+        }
+    };
+    if (j.is_array()) {
+        for (auto& obj : j) {
+            if (!obj.is_object()) continue;
+            auto it = obj.find(key_column);
+            if (it == obj.end() || it->is_null()) continue;
+            add(it->is_string() ? it->get<std::string>()
+                : it->is_number() ? number_key(it->get<double>()) : it->dump(), obj);
+        }
+    } else if (j.is_object()) {
+        for (auto& [key, obj] : j.items()) add(key, obj);
+    } else {
+        throw std::runtime_error("JSON table must be an array or an object");
+    }
+}
+
+bool looks_like_json(const fs::path& src, const std::string& doc) {
+    if (src.extension() == ".json") return true;
+    for (char c : doc) {
+        if (std::isspace(static_cast<unsigned char>(c))) continue;
+        return c == '[' || c == '{';
+    }
+    return false;
+}
+
+template <typename T>
+void put(std::string& out, size_t off, const T& v) { std::memcpy(&out[off], &v, sizeof(T)); }
+
+size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+} // namespace
+
+void LookupTable::compile(const fs::path& src, const fs::path& out, const std::string& key_column) {
+    std::ifstream in(src, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot read " + src.string());
+    std::string doc((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Builder b;
+    if (looks_like_json(src, doc)) load_json(doc, key_column, b);
+    else load_csv(doc, key_column, b);
+
+    uint64_t slots = 2;
+    while (slots < 2 * b.rows.size()) slots <<= 1;
+    const uint32_t ncols = static_cast<uint32_t>(b.columns.size());
+
+    std::string blob;
+    auto intern = [&](const std::string& s) {
+        uint64_t off = blob.size();
+        blob += s;
+        return off;
+    };
+    auto make_cell = [&](const SrcCell& c) {
+        LookupTable::Cell out{};
+        out.type = static_cast<uint8_t>(c.first);
+        switch (c.first) {
+        case Value::Type::Bool: out.bits = c.second == "1"; break;
+        case Value::Type::Number: {
+            double v = std::strtod(c.second.c_str(), nullptr);
+            std::memcpy(&out.bits, &v, sizeof(v));
+            break;
+        }
+        case Value::Type::String:
+        case Value::Type::Json:
+            out.len = static_cast<uint32_t>(c.second.size());
+            out.bits = intern(c.second);
+            break;
+        default: break;
+        }
+        return out;
+    };
+
+    std::vector<LookupTable::Cell> names;
+    for (auto& c : b.columns) names.push_back(make_cell({Value::Type::String, c}));
+    std::vector<LookupTable::Cell> cells(b.rows.size() * ncols, LookupTable::Cell{});
+    for (size_t r = 0; r < b.rows.size(); ++r)
+        for (size_t c = 0; c < b.rows[r].size(); ++c) cells[r * ncols + c] = make_cell(b.rows[r][c]);
+    std::vector<Slot> table(slots, Slot{0, 0, 0, kEmpty});
+    for (size_t r = 0; r < b.keys.size(); ++r) {
+        const uint64_t h = sketch_hash(b.keys[r]);
+        uint64_t i = h & (slots - 1);
+        while (table[i].row != kEmpty) i = (i + 1) & (slots - 1);
+        table[i] = Slot{h, intern(b.keys[r]), static_cast<uint32_t>(b.keys[r].size()), static_cast<uint32_t>(r)};
+    }
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.columns = ncols;
+    h.rows = b.rows.size();
+    h.slots = slots;
+    h.slots_off = align8(sizeof(Header));
+    h.cells_off = h.slots_off + slots * sizeof(Slot);
+    h.names_off = h.cells_off + cells.size() * sizeof(LookupTable::Cell);
+    h.blob_off = h.names_off + names.size() * sizeof(LookupTable::Cell);
+    h.blob_len = blob.size();
+
+    std::string file(h.blob_off + blob.size(), '\0');
+    put(file, 0, h);
+    if (!table.empty()) std::memcpy(&file[h.slots_off], table.data(), table.size() * sizeof(Slot));
+    if (!cells.empty()) std::memcpy(&file[h.cells_off], cells.data(), cells.size() * sizeof(LookupTable::Cell));
+    if (!names.empty()) std::memcpy(&file[h.names_off], names.data(), names.size() * sizeof(LookupTable::Cell));
+    if (!blob.empty()) std::memcpy(&file[h.blob_off], blob.data(), blob.size());
+
+    fs::path tmp = out;
+    tmp += ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) throw std::runtime_error("cannot write " + tmp.string());
+        os.write(file.data(), static_cast<std::streamsize>(file.size()));
+        if (!os) throw std::runtime_error("short write to " + tmp.string());
+    }
+    // Mapped readers of the old file keep their pages; rename swaps the name only.
+    fs::rename(tmp, out);
+}
+
+std::shared_ptr<const LookupTable> LookupTable::open(const fs::path& file) {
+    std::shared_ptr<LookupTable> t(new LookupTable());
+    t->file_ = MappedFile(file);
+    const char* base = t->file_.data();
+    auto bad = [&](const char* what) { return std::runtime_error(file.string() + ": " + what); };
+    if (t->file_.size() < sizeof(Header)) throw bad("truncated header");
+    t->header_ = reinterpret_cast<const Header*>(base);
+    const Header& h = *t->header_;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) throw bad("not a lookup table");
+    if (h.version != kVersion) throw bad("unsupported version");
+    if (h.slots == 0 || (h.slots & (h.slots - 1)) != 0 || h.rows > h.slots) throw bad("bad slot count");
+    if (h.slots_off + h.slots * sizeof(Slot) > h.cells_off ||
+        h.cells_off + h.rows * h.columns * sizeof(Cell) > h.names_off ||
+        h.names_off + h.columns * sizeof(Cell) > h.blob_off ||
+        h.blob_off + h.blob_len > t->file_.size())
+        throw bad("sections out of range");
+    t->slots_ = reinterpret_cast<const Slot*>(base + h.slots_off);
+    t->cells_ = reinterpret_cast<const Cell*>(base + h.cells_off);
+    t->names_ = reinterpret_cast<const Cell*>(base + h.names_off);
+    t->blob_ = base + h.blob_off;
+    t->blob_len_ = h.blob_len;
+    t->rows_ = h.rows;
+    t->columns_ = h.columns;
+    t->slot_mask_ = h.slots - 1;
+    return t;
+}
+
+std::string_view LookupTable::blob(uint64_t off, uint32_t len) const {
+    if (off > blob_len_ || len > blob_len_ - off) return {};
+    return {blob_ + off, len};
+}
+
+std::string_view LookupTable::column(size_t c) const {
+    return c < columns_ ? blob(names_[c].bits, names_[c].len) : std::string_view{};
+}
+
+size_t LookupTable::column_index(std::string_view name) const {
+    for (size_t c = 0; c < columns_; ++c)
+        if (column(c) == name) return c;
+    return npos;
+}
+
+size_t LookupTable::find(std::string_view key) const {
+    const uint64_t h = sketch_hash(key);
+    // At most half the slots are used, so a free slot ends every probe sequence.
+    for (uint64_t i = h & slot_mask_;; i = (i + 1) & slot_mask_) {
+        const Slot& s = slots_[i];
+        if (s.row == kEmpty) return npos;
+        if (s.hash == h && blob(s.key_off, s.key_len) == key) return s.row < rows_ ? s.row : npos;
+    }
+}
+
+LookupTable::Value LookupTable::value(size_t row, size_t column) const {
+    Value v;
+    if (row >= rows_ || column >= columns_) return v;
+    const Cell& c = cells_[row * columns_ + column];
+    v.type = static_cast<Value::Type>(c.type);
+    switch (v.type) {
+    case Value::Type::Bool: v.b = c.bits != 0; break;
+    case Value::Type::Number: std::memcpy(&v.num, &c.bits, sizeof(v.num)); break;
+    case Value::Type::String:
+    case Value::Type::Json: v.str = blob(c.bits, c.len); break;
+    default: v.type = Value::Type::Null; break;
+    }
+    return v;
+}
+
+} // namespace crossbring
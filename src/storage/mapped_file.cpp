@@ -0,0 +1,78 @@
+#include "crossbring/storage/mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace crossbring {
+
+MappedFile::MappedFile(const std::filesystem::path& file) {
+#ifdef _WIN32
+    HANDLE fh = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) throw std::runtime_error("cannot open " + file.string());
+    LARGE_INTEGER sz;
+    GetFileSizeEx(fh, &sz);
+    size_ = static_cast<size_t>(sz.QuadPart);
+    if (size_ > 0) {
+        mapping_ = CreateFileMappingW(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) map_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    }
+    CloseHandle(fh);
+#else
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error("cannot open " + file.string());
+    struct stat st{};
+    if (::fstat(fd, &st) == 0) size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) map_ = p;
+    }
+    ::close(fd); // the mapping keeps the file alive
+#endif
+    if (!map_) {
+        reset();
+        throw std::runtime_error("cannot map " + file.string());
+    }
+}
+
+MappedFile::~MappedFile() { reset(); }
+
+MappedFile::MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this != &o) {
+        reset();
+        std::swap(map_, o.map_);
+        std::swap(size_, o.size_);
+#ifdef _WIN32
+        std::swap(mapping_, o.mapping_);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::reset() {
+#ifdef _WIN32
+    if (map_) UnmapViewOfFile(map_);
+    if (mapping_) CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    if (map_) ::munmap(map_, size_);
+#endif
+    map_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace crossbring
@@ -0,0 +1,256 @@
+#include "crossbring/storage/sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace crossbring {
+
+namespace {
+
+uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+int leading_zeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (uint64_t{1} << 63))) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+} // namespace
+
+uint64_t sketch_hash(std::string_view s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return mix64(h);
+}
+
+// ---- HeavyHitters ----
+
+HeavyHitters::HeavyHitters(size_t width, size_t depth, size_t k)
+    : width_(std::max<size_t>(1, width)), depth_(std::max<size_t>(1, depth)), k_(k),
+      cells_(width_ * depth_, 0) {
+    top_.reserve(k_);
+}
+
+// Each row re-mixes the key hash with its own seed. Double hashing (h1 + i*h2)
+// is not enough here: with a power-of-two width only the low bits of h1 and h2
+// matter, and keys that share them collide in every row.
+size_t HeavyHitters::cell(size_t row, uint64_t hash) const {
+    return row * width_ + static_cast<size_t>(mix64(hash + (row + 1) * 0x9e3779b97f4a7c15ull) % width_);
+}
+
+uint64_t HeavyHitters::estimate_hashed(uint64_t hash) const {
+    uint64_t est = std::numeric_limits<uint64_t>::max();
+    for (size_t r = 0; r < depth_; ++r) est = std::min(est, cells_[cell(r, hash)]);
+    return est;
+}
+
+void HeavyHitters::add(std::string_view key, uint64_t n) {
+    const uint64_t hash = sketch_hash(key);
+    // Conservative update: raise only the cells below the new estimate.
+    const uint64_t est = estimate_hashed(hash) + n;
+    for (size_t r = 0; r < depth_; ++r) {
+        uint64_t& c = cells_[cell(r, hash)];
+        if (c < est) c = est;
+    }
+    offer(key, hash, est);
+}
+
+void HeavyHitters::offer(std::string_view key, uint64_t hash, uint64_t count) {
+    // A tracked key's estimate only grows past its own count, which is at least
+    // the minimum, so a full list can skip the long tail without scanning.
+    if (k_ == 0 || (top_.size() == k_ && count <= min_count_)) return;
+    Entry* min = nullptr;
+    bool changed = false;
+    for (auto& e : top_) {
+        if (e.hash == hash && e.key == key) {
+            e.count = count;
+            changed = true;
+            break;
+        }
+        if (!min || e.count < min->count) min = &e;
+    }
+    if (!changed) {
+        if (top_.size() < k_) {
+            top_.push_back(Entry{std::string(key), hash, count});
+        } else {
+            min->key.assign(key.data(), key.size());
+            min->hash = hash;
+            min->count = count;
+        }
+    }
+    if (top_.size() == k_) {
+        min_count_ = top_[0].count;
+        for (auto& e : top_) min_count_ = std::min(min_count_, e.count);
+    }
+}
+
+void HeavyHitters::merge(const HeavyHitters& other) {
+    for (size_t i = 0; i < cells_.size() && i < other.cells_.size(); ++i) cells_[i] += other.cells_[i];
+    // Candidates from both sides, re-ranked against the merged table.
+    std::vector<Entry> candidates = std::move(top_);
+    candidates.insert(candidates.end(), other.top_.begin(), other.top_.end());
+    top_.clear();
+    min_count_ = 0;
+    for (auto& e : candidates) offer(e.key, e.hash, estimate_hashed(e.hash));
+}
+
+std::vector<std::pair<std::string, uint64_t>> HeavyHitters::top() const {
+    std::vector<std::pair<std::string, uint64_t>> out;
+    out.reserve(top_.size());
+    for (auto& e : top_) out.emplace_back(e.key, e.count);
+    std::sort(out.begin(), out.end(), [](auto& a, auto& b){ return a.second > b.second; });
+    return out;
+}
+
+size_t HeavyHitters::memory_bytes() const {
+    size_t n = cells_.capacity() * sizeof(uint64_t) + top_.capacity() * sizeof(Entry);
+    for (auto& e : top_) n += e.key.capacity();
+    return n;
+}
+
+// ---- HyperLogLog ----
+
+HyperLogLog::HyperLogLog(unsigned precision)
+    : p_(std::min(16u, std::max(4u, precision))), registers_(size_t{1} << p_, 0) {}
+
+void HyperLogLog::add_hash(uint64_t hash) {
+    const size_t idx = static_cast<size_t>(hash >> (64 - p_));
+    // The sentinel bit bounds the rank when the remaining bits are all zero.
+    const uint64_t rest = (hash << p_) | (uint64_t{1} << (p_ - 1));
+    const uint8_t rank = static_cast<uint8_t>(leading_zeros(rest) + 1);
+    if (rank > registers_[idx]) registers_[idx] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < registers_.size() && i < other.registers_.size(); ++i)
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+}
+
+double HyperLogLog::estimate() const {
+    const double m = static_cast<double>(registers_.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t r : registers_) {
+        sum += std::ldexp(1.0, -static_cast<int>(r));
+        zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    // Small-range correction (linear counting); a 64-bit hash needs no large-range one.
+    if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / static_cast<double>(zeros));
+    return e;
+}
+
+// ---- QuantileSketch (KLL) ----
+
+QuantileSketch::QuantileSketch(uint32_t k)
+    : k_(std::max<uint32_t>(8, k)),
+      min_(std::numeric_limits<double>::quiet_NaN()), max_(std::numeric_limits<double>::quiet_NaN()) {
+    add_level();
+}
+
+// Capacity shrinks by 2/3 per level below the top, with a floor of 8 so the
+// bottom levels do not compact on every other item.
+void QuantileSketch::add_level() {
+    levels_.emplace_back();
+    caps_.resize(levels_.size());
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        const double depth = static_cast<double>(levels_.size() - 1 - h);
+        caps_[h] = std::max<size_t>(8, static_cast<size_t>(std::ceil(k_ * std::pow(2.0 / 3.0, depth))));
+    }
+}
+
+void QuantileSketch::add(double v) {
+    if (std::isnan(v)) return;
+    if (n_ == 0) {
+        min_ = max_ = v;
+    } else {
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+    ++n_;
+    levels_[0].push_back(v);
+    if (levels_[0].size() >= capacity(0)) compress();
+}
+
+// Compacts every level at or over capacity: sort, keep one item if the count is
+// odd, and promote every other item (random offset) one level up at double weight.
+void QuantileSketch::compress() {
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        if (levels_[h].size() < capacity(h)) continue;
+        if (h + 1 == levels_.size()) add_level();
+        auto& level = levels_[h];
+        auto& up = levels_[h + 1];
+        std::sort(level.begin(), level.end());
+        coin_ ^= coin_ << 13;
+        coin_ ^= coin_ >> 7;
+        coin_ ^= coin_ << 17;
+        const size_t keep = level.size() % 2;
+        for (size_t i = keep + (coin_ & 1); i < level.size(); i += 2) up.push_back(level[i]);
+        level.resize(keep);
+        // A level that was once the top keeps its old buffer; give it back.
+        if (level.capacity() > 2 * capacity(h)) level.shrink_to_fit();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.n_ == 0) return;
+    if (n_ == 0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    n_ += other.n_;
+    while (levels_.size() < other.levels_.size()) add_level();
+    for (size_t h = 0; h < other.levels_.size(); ++h)
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+    compress();
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (n_ == 0) return std::numeric_limits<double>::quiet_NaN();
+    if (q <= 0.0) return min_;
+    if (q >= 1.0) return max_;
+    std::vector<std::pair<double, uint64_t>> items;
+    uint64_t total = 0;
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        for (double v : levels_[h]) items.emplace_back(v, uint64_t{1} << h);
+        total += levels_[h].size() << h;
+    }
+    std::sort(items.begin(), items.end());
+    const double target = q * static_cast<double>(total);
+    uint64_t cum = 0;
+    for (auto& [v, w] : items) {
+        cum += w;
+        if (static_cast<double>(cum) >= target) return v;
+    }
+    return max_;
+}
+
+size_t QuantileSketch::memory_bytes() const {
+    size_t n = levels_.capacity() * sizeof(std::vector<double>);
+    for (auto& l : levels_) n += l.capacity() * sizeof(double);
+    return n;
+}
+
+} // namespace crossbring
@@ -0,0 +1,367 @@
+#ifdef USE_SQLITE
+
+#include "crossbring/storage/sqlite_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include <sqlite3.h>
+#include <spdlog/spdlog.h>
+
+#include "crossbring/core/clock.h"
+
+namespace fs = std::filesystem;
+
+namespace crossbring {
+
+namespace {
+
+constexpr int64_t kHourNs = 3600LL * 1000000000LL;
+constexpr int64_t kDayNs = 24 * kHourNs;
+constexpr const char* kIndexSql = "CREATE INDEX IF NOT EXISTS events_source_key_ts ON events (source, key, ts_ns)";
+
+bool exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) == SQLITE_OK) return true;
+    spdlog::warn("SQLite: {} ({})", err ? err : sqlite3_errmsg(db), sql);
+    sqlite3_free(err);
+    return false;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date, and back
+// (H. Hinnant's civil calendar algorithms; no timegm on Windows).
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civil_from_days(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+// events-YYYYMMDDHH.sqlite (hourly) or events-YYYYMMDD.sqlite (daily).
+bool parse_partition(const std::string& name, int64_t& start_ns, int64_t& span_ns) {
+    const std::string prefix = "events-", suffix = ".sqlite";
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        return false;
+    const std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if ((digits.size() != 8 && digits.size() != 10) ||
+        !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        return false;
+    const int64_t y = std::stoll(digits.substr(0, 4));
+    const unsigned m = static_cast<unsigned>(std::stoul(digits.substr(4, 2)));
+    const unsigned d = static_cast<unsigned>(std::stoul(digits.substr(6, 2)));
+    const unsigned h = digits.size() == 10 ? static_cast<unsigned>(std::stoul(digits.substr(8, 2))) : 0;
+    if (m < 1 || m > 12 || d < 1 || d > 31 || h > 23) return false;
+    start_ns = days_from_civil(y, m, d) * kDayNs + static_cast<int64_t>(h) * kHourNs;
+    span_ns = digits.size() == 10 ? kHourNs : kDayNs;
+    return true;
+}
+
+} // namespace
+
+struct SqliteStore::Writer {
+    int64_t part = 0;
+    std::string path;
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    bool in_txn = false;
+
+    ~Writer() {
+        if (insert) sqlite3_finalize(insert);
+        if (db) sqlite3_close(db);
+    }
+};
+
+SqliteStore::SqliteStore(Options opts, MetricsRegistry& reg)
+    : opts_(std::move(opts)),
+      rows_(reg.counter("crossbring_sqlite_rows_total", "Events written to SQLite partitions")),
+      errors_(reg.counter("crossbring_sqlite_errors_total", "Failed SQLite opens, inserts and commits")),
+      late_(reg.counter("crossbring_sqlite_late_dropped_total", "Events older than the retention window, not written")),
+      dropped_(reg.counter("crossbring_sqlite_partitions_dropped_total", "SQLite partitions deleted by retention")),
+      partitions_(reg.gauge("crossbring_sqlite_partitions", "SQLite partition files on disk")),
+      index_seconds_(reg.histogram("crossbring_sqlite_index_seconds", "Time to index one sealed partition")) {
+    if (opts_.partition == "hour") span_ns_ = kHourNs;
+    else if (opts_.partition == "day") span_ns_ = kDayNs;
+    else throw std::runtime_error("SQLite partition must be \"hour\" or \"day\", not \"" + opts_.partition + "\"");
+    opts_.open_partitions = std::max<size_t>(opts_.open_partitions, 1);
+    fs::create_directories(opts_.dir);
+    maint_ = std::thread([this]{ maintain(); });
+}
+
+SqliteStore::~SqliteStore() {
+    {
+        std::lock_guard<std::mutex> lock(maint_mu_);
+        stop_ = true;
+    }
+    maint_cv_.notify_all();
+    if (maint_.joinable()) maint_.join();
+    std::lock_guard<std::mutex> lock(mu_);
+    writers_.clear(); // open partitions are indexed by the next run's first sweep
+}
+
+fs::path SqliteStore::path_of(int64_t part) const {
+    const int64_t start = part * span_ns_;
+    int64_t y;
+    unsigned m, d;
+    civil_from_days(start / kDayNs, y, m, d);
+    char name[40];
+    if (span_ns_ == kHourNs)
+        std::snprintf(name, sizeof(name), "events-%04lld%02u%02u%02u.sqlite", static_cast<long long>(y), m, d,
+                      static_cast<unsigned>((start % kDayNs) / kHourNs));
+    else
+        std::snprintf(name, sizeof(name), "events-%04lld%02u%02u.sqlite", static_cast<long long>(y), m, d);
+    return opts_.dir / name;
+}
+
+void SqliteStore::append(const Event& ev) {
+    const int64_t ts = to_unix_ns(ev.tp);
+    std::lock_guard<std::mutex> lock(mu_);
+    if (Writer* w = writer_for(ts / span_ns_)) insert(*w, ev, ts);
+}
+
+void SqliteStore::append(const std::vector<EventPtr>& batch) {
+    std::lock_guard<std::mutex> lock(mu_);
+    Writer* w = nullptr;
+    for (auto& ev : batch) {
+        const int64_t ts = to_unix_ns(ev->tp);
+        const int64_t part = ts / span_ns_;
+        if (!w || w->part != part) {
+            w = writer_for(part);
+            if (!w) continue;
+            if (!w->in_txn) w->in_txn = exec(w->db, "BEGIN");
+        }
+        insert(*w, *ev, ts);
+    }
+    for (auto& x : writers_) {
+        if (!x->in_txn) continue;
+        x->in_txn = false;
+        if (!exec(x->db, "COMMIT")) {
+            errors_.inc();
+            exec(x->db, "ROLLBACK");
+        }
+    }
+}
+
+void SqliteStore::insert(Writer& w, const Event& ev, int64_t ts) {
+    sqlite3_reset(w.insert);
+    sqlite3_bind_int64(w.insert, 1, static_cast<sqlite3_int64>(ts));
+    sqlite3_bind_text(w.insert, 2, ev.source.data(), static_cast<int>(ev.source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(w.insert, 3, ev.key.data(), static_cast<int>(ev.key.size()), SQLITE_STATIC);
+    std::string dumped;
+    if (ev.raw.empty()) dumped = ev.payload.dump();
+    const std::string& payload = ev.raw.empty() ? dumped : ev.raw;
+    sqlite3_bind_text(w.insert, 4, payload.data(), static_cast<int>(payload.size()), SQLITE_STATIC);
+    if (sqlite3_step(w.insert) != SQLITE_DONE) {
+        errors_.inc();
+        spdlog::warn("SQLite insert failed: {}", sqlite3_errmsg(w.db));
+    } else {
+        rows_.inc();
+    }
+}
+
+// The writer for partition `part`, most recently used last. Opening one more
+// than `open_partitions` seals the least recently used.
+SqliteStore::Writer* SqliteStore::writer_for(int64_t part) {
+    for (size_t i = writers_.size(); i-- > 0;) {
+        if (writers_[i]->part != part) continue;
+        if (i + 1 != writers_.size()) {
+            auto w = std::move(writers_[i]);
+            writers_.erase(writers_.begin() + static_cast<std::ptrdiff_t>(i));
+            writers_.push_back(std::move(w));
+        }
+        return writers_.back().get();
+    }
+    if (opts_.retention_hours > 0 &&
+        (part + 1) * span_ns_ <= unix_now_ns() - static_cast<int64_t>(opts_.retention_hours) * kHourNs) {
+        late_.inc();
+        return nullptr;
+    }
+
+    auto w = std::make_unique<Writer>();
+    w->part = part;
+    w->path = path_of(part).string();
+    std::error_code ec;
+    const bool fresh = !fs::exists(w->path, ec);
+    if (sqlite3_open(w->path.c_str(), &w->db) != SQLITE_OK) {
+        errors_.inc();
+        spdlog::warn("SQLite open failed for {}: {}", w->path, w->db ? sqlite3_errmsg(w->db) : "out of memory");
+        return nullptr;
+    }
+    sqlite3_busy_timeout(w->db, 5000);
+    const bool ok = exec(w->db, "PRAGMA journal_mode=WAL") && exec(w->db, "PRAGMA synchronous=NORMAL") &&
+                    exec(w->db, "CREATE TABLE IF NOT EXISTS events ("
+                                " ts_ns INTEGER NOT NULL,"
+                                " source TEXT NOT NULL,"
+                                " key TEXT NOT NULL,"
+                                " payload TEXT)") &&
+                    (!opts_.index_on_write || exec(w->db, kIndexSql)) &&
+                    sqlite3_prepare_v2(w->db, "INSERT INTO events (ts_ns, source, key, payload) VALUES (?,?,?,?)", -1,
+                                       &w->insert, nullptr) == SQLITE_OK;
+    if (!ok) {
+        errors_.inc();
+        spdlog::warn("SQLite partition {} unusable: {}", w->path, sqlite3_errmsg(w->db));
+        return nullptr;
+    }
+    if (fresh) partitions_.add();
+    writers_.push_back(std::move(w));
+    if (writers_.size() > opts_.open_partitions) {
+        auto old = std::move(writers_.front());
+        writers_.erase(writers_.begin());
+        seal(std::move(old));
+    }
+    return writers_.back().get();
+}
+
+void SqliteStore::seal(std::unique_ptr<Writer> w) {
+    if (w->in_txn && !exec(w->db, "COMMIT")) errors_.inc();
+    const std::string path = w->path;
+    w.reset();
+    if (opts_.index_on_write) return;
+    {
+        std::lock_guard<std::mutex> lock(maint_mu_);
+        to_index_.emplace_back(path);
+    }
+    maint_cv_.notify_all();
+}
+
+// Background thread: indexes sealed partitions as they come, and once a minute
+// (and at startup, for partitions left over from the last run) applies
+// retention and indexes anything still missing one.
+void SqliteStore::maintain() {
+    std::unique_lock<std::mutex> lock(maint_mu_);
+    auto next_sweep = std::chrono::steady_clock::now();
+    while (!stop_) {
+        maint_cv_.wait_until(lock, next_sweep, [this]{ return stop_ || !to_index_.empty(); });
+        if (stop_) break;
+        auto batch = std::move(to_index_);
+        to_index_.clear();
+        lock.unlock();
+        for (auto& p : batch) build_index(p);
+        if (std::chrono::steady_clock::now() >= next_sweep) {
+            sweep();
+            next_sweep = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+        }
+        lock.lock();
+    }
+}
+
+void SqliteStore::sweep() {
+    std::vector<std::string> open;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto& w : writers_) open.push_back(w->path);
+    }
+    const int64_t now = unix_now_ns();
+    const int64_t cutoff = opts_.retention_hours > 0 ? now - static_cast<int64_t>(opts_.retention_hours) * kHourNs
+                                                     : std::numeric_limits<int64_t>::min();
+    int64_t kept = 0;
+    for (auto& p : partitions()) {
+        const std::string path = p.path.string();
+        if (std::find(open.begin(), open.end(), path) != open.end()) {
+            ++kept;
+            continue;
+        }
+        if (p.end_ns <= cutoff) {
+            std::error_code ec;
+            fs::remove(p.path, ec);
+            fs::remove(path + "-wal", ec);
+            fs::remove(path + "-shm", ec);
+            indexed_.erase(path);
+            dropped_.inc();
+            spdlog::info("SQLite retention: dropped {}", path);
+            continue;
+        }
+        ++kept;
+        if (!opts_.index_on_write && p.end_ns <= now && !indexed_.count(path)) build_index(p.path);
+    }
+    partitions_.set(kept);
+}
+
+bool SqliteStore::build_index(const fs::path& path) {
+    const auto t0 = std::chrono::steady_clock::now();
+    sqlite3* db = nullptr;
+    bool ok = sqlite3_open_v2(path.string().c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK;
+    if (ok) {
+        sqlite3_busy_timeout(db, 10000);
+        ok = exec(db, kIndexSql);
+    }
+    if (db) sqlite3_close(db);
+    if (!ok) {
+        errors_.inc();
+        return false;
+    }
+    indexed_.insert(path.string());
+    index_seconds_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    return true;
+}
+
+std::vector<SqliteStore::Partition> SqliteStore::partitions() const {
+    std::vector<Partition> out;
+    std::error_code ec;
+    for (fs::directory_iterator it(opts_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+        int64_t start, span;
+        if (parse_partition(it->path().filename().string(), start, span)) out.push_back({start, start + span, it->path()});
+    }
+    std::sort(out.begin(), out.end(), [](const Partition& a, const Partition& b) { return a.start_ns < b.start_ns; });
+    return out;
+}
+
+size_t SqliteStore::query(const Query& q, const std::function<bool(const Row&)>& fn) const {
+    std::string sql = "SELECT ts_ns, source, key, payload FROM events WHERE ts_ns >= ?1 AND ts_ns < ?2";
+    if (!q.source.empty()) sql += " AND source = ?3";
+    if (!q.key.empty()) sql += " AND key = ?4";
+    sql += " ORDER BY ts_ns LIMIT ?5";
+
+    size_t read = 0;
+    size_t rows = 0;
+    bool more = true;
+    for (auto& p : partitions()) {
+        if (!more || rows >= q.limit) break;
+        if (p.end_ns <= q.from_ns || p.start_ns >= q.to_ns) continue; // pruned
+        sqlite3* db = nullptr;
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_open_v2(p.path.string().c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+            sqlite3_busy_timeout(db, 1000);
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &st, nullptr) == SQLITE_OK) {
+                sqlite3_bind_int64(st, 1, static_cast<sqlite3_int64>(q.from_ns));
+                sqlite3_bind_int64(st, 2, static_cast<sqlite3_int64>(q.to_ns));
+                if (!q.source.empty()) sqlite3_bind_text(st, 3, q.source.data(), static_cast<int>(q.source.size()), SQLITE_STATIC);
+                if (!q.key.empty()) sqlite3_bind_text(st, 4, q.key.data(), static_cast<int>(q.key.size()), SQLITE_STATIC);
+                sqlite3_bind_int64(st, 5, static_cast<sqlite3_int64>(q.limit - rows));
+                auto text = [st](int col) {
+                    return std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(st, col)),
+                                            static_cast<size_t>(sqlite3_column_bytes(st, col)));
+                };
+                while (more && sqlite3_step(st) == SQLITE_ROW) {
+                    Row r{sqlite3_column_int64(st, 0), text(1), text(2), text(3)};
+                    ++rows;
+                    more = fn(r);
+                }
+                ++read;
+            }
+            // A partition created but not yet written has no table; nothing to read there.
+        }
+        if (st) sqlite3_finalize(st);
+        if (db) sqlite3_close(db);
+    }
+    return read;
+}
+
+} // namespace crossbring
+
+#endif // USE_SQLITE
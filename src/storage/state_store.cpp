@@ -0,0 +1,75 @@
+#include "crossbring/storage/state_store.h"
+
+#include <limits>
+#include <mutex>
+
+namespace crossbring {
+
+StateStore::StateStore(size_t shards) : shards_(shards == 0 ? 1 : shards) {}
+
+void StateStore::upsert(const std::string& key, int64_t ts_ns, DocRef doc) {
+    Shard& s = shard_for(key);
+    std::unique_lock<std::shared_mutex> lock(s.mu);
+    auto it = s.map.find(key);
+    if (it != s.map.end() && it->second.ts > ts_ns) return;
+    // Taken under the shard lock: a reader that saw this version in version_
+    // cannot scan this shard until the entry is in place.
+    uint64_t v = version_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (it == s.map.end()) s.map.emplace(key, Entry{v, ts_ns, std::move(doc)});
+    else it->second = Entry{v, ts_ns, std::move(doc)};
+}
+
+StateStore::DocRef StateStore::get(const std::string& key, uint64_t* version) const {
+    Shard& s = shard_for(key);
+    std::shared_lock<std::shared_mutex> lock(s.mu);
+    auto it = s.map.find(key);
+    if (it == s.map.end()) return nullptr;
+    if (version) *version = it->second.version;
+    return it->second.doc;
+}
+
+uint64_t StateStore::changed_since(uint64_t since, const VisitFn& fn) const {
+    const uint64_t now = version_.load(std::memory_order_acquire);
+    std::vector<std::pair<std::string, Entry>> hits;
+    for (auto& s : shards_) {
+        hits.clear();
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mu);
+            for (auto& kv : s.map) {
+                if (kv.second.version > since) hits.emplace_back(kv.first, kv.second);
+            }
+        }
+        for (auto& h : hits) fn(h.first, h.second.version, h.second.doc);
+    }
+    return now;
+}
+
+void StateStore::checkpoint(SnapshotWriter& out) const {
+    std::vector<std::pair<std::string, DocRef>> entries;
+    changed_since(0, [&](const std::string& key, uint64_t, const DocRef& doc) { entries.emplace_back(key, doc); });
+    out.u64(entries.size());
+    for (auto& e : entries) {
+        out.str(e.first);
+        out.str(*e.second);
+    }
+}
+
+void StateStore::restore(SnapshotReader& in) {
+    const uint64_t n = in.u64();
+    for (uint64_t i = 0; i < n; ++i) {
+        std::string key(in.str());
+        auto doc = std::make_shared<const std::string>(in.str());
+        upsert(key, std::numeric_limits<int64_t>::min(), std::move(doc));
+    }
+}
+
+size_t StateStore::size() const {
+    size_t n = 0;
+    for (auto& s : shards_) {
+        std::shared_lock<std::shared_mutex> lock(s.mu);
+        n += s.map.size();
+    }
+    return n;
+}
+
+} // namespace crossbring
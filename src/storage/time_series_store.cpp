@@ -0,0 +1,290 @@
+#include "crossbring/storage/time_series_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace crossbring {
+
+namespace {
+
+inline uint64_t to_bits(double v) { uint64_t b; std::memcpy(&b, &v, sizeof(b)); return b; }
+inline double from_bits(uint64_t b) { double v; std::memcpy(&v, &b, sizeof(v)); return v; }
+
+#ifdef _MSC_VER
+inline int clz64(uint64_t v) { unsigned long i; return _BitScanReverse64(&i, v) ? 63 - static_cast<int>(i) : 64; }
+inline int ctz64(uint64_t v) { unsigned long i; return _BitScanForward64(&i, v) ? static_cast<int>(i) : 64; }
+#else
+inline int clz64(uint64_t v) { return v == 0 ? 64 : __builtin_clzll(v); }
+inline int ctz64(uint64_t v) { return v == 0 ? 64 : __builtin_ctzll(v); }
+#endif
+
+inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+// Delta-of-delta buckets: prefix bits, payload bits (zigzag encoded).
+struct DodBucket { uint64_t prefix; int prefix_bits; int bits; };
+constexpr DodBucket kDod[] = {{0b10, 2, 14}, {0b110, 3, 20}, {0b1110, 4, 32}, {0b1111, 4, 64}};
+
+class BitReader {
+public:
+    BitReader(const std::vector<uint64_t>& w, size_t nbits) : w_(w), nbits_(nbits) {}
+    bool more() const { return pos_ < nbits_; }
+    uint64_t get(int n) {
+        if (n == 0) return 0;
+        size_t idx = pos_ >> 6;
+        int off = static_cast<int>(pos_ & 63);
+        uint64_t v;
+        if (off + n <= 64) {
+            v = (w_[idx] >> (64 - off - n));
+        } else {
+            int hi = 64 - off;
+            v = (w_[idx] << (n - hi)) | (w_[idx + 1] >> (64 - (n - hi)));
+        }
+        pos_ += static_cast<size_t>(n);
+        return n == 64 ? v : (v & ((uint64_t{1} << n) - 1));
+    }
+    bool bit() { return get(1) != 0; }
+
+private:
+    const std::vector<uint64_t>& w_;
+    size_t nbits_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+void GorillaChunk::put(uint64_t bits, int n) {
+    if (n == 0) return;
+    if (n < 64) bits &= (uint64_t{1} << n) - 1;
+    int off = static_cast<int>(nbits_ & 63);
+    if (off == 0) words_.push_back(0);
+    int room = 64 - off;
+    if (n <= room) {
+        words_.back() |= bits << (room - n);
+    } else {
+        words_.back() |= bits >> (n - room);
+        words_.push_back(bits << (64 - (n - room)));
+    }
+    nbits_ += static_cast<size_t>(n);
+}
+
+void GorillaChunk::append(int64_t ts, double value) {
+    uint64_t vb = to_bits(value);
+    if (count_ == 0) {
+        put(static_cast<uint64_t>(ts), 64);
+        put(vb, 64);
+        min_ts_ = max_ts_ = ts;
+    } else {
+        int64_t delta = ts - prev_ts_;
+        if (count_ == 1) {
+            put(zigzag(delta), 64);
+        } else {
+            int64_t dod = delta - prev_delta_;
+            if (dod == 0) {
+                put(0, 1);
+            } else {
+                uint64_t z = zigzag(dod);
+                for (const auto& b : kDod) {
+                    if (b.bits == 64 || z < (uint64_t{1} << b.bits)) {
+                        put(b.prefix, b.prefix_bits);
+                        put(z, b.bits);
+                        break;
+                    }
+                }
+            }
+        }
+        prev_delta_ = delta;
+
+        uint64_t x = vb ^ prev_value_;
+        if (x == 0) {
+            put(0, 1);
+        } else {
+            put(1, 1);
+            int lead = std::min(clz64(x), 31);
+            int trail = ctz64(x);
+            if (prev_lead_ >= 0 && lead >= prev_lead_ && trail >= prev_trail_) {
+                put(0, 1);
+                put(x >> prev_trail_, 64 - prev_lead_ - prev_trail_);
+            } else {
+                int sig = 64 - lead - trail;
+                put(1, 1);
+                put(static_cast<uint64_t>(lead), 5);
+                put(static_cast<uint64_t>(sig - 1), 6);
+                put(x >> trail, sig);
+                prev_lead_ = lead;
+                prev_trail_ = trail;
+            }
+        }
+        if (ts < min_ts_) min_ts_ = ts;
+        if (ts > max_ts_) max_ts_ = ts;
+    }
+    prev_ts_ = ts;
+    prev_value_ = vb;
+    ++count_;
+}
+
+void GorillaChunk::decode(const std::function<bool(int64_t, double)>& fn) const {
+    if (count_ == 0) return;
+    BitReader r(words_, nbits_);
+    int64_t ts = static_cast<int64_t>(r.get(64));
+    uint64_t vb = r.get(64);
+    if (!fn(ts, from_bits(vb))) return;
+    int64_t delta = 0;
+    int lead = 0, trail = 0;
+    for (uint32_t i = 1; i < count_; ++i) {
+        if (i == 1) {
+            delta = unzigzag(r.get(64));
+        } else if (r.bit()) {
+            int bits = 64;
+            if (!r.bit()) bits = 14;
+            else if (!r.bit()) bits = 20;
+            else if (!r.bit()) bits = 32;
+            delta += unzigzag(r.get(bits));
+        }
+        ts += delta;
+
+        if (r.bit()) {
+            if (r.bit()) {
+                lead = static_cast<int>(r.get(5));
+                int sig = static_cast<int>(r.get(6)) + 1;
+                trail = 64 - lead - sig;
+            }
+            vb ^= r.get(64 - lead - trail) << trail;
+        }
+        if (!fn(ts, from_bits(vb))) return;
+    }
+}
+
+TimeSeriesStore::TimeSeriesStore(Options opts, MetricsRegistry& reg)
+    : opts_(opts),
+      evicted_chunks_(reg.counter("crossbring_tsdb_evicted_chunks_total", "Chunks evicted to stay within the memory budget")),
+      evicted_points_(reg.counter("crossbring_tsdb_evicted_points_total", "Points evicted to stay within the memory budget")) {
+    reg.gauge_fn("crossbring_tsdb_series", "Series held by the time-series store", {}, [this] {
+        std::shared_lock<std::shared_mutex> lock(map_mu_);
+        return static_cast<double>(series_.size());
+    });
+    reg.gauge_fn("crossbring_tsdb_points", "Points held by the time-series store", {},
+                 [this] { return static_cast<double>(point_count()); });
+    reg.gauge_fn("crossbring_tsdb_bytes", "Memory held by compressed chunks", {},
+                 [this] { return static_cast<double>(memory_bytes()); });
+}
+
+std::shared_ptr<TimeSeriesStore::Series> TimeSeriesStore::find_or_create(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mu_);
+        auto it = series_.find(name);
+        if (it != series_.end()) return it->second;
+    }
+    std::shared_ptr<Series> s;
+    {
+        std::unique_lock<std::shared_mutex> lock(map_mu_);
+        auto& slot = series_[name];
+        if (slot) return slot;
+        slot = std::make_shared<Series>();
+        s = slot;
+    }
+    bytes_.fetch_add(sizeof(Series) + name.size() + s->active.bytes(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(evict_mu_);
+    fifo_.push_back({s, 0});
+    return s;
+}
+
+void TimeSeriesStore::append(const std::string& name, int64_t ts_ns, double value) {
+    auto s = find_or_create(name);
+    bool new_chunk = false;
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        int64_t before = static_cast<int64_t>(s->active.bytes());
+        if (s->active.count() >= opts_.points_per_chunk) {
+            auto sealed = std::make_shared<GorillaChunk>(std::move(s->active));
+            sealed->seal();
+            before -= static_cast<int64_t>(sealed->bytes());
+            s->sealed.push_back(std::move(sealed));
+            s->active = GorillaChunk{};
+            seq = ++s->next_seq;
+            new_chunk = true;
+        }
+        s->active.append(ts_ns / 1000, value);
+        int64_t diff = static_cast<int64_t>(s->active.bytes()) - before;
+        if (diff >= 0) bytes_.fetch_add(static_cast<size_t>(diff), std::memory_order_relaxed);
+        else bytes_.fetch_sub(static_cast<size_t>(-diff), std::memory_order_relaxed);
+    }
+    points_.fetch_add(1, std::memory_order_relaxed);
+    if (new_chunk) {
+        std::lock_guard<std::mutex> lock(evict_mu_);
+        fifo_.push_back({s, seq});
+    }
+    if (bytes_.load(std::memory_order_relaxed) > opts_.memory_budget_bytes) enforce_budget();
+}
+
+void TimeSeriesStore::enforce_budget() {
+    std::lock_guard<std::mutex> lock(evict_mu_);
+    // Each entry is visited at most once per call; active chunks are requeued, never dropped.
+    for (size_t budget = fifo_.size(); budget > 0 && bytes_.load(std::memory_order_relaxed) > opts_.memory_budget_bytes; --budget) {
+        ChunkRef ref = std::move(fifo_.front());
+        fifo_.pop_front();
+        std::lock_guard<std::mutex> slock(ref.series->mu);
+        Series& s = *ref.series;
+        if (ref.seq < s.first_seq) continue; // already gone
+        if (ref.seq == s.next_seq) {
+            fifo_.push_back(std::move(ref));
+            continue;
+        }
+        auto& oldest = s.sealed.front();
+        bytes_.fetch_sub(oldest->bytes(), std::memory_order_relaxed);
+        points_.fetch_sub(oldest->count(), std::memory_order_relaxed);
+        evicted_points_.inc(oldest->count());
+        evicted_chunks_.inc();
+        s.sealed.pop_front();
+        ++s.first_seq;
+    }
+}
+
+size_t TimeSeriesStore::scan(const std::string& name, int64_t from_ns, int64_t to_ns,
+                             const std::function<bool(int64_t, double)>& fn) const {
+    std::shared_ptr<Series> s;
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mu_);
+        auto it = series_.find(name);
+        if (it == series_.end()) return 0;
+        s = it->second;
+    }
+    // Copy chunk handles (and the small active chunk) so decoding runs unlocked.
+    std::vector<std::shared_ptr<const GorillaChunk>> chunks;
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        chunks.assign(s->sealed.begin(), s->sealed.end());
+        if (s->active.count() > 0) chunks.push_back(std::make_shared<GorillaChunk>(s->active));
+    }
+    const int64_t from_us = from_ns / 1000;
+    const int64_t to_us = to_ns == std::numeric_limits<int64_t>::max() ? to_ns : to_ns / 1000;
+    size_t visited = 0;
+    bool stop = false;
+    for (auto& c : chunks) {
+        if (stop) break;
+        if (c->max_ts() < from_us || c->min_ts() > to_us) continue;
+        c->decode([&](int64_t ts_us, double v) {
+            if (ts_us < from_us || ts_us > to_us) return true;
+            ++visited;
+            if (!fn(ts_us * 1000, v)) { stop = true; return false; }
+            return true;
+        });
+    }
+    return visited;
+}
+
+std::vector<std::string> TimeSeriesStore::series_names() const {
+    std::shared_lock<std::shared_mutex> lock(map_mu_);
+    std::vector<std::string> out;
+    out.reserve(series_.size());
+    for (auto& kv : series_) out.push_back(kv.first);
+    return out;
+}
+
+} // namespace crossbring
@@ -0,0 +1,250 @@
+#include "crossbring/transport/shm_ring.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "crossbring/core/affinity.h"
+
+namespace crossbring {
+
+namespace {
+
+std::string shm_path(const std::string& name) { return name.empty() || name[0] != '/' ? "/" + name : name; }
+
+uint32_t* futex_word(std::atomic<uint32_t>& a) { return reinterpret_cast<uint32_t*>(&a); }
+
+// Shared (not FUTEX_PRIVATE) so waiters in other processes are found.
+void futex_wake_all(std::atomic<uint32_t>& a) {
+    ::syscall(SYS_futex, futex_word(a), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void futex_wait(std::atomic<uint32_t>& a, uint32_t expected, std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    ::syscall(SYS_futex, futex_word(a), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+bool process_gone(int32_t pid) { return pid > 0 && ::kill(pid, 0) != 0 && errno == ESRCH; }
+
+bool initialised(const shm::Header* h) {
+    const bool ok = std::equal(std::begin(shm::kMagic), std::end(shm::kMagic), h->magic);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return ok;
+}
+
+// Maps an existing segment read-write. Returns nullptr if it is missing or too small.
+void* map_existing(const std::string& path, size_t& size) {
+    int fd = ::shm_open(path.c_str(), O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    void* p = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(shm::Header)) {
+        size = static_cast<size_t>(st.st_size);
+        p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+} // namespace
+
+ShmRingWriter::ShmRingWriter(const std::string& name, Options opts) : name_(shm_path(name)) {
+    uint64_t cap = 4096;
+    while (cap < opts.capacity && cap < (uint64_t{1} << 31)) cap <<= 1;
+    if (opts.max_readers == 0) opts.max_readers = 1;
+
+    // Readers of a previous ring under this name (say, from a crashed run) are
+    // told it is closed so they can reattach.
+    size_t old_size = 0;
+    if (void* old = map_existing(name_, old_size)) {
+        auto* h = static_cast<shm::Header*>(old);
+        if (initialised(h)) {
+            h->closed.store(1);
+            h->seq.fetch_add(1);
+            futex_wake_all(h->seq);
+        }
+        ::munmap(old, old_size);
+    }
+    ::shm_unlink(name_.c_str());
+
+    int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw std::runtime_error("cannot create shared memory " + name_);
+    map_size_ = shm::data_offset(opts.max_readers) + cap;
+    void* p = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(map_size_)) == 0)
+        p = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        ::shm_unlink(name_.c_str());
+        throw std::runtime_error("cannot map shared memory " + name_);
+    }
+    map_ = p;
+
+    // The segment is zero-filled, which is also the atomics' initial state.
+    hdr_ = new (map_) shm::Header{};
+    hdr_->capacity = cap;
+    hdr_->max_readers = opts.max_readers;
+    hdr_->writer_pid = static_cast<int32_t>(::getpid());
+    slots_ = reinterpret_cast<shm::ReaderSlot*>(static_cast<char*>(map_) + shm::slots_offset());
+    for (uint32_t i = 0; i < opts.max_readers; ++i) new (&slots_[i]) shm::ReaderSlot{};
+    data_ = static_cast<char*>(map_) + shm::data_offset(opts.max_readers);
+    mask_ = cap - 1;
+    limit_ = cap;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::copy(std::begin(shm::kMagic), std::end(shm::kMagic), hdr_->magic);
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    if (!map_) return;
+    hdr_->closed.store(1);
+    hdr_->seq.fetch_add(1);
+    futex_wake_all(hdr_->seq);
+    ::munmap(map_, map_size_);
+    ::shm_unlink(name_.c_str());
+}
+
+bool ShmRingWriter::write(std::string_view data) {
+    const uint64_t cap = hdr_->capacity;
+    const uint64_t need = shm::align8(sizeof(shm::RecordHeader) + data.size());
+    if (need > cap) return false;
+    uint64_t off = pos_ & mask_;
+    const uint64_t pad = off + need > cap ? cap - off : 0;
+    const uint64_t end = pos_ + pad + need;
+    if (end > limit_) {
+        limit_ = rescan(false);
+        if (end > limit_) limit_ = rescan(true);
+        if (end > limit_) return false;
+    }
+    if (pad) {
+        const shm::RecordHeader ph{static_cast<uint32_t>(pad), shm::kRecordPad};
+        std::memcpy(data_ + off, &ph, sizeof(ph));
+        off = 0;
+    }
+    const shm::RecordHeader rh{static_cast<uint32_t>(data.size()), shm::kRecordData};
+    std::memcpy(data_ + off, &rh, sizeof(rh));
+    std::memcpy(data_ + off + sizeof(rh), data.data(), data.size());
+    pos_ = end;
+    // seq_cst on both sides: either the writer sees the waiter or the waiter sees the new position.
+    hdr_->write_pos.store(pos_);
+    if (hdr_->waiters.load()) {
+        hdr_->seq.fetch_add(1);
+        futex_wake_all(hdr_->seq);
+    }
+    return true;
+}
+
+// Returns how far write_pos may advance: the slowest attached reader's cursor
+// plus the capacity. With `reap`, slots of readers whose process is gone are freed.
+uint64_t ShmRingWriter::rescan(bool reap) {
+    uint64_t low = pos_;
+    for (uint32_t i = 0; i < hdr_->max_readers; ++i) {
+        auto& s = slots_[i];
+        if (s.state.load() != shm::kSlotActive) continue;
+        if (reap && process_gone(s.pid.load())) {
+            uint32_t active = shm::kSlotActive;
+            s.state.compare_exchange_strong(active, shm::kSlotFree);
+            continue;
+        }
+        low = std::min(low, s.cursor.load(std::memory_order_acquire));
+    }
+    return low + hdr_->capacity;
+}
+
+size_t ShmRingWriter::readers() const {
+    size_t n = 0;
+    for (uint32_t i = 0; i < hdr_->max_readers; ++i)
+        if (slots_[i].state.load(std::memory_order_relaxed) == shm::kSlotActive) ++n;
+    return n;
+}
+
+uint64_t ShmRingWriter::max_lag() const {
+    const uint64_t pos = hdr_->write_pos.load(std::memory_order_relaxed);
+    uint64_t lag = 0;
+    for (uint32_t i = 0; i < hdr_->max_readers; ++i) {
+        auto& s = slots_[i];
+        if (s.state.load(std::memory_order_relaxed) != shm::kSlotActive) continue;
+        const uint64_t c = s.cursor.load(std::memory_order_relaxed);
+        if (c < pos) lag = std::max(lag, pos - c);
+    }
+    return lag;
+}
+
+ShmRingReader::ShmRingReader(const std::string& name) {
+    const std::string path = shm_path(name);
+    map_ = map_existing(path, map_size_);
+    if (!map_) throw std::runtime_error("cannot open shared memory " + path);
+    hdr_ = static_cast<shm::Header*>(map_);
+    if (!initialised(hdr_) || map_size_ != shm::data_offset(hdr_->max_readers) + hdr_->capacity) {
+        ::munmap(map_, map_size_);
+        throw std::runtime_error("shared memory " + path + " is not a crossbring ring");
+    }
+    auto* slots = reinterpret_cast<shm::ReaderSlot*>(static_cast<char*>(map_) + shm::slots_offset());
+    for (uint32_t i = 0; i < hdr_->max_readers && !slot_; ++i) {
+        uint32_t free = shm::kSlotFree;
+        if (slots[i].state.compare_exchange_strong(free, shm::kSlotClaiming)) slot_ = &slots[i];
+    }
+    if (!slot_) {
+        ::munmap(map_, map_size_);
+        throw std::runtime_error("shared memory " + path + " has no free reader slot");
+    }
+    slot_->pid.store(static_cast<int32_t>(::getpid()));
+    slot_->cursor.store(hdr_->write_pos.load());
+    slot_->state.store(shm::kSlotActive);
+    // Reload after becoming visible: from here on the writer will not overwrite
+    // anything past this position until we move on.
+    cursor_ = hdr_->write_pos.load();
+    slot_->cursor.store(cursor_);
+    data_ = static_cast<const char*>(map_) + shm::data_offset(hdr_->max_readers);
+    mask_ = hdr_->capacity - 1;
+}
+
+ShmRingReader::~ShmRingReader() {
+    slot_->state.store(shm::kSlotFree);
+    ::munmap(map_, map_size_);
+}
+
+bool ShmRingReader::wait(std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin) {
+    auto ready = [this] { return hdr_->write_pos.load() != cursor_; };
+    if (ready()) return true;
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + timeout;
+    const auto spin_end = start + std::min(spin, timeout);
+    while (std::chrono::steady_clock::now() < spin_end) {
+        for (int i = 0; i < 64; ++i) {
+            if (ready()) return true;
+            cpu_relax();
+        }
+        if (hdr_->closed.load(std::memory_order_relaxed)) return false;
+    }
+    hdr_->waiters.fetch_add(1);
+    bool got = false;
+    while (true) {
+        const uint32_t s = hdr_->seq.load();
+        if ((got = ready()) || hdr_->closed.load()) break;
+        const auto left = deadline - std::chrono::steady_clock::now();
+        if (left <= std::chrono::nanoseconds::zero()) break;
+        futex_wait(hdr_->seq, s, left);
+    }
+    hdr_->waiters.fetch_sub(1);
+    return got;
+}
+
+bool ShmRingReader::closed() const { return hdr_->closed.load() || process_gone(hdr_->writer_pid); }
+
+} // namespace crossbring
+
+#endif // __linux__